@@ -1,38 +1,17 @@
-#include "SM83.hpp"
-#include "PPU.hpp"
-#include "MMU.hpp"
-#include "DMA.hpp"
-#include "Cartridge.hpp"
-
-#include <chrono>
-#include <vector>
+#include "GameBoy.hpp"
+
+#include <memory>
 #include <Windows.h>
 
 #include <cstdio>
+#include <cstring>
 namespace 
 {
     struct DrawContext
     {
         uint32_t _framebuffer[emu::SM83::SCREEN_WIDTH * emu::SM83::SCREEN_HEIGHT];
-        int _currPixel = 0;
     };
 
-    void PPUDrawPixel(void* userData, uint8_t color2bpp)
-    {
-        static const uint32_t GBColors[] =
-        {
-            0xFFFFFFFF,
-            0xAAAAAAAA,
-            0x55555555,
-            0x00000000,
-        };
-
-        DrawContext* ctxt = (DrawContext*)userData;
-        ctxt->_framebuffer[ctxt->_currPixel] = GBColors[color2bpp & 0x03];
-        ctxt->_currPixel++;
-        ctxt->_currPixel = (ctxt->_currPixel % (emu::SM83::SCREEN_WIDTH * emu::SM83::SCREEN_HEIGHT));
-    }
-
     LRESULT CALLBACK EmuWindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
     const wchar_t WINDOW_CLASS_NAME[] = L"Emulator Window Class";
@@ -157,8 +136,6 @@ namespace
 
         return true;
     }
-
-    
 }
 
 int main(int argc, char* argv[])
@@ -193,41 +170,34 @@ int main(int argc, char* argv[])
         }
     }
 
-    emu::SM83::CPU cpu;
-    emu::SM83::PPU ppu;
-    emu::SM83::MMU mmu;
-    emu::SM83::DMACtrl dma;
-
-    // Video memory
-    std::unique_ptr<uint8_t[]> VRAM = std::make_unique<uint8_t[]>(8 * 1024);
-    std::unique_ptr<uint8_t[]> OAMBank = std::make_unique<uint8_t[]>(256);
-    emu::SM83::MapMemoryRegion(mmu, 0x8000, 8 * 1024, VRAM.get(), 0);
-    emu::SM83::MapMemoryRegion(mmu, 0xFE00, 256, OAMBank.get(), 0);
-
-    // Work RAM + echo
-    std::unique_ptr<uint8_t[]> WRAMBank0 = std::make_unique<uint8_t[]>(4 * 1024);
-    std::unique_ptr<uint8_t[]> WRAMBank1 = std::make_unique<uint8_t[]>(4 * 1024);
-    emu::SM83::MapMemoryRegion(mmu, 0xC000, 4 * 1024, WRAMBank0.get(), 0);
-    emu::SM83::MapMemoryRegion(mmu, 0xD000, 4 * 1024, WRAMBank1.get(), 0);
-    emu::SM83::MapMemoryRegion(mmu, 0xE000, 4 * 1024, WRAMBank0.get(), 0);  // Echo RAM
-    emu::SM83::MapMemoryRegion(mmu, 0xF000, 4 * 1024, WRAMBank1.get(), 0);  // Echo RAM
-
-    emu::SM83::BootCPU(cpu, 0, 0);
-    emu::SM83::MapPeripheralIOMemory(cpu, mmu);
-
-    emu::SM83::BootPPU(ppu, VRAM.get(), OAMBank.get(), PPUDrawPixel, &drawCtxt);
-
-    emu::SM83::Cartridge cart;
-    bool romLoaded = emu::SM83::LoadROM(cart, rom.get(), romSize);
-    EMU_ASSERT(romLoaded);
+    // Trade timing accuracy for speed with --fast, and go further with --jit
+    emu::SM83::ExecutionMode mode = emu::SM83::ExecutionMode::CycleAccurate;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--fast") == 0)
+        {
+            mode = emu::SM83::ExecutionMode::Instruction;
+        }
+        else if (std::strcmp(argv[i], "--jit") == 0)
+        {
+            mode = emu::SM83::ExecutionMode::Compiled;
+        }
+    }
 
-    emu::SM83::MapCartridgeROM(cart, mmu);
+    std::unique_ptr<emu::SM83::GameBoy> gb = std::make_unique<emu::SM83::GameBoy>();
+    bool booted = emu::SM83::BootGameBoy(*gb, rom.get(), romSize, mode);
+    EMU_ASSERT(booted);
 
-    auto time = std::chrono::system_clock::now();
+    // Same layout as the DIB the window gets painted from
+    const emu::SM83::PPUFramebuffer framebuffer =
+    {
+        ._pixels = drawCtxt._framebuffer,
+        ._pitch = emu::SM83::SCREEN_WIDTH * sizeof(uint32_t),
+        ._format = emu::SM83::FramebufferFormat::BGRA8888,
+        ._shades = { 0xFFFFFFFF, 0xAAAAAAAA, 0x55555555, 0x00000000 },
+    };
+    emu::SM83::SetPPUFramebuffer(gb->_ppu, framebuffer);
 
-    uint16_t PC = cpu._registers._reg16.PC;
-    bool pastBootROM = false;
-    
     while (true)
     {
         if (!HandleEvents())
@@ -235,20 +205,12 @@ int main(int argc, char* argv[])
             break;
         }
 
-        for (int j = 0; j < 154; ++j)
-        {
-            for (int i = 0; i < 456; ++i)
-            {
-                emu::SM83::TickOAMDMA(dma, mmu, cpu._peripheralIO);
-                emu::SM83::TickCPU(cpu, mmu, 1);
-                emu::SM83::TickMBC(cart, mmu);
-                emu::SM83::TickPPU(ppu, mmu, cpu._peripheralIO);
-            }
-        }
+        emu::SM83::RunFrame(*gb);
         RedrawWindow(hwnd, nullptr, nullptr, RDW_INVALIDATE);
     }
 
     DestroyWindow(hwnd);
+    emu::SM83::DestroyGameBoy(*gb);
 
     return 0;
 }
\ No newline at end of file
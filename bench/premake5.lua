@@ -0,0 +1,25 @@
+project "emulatorBench"
+
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    flags { "FatalWarnings", "MultiProcessorCompile" }
+
+    files {
+        "src/**.h",
+        "src/**.hpp",
+        "src/**.cpp",
+        "src/**.c"
+    }
+
+    includedirs {
+        "../emulator/include"
+    }
+
+    libdirs {
+        "%{wks.location}/%{cfg.buildcfg}"
+    }
+
+    targetdir "%{wks.location}/%{cfg.buildcfg}/"
+
+    links { "emulator" }
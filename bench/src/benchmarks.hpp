@@ -0,0 +1,5 @@
+#pragma once
+
+// Each benchmark prints its own results, run them from a Release build
+void RunDecoderBenchmark();
+void RunTileDecodeBenchmark();
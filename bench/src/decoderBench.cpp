@@ -0,0 +1,200 @@
+#include "benchmarks.hpp"
+
+#include "SM83.hpp"
+#include "MMU.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    constexpr const uint32_t MEMORY_SIZE = 64 * 1024;
+    constexpr const uint32_t SLICE_MCYCLES = 114;              // One scanline per instance before switching to the next
+    constexpr const uint32_t TIMED_MCYCLES = 16 * 1024 * 1024;
+    constexpr const uint32_t SAMPLED_MCYCLES = 1024 * 1024;
+    constexpr const uint32_t INSTANCE_COUNTS[] = { 1, 4, 16 };
+
+    // Modelled L1 data cache, typical for current desktop cores
+    constexpr const uint32_t CACHE_LINE_SIZE = 64;
+    constexpr const uint32_t CACHE_WAYS = 8;
+    constexpr const uint32_t CACHE_SETS = 32 * 1024 / (CACHE_LINE_SIZE * CACHE_WAYS);
+
+    // Previous table layout: three tables of 256 instructions, each a cycle count followed by 8 micro-op slots
+    constexpr const uint32_t UNPACKED_INSTRUCTION_SIZE = sizeof(uint32_t) + 8 * sizeof(emu::SM83::MicroOp);
+
+    struct Instance
+    {
+        emu::SM83::CPU _cpu;
+        emu::SM83::MMU _mmu;
+        std::unique_ptr<uint8_t[]> _memory;
+    };
+
+    struct CacheModel
+    {
+        uint64_t _tags[CACHE_SETS][CACHE_WAYS];
+        uint64_t _lastUse[CACHE_SETS][CACHE_WAYS];
+        uint64_t _accesses;     // Doubles as the LRU clock
+        uint64_t _misses;
+    };
+
+    void CacheAccess(CacheModel& cache, uint64_t address)
+    {
+        uint64_t line = address / CACHE_LINE_SIZE;
+        uint32_t set = uint32_t(line % CACHE_SETS);
+        uint64_t tag = line + 1;    // 0 marks an empty way
+
+        cache._accesses++;
+
+        uint32_t victim = 0;
+        for (uint32_t way = 0; way < CACHE_WAYS; ++way)
+        {
+            if (cache._tags[set][way] == tag)
+            {
+                cache._lastUse[set][way] = cache._accesses;
+                return;
+            }
+
+            if (cache._lastUse[set][way] < cache._lastUse[set][victim])
+            {
+                victim = way;
+            }
+        }
+
+        cache._misses++;
+        cache._tags[set][victim] = tag;
+        cache._lastUse[set][victim] = cache._accesses;
+    }
+
+    bool IsValidOpCode(uint8_t opCode)
+    {
+        switch (opCode)
+        {
+        case 0x10:  // STOP
+        case 0x76:  // HALT
+        case 0xD3: case 0xDB: case 0xDD:
+        case 0xE3: case 0xE4: case 0xEB: case 0xEC: case 0xED:
+        case 0xF4: case 0xFC: case 0xFD:
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    // Every instance runs its own random instruction stream out of read-only memory, so wherever
+    // execution jumps to there is a valid instruction, and different instances use different opcodes
+    std::vector<Instance> CreateInstances(uint32_t count)
+    {
+        std::vector<Instance> instances(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Instance& instance = instances[i];
+            instance._memory = std::make_unique<uint8_t[]>(MEMORY_SIZE);
+
+            uint32_t state = 0x9E3779B9u * (i + 1);
+            for (uint32_t address = 0; address < MEMORY_SIZE; ++address)
+            {
+                uint8_t value = 0;
+                do
+                {
+                    state ^= state << 13;
+                    state ^= state >> 17;
+                    state ^= state << 5;
+                    value = uint8_t(state >> 8);
+                } while (!IsValidOpCode(value));
+
+                instance._memory[address] = value;
+            }
+
+            emu::SM83::MapMemoryRegion(instance._mmu, 0, MEMORY_SIZE, instance._memory.get(), emu::SM83::MMRF_ReadOnly);
+            emu::SM83::BootCPU(instance._cpu, 0xFFFE, 0x0100, 1);
+        }
+
+        return instances;
+    }
+
+    double RunTimed(uint32_t instanceCount)
+    {
+        std::vector<Instance> instances = CreateInstances(instanceCount);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t mCycles = 0; mCycles < TIMED_MCYCLES; mCycles += SLICE_MCYCLES * instanceCount)
+        {
+            for (Instance& instance : instances)
+            {
+                emu::SM83::TickCPU(instance._cpu, instance._mmu, SLICE_MCYCLES * 4);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        return double(TIMED_MCYCLES) * 4.0 / seconds / 1e6;
+    }
+
+    // Feeds the micro-op reads of the decoder through the cache model, once with the actual addresses
+    // and once with the addresses the same reads would have had in the unpacked layout
+    // Each instance's memory accesses go through the model as well, as they compete for the same cache
+    void RunSampled(uint32_t instanceCount)
+    {
+        std::vector<Instance> instances = CreateInstances(instanceCount);
+
+        std::unique_ptr<CacheModel> packed = std::make_unique<CacheModel>();
+        std::unique_ptr<CacheModel> unpacked = std::make_unique<CacheModel>();
+        std::unordered_set<uint64_t> packedLines;
+        std::unordered_set<uint64_t> unpackedLines;
+
+        uint32_t mCycles = 0;
+        while (mCycles < SAMPLED_MCYCLES)
+        {
+            for (Instance& instance : instances)
+            {
+                mCycles += SLICE_MCYCLES;
+
+                emu::SM83::CPU& cpu = instance._cpu;
+                for (uint32_t i = 0; i < SLICE_MCYCLES; ++i)
+                {
+                    uint64_t unpackedAddress =
+                        (uint64_t(cpu._decoder._table) * 256 + cpu._registers._reg8.IR) * UNPACKED_INSTRUCTION_SIZE +
+                        sizeof(uint32_t) + cpu._decoder._nextMCycleIndex * sizeof(emu::SM83::MicroOp);
+
+                    emu::SM83::TickCPU(cpu, instance._mmu, 4);
+
+                    uint64_t packedAddress = uint64_t(reinterpret_cast<uintptr_t>(cpu._decoder._currOp));
+                    CacheAccess(*packed, packedAddress);
+                    CacheAccess(*unpacked, unpackedAddress);
+                    packedLines.insert(packedAddress / CACHE_LINE_SIZE);
+                    unpackedLines.insert(unpackedAddress / CACHE_LINE_SIZE);
+
+                    uint64_t memoryAddress = uint64_t(reinterpret_cast<uintptr_t>(instance._memory.get() + cpu._io._address));
+                    CacheAccess(*packed, memoryAddress);
+                    CacheAccess(*unpacked, memoryAddress);
+                }
+            }
+        }
+
+        std::printf("  %2u instance(s): decode lines touched %4zu -> %4zu, modelled L1 misses per 1k MCycles %7.2f -> %7.2f\n",
+            instanceCount,
+            unpackedLines.size(),
+            packedLines.size(),
+            double(unpacked->_misses) * 1000.0 / double(mCycles),
+            double(packed->_misses) * 1000.0 / double(mCycles));
+    }
+}
+
+void RunDecoderBenchmark()
+{
+    // The cache model only sees decoder and memory reads, hardware counters are the way to see the whole picture
+    std::printf(" Decoder table footprint, unpacked -> packed (32KB %u-way L1 model)\n", CACHE_WAYS);
+    for (uint32_t instanceCount : INSTANCE_COUNTS)
+    {
+        RunSampled(instanceCount);
+    }
+
+    std::printf(" Cycle accurate throughput, instances interleaved every scanline\n");
+    for (uint32_t instanceCount : INSTANCE_COUNTS)
+    {
+        std::printf("  %2u instance(s): %8.2f MHz\n", instanceCount, RunTimed(instanceCount));
+    }
+}
@@ -0,0 +1,40 @@
+#include "benchmarks.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    struct Benchmark
+    {
+        const char* _name;
+        void (*_run)();
+    };
+
+    constexpr const Benchmark BENCHMARKS[] =
+    {
+        { "decoder", RunDecoderBenchmark },
+        { "tiles", RunTileDecodeBenchmark },
+    };
+}
+
+// Runs every benchmark, or only the ones named on the command line
+int main(int argc, char* argv[])
+{
+    for (const Benchmark& benchmark : BENCHMARKS)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+        {
+            selected |= std::strcmp(argv[i], benchmark._name) == 0;
+        }
+
+        if (selected)
+        {
+            std::printf("== %s ==\n", benchmark._name);
+            benchmark._run();
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "benchmarks.hpp"
+
+#include "TileDecode.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+    constexpr const uint32_t ROWS_PER_SCANLINE = 21;        // What a scanline renders, a tile more than fits the screen
+    constexpr const uint32_t SCANLINE_COUNT = 4096;
+    constexpr const uint32_t REPEATS = 256;
+    constexpr const uint8_t PALETTE = 0xE4;
+
+    const char* const KERNEL_NAMES[] = { "scalar", "SSE2", "AVX2" };
+    static_assert(std::size(KERNEL_NAMES) == uint32_t(emu::SM83::TileDecodeKernel::Count));
+
+    // The way the pixel FIFO gets its pixels out, a bit from each bitplane per pixel with a shift in between
+    struct FIFORow
+    {
+        uint8_t _indicesLow;
+        uint8_t _indicesHigh;
+    };
+
+    uint8_t ReverseBits(uint8_t b)
+    {
+        b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+        b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+        b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+        return b;
+    }
+
+    void DecodeFIFO(const uint8_t* rows, uint32_t rowCount, bool xFlip, uint8_t* colors)
+    {
+        for (uint32_t row = 0; row < rowCount; ++row)
+        {
+            FIFORow fifo =
+            {
+                ._indicesLow = xFlip ? ReverseBits(rows[row * 2 + 0]) : rows[row * 2 + 0],
+                ._indicesHigh = xFlip ? ReverseBits(rows[row * 2 + 1]) : rows[row * 2 + 1],
+            };
+
+            for (uint32_t i = 0; i < 8; ++i)
+            {
+                uint8_t colorIdx = (fifo._indicesHigh & 0x80) >> 6 | (fifo._indicesLow & 0x80) >> 7;
+                colors[row * 8 + i] = (PALETTE >> (colorIdx * 2)) & 0x03;
+
+                fifo._indicesLow = uint8_t(fifo._indicesLow << 1);
+                fifo._indicesHigh = uint8_t(fifo._indicesHigh << 1);
+            }
+        }
+    }
+
+    std::vector<uint8_t> CreateRows()
+    {
+        std::vector<uint8_t> rows(SCANLINE_COUNT * ROWS_PER_SCANLINE * 2);
+        uint32_t state = 0x9E3779B9u;
+        for (uint8_t& byte : rows)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            byte = uint8_t(state >> 8);
+        }
+
+        return rows;
+    }
+
+    // Decodes and applies the palette a scanline at a time, returns millions of pixels per second
+    template <typename Fn>
+    double RunTimed(const std::vector<uint8_t>& rows, std::vector<uint8_t>& colors, Fn&& decodeScanline)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t repeat = 0; repeat < REPEATS; ++repeat)
+        {
+            for (uint32_t line = 0; line < SCANLINE_COUNT; ++line)
+            {
+                decodeScanline(
+                    rows.data() + line * ROWS_PER_SCANLINE * 2,
+                    colors.data() + line * ROWS_PER_SCANLINE * 8,
+                    (repeat & 1) != 0);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        return double(REPEATS) * SCANLINE_COUNT * ROWS_PER_SCANLINE * 8 / seconds / 1e6;
+    }
+}
+
+void RunTileDecodeBenchmark()
+{
+    std::vector<uint8_t> rows = CreateRows();
+    std::vector<uint8_t> expected(rows.size() * 4);
+    std::vector<uint8_t> colors(rows.size() * 4);
+
+    std::printf(" Tile row decode and palette lookup, %u rows per call, alternating X flip\n", ROWS_PER_SCANLINE);
+
+    double fifoRate = RunTimed(rows, expected, [](const uint8_t* lineRows, uint8_t* lineColors, bool xFlip)
+    {
+        DecodeFIFO(lineRows, ROWS_PER_SCANLINE, xFlip, lineColors);
+    });
+    std::printf("  %-8s %8.1f Mpixels/s\n", "FIFO", fifoRate);
+
+    for (uint32_t i = 0; i < uint32_t(emu::SM83::TileDecodeKernel::Count); ++i)
+    {
+        emu::SM83::TileDecodeKernel kernel = emu::SM83::TileDecodeKernel(i);
+        if (!emu::SM83::IsTileDecodeKernelSupported(kernel))
+        {
+            std::printf("  %-8s not supported\n", KERNEL_NAMES[i]);
+            continue;
+        }
+
+        double rate = RunTimed(rows, colors, [kernel](const uint8_t* lineRows, uint8_t* lineColors, bool xFlip)
+        {
+            emu::SM83::DecodeTileRows(kernel, lineRows, ROWS_PER_SCANLINE, xFlip, lineColors);
+            emu::SM83::ApplyPalette(kernel, lineColors, ROWS_PER_SCANLINE * 8, PALETTE, lineColors);
+        });
+
+        // Both end on a flipped pass, so the output has to match
+        bool matches = colors == expected;
+        std::printf("  %-8s %8.1f Mpixels/s (%.2fx)%s\n", KERNEL_NAMES[i], rate, rate / fifoRate, matches ? "" : " MISMATCH");
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.hpp"
+#include "GameBoy.hpp"
+
+namespace emu::SM83
+{
+    // Called from whichever worker thread the job happens to be on, never from two at once for the same job
+    using FnBatchJobHook = void(*)(void* userData, GameBoy& gb);
+
+    // One emulator instance to run, its Game Boy only exists while the job is being run
+    // Jobs can share a ROM, nothing ever writes to it
+    struct BatchJob
+    {
+        uint8_t* _rom = nullptr;
+        uint32_t _romSize = 0;
+        ExecutionMode _mode = ExecutionMode::CycleAccurate;
+        uint64_t _cycles = 0;
+
+        // Optional early out, checked as often as RunUntil does
+        FnRunPredicate _predicate = nullptr;
+
+        // Optional, right after booting to set up output, and right before the Game Boy gets destroyed to read results
+        FnBatchJobHook _onBoot = nullptr;
+        FnBatchJobHook _onFinish = nullptr;
+        void* _userData = nullptr;
+
+        // Filled in by RunBatch
+        uint64_t _cyclesRun = 0;
+        bool _booted = false;
+        bool _predicateMet = false;
+    };
+
+    struct BatchStats
+    {
+        uint64_t _cycles = 0;           // Summed over all jobs
+        uint32_t _workerCount = 0;
+        uint32_t _steals = 0;
+        double _seconds = 0.0;
+    };
+
+    // Runs a slice of a job at a time so a worker that runs out of jobs can take over unfinished ones from the others
+    constexpr const uint64_t BATCH_SLICE_CYCLES = 4 * CYCLES_PER_FRAME;
+
+    // Spreads the jobs over workerCount threads, or one per hardware thread if 0, and returns once all of them are done
+    BatchStats RunBatch(BatchJob* jobs, uint32_t jobCount, uint32_t workerCount = 0);
+}
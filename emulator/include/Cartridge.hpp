@@ -51,8 +51,11 @@ namespace emu::SM83
     };
 
     bool LoadROM(Cartridge& cart, uint8_t* rom, uint32_t romSize);
+
+    // Whether the header says the ROM makes use of CGB features, DMG-only ROMs never touch their registers
+    bool IsCGBCartridge(const Cartridge& cart);
+
+    // Maps the first two ROM banks, bank switches happen through the MBC's write handler from then on
     void MapCartridgeROM(Cartridge& cart, MMU& mmu);
-    
-    void TickMBC(Cartridge& cart, MMU& mmu);
 
 }
\ No newline at end of file
@@ -4,15 +4,47 @@
 
 namespace emu::SM83
 {
-    struct PeripheralIO;
+    struct CPU;
     struct MMU;
+    struct PPU;
+
+    constexpr const uint16_t OAM_DMA_LENGTH = 160;
 
     struct DMACtrl
     {
-        uint16_t _dmaCycles = 0;
+        uint8_t* _oam = nullptr;
+        uint16_t _dmaCycles = 0;    // Into the current transfer, everything before it has been copied already
         uint8_t _dmaActive = 0;
-        uint8_t _lastDMARegValue = 0;
+        uint8_t _startPending = 0;  // Set by writes to OAM_DMA, the transfer starts on the next tick
+        uint8_t _sourcePage = 0;
+
+        // The CPU is kept off the source bus for the whole transfer, so its contents can be taken in one go when it starts
+        uint8_t _source[OAM_DMA_LENGTH] = {};
+    };
+
+    // Hooks the OAM DMA register, every write to it (re)starts a transfer
+    // OAM gets written directly, whether the PPU currently has it mapped or not
+    void BootOAMDMA(DMACtrl& dma, CPU& cpu, uint8_t* oam);
+
+    // Runs the transfer for that many cycles, then starts the pending one if there is any
+    // Copies in bulk, so OAM is only exact as of the last call, which is enough for anything that syncs first
+    // Returns the cycles until the transfer is done, 0 if there's none running
+    uint32_t AdvanceOAMDMA(DMACtrl& dma, MMU& mmu, uint32_t cycles);
+
+    // CGB VRAM DMA, copies blocks of 16 bytes from ROM or RAM to VRAM while the CPU is stalled
+    // General purpose transfers copy everything at once, HBlank transfers copy a block every time the PPU enters HBlank
+    struct VRAMDMACtrl
+    {
+        CPU* _cpu = nullptr;
+        const PPU* _ppu = nullptr;
+        uint8_t* _vram = nullptr;
+
+        uint16_t _source = 0;       // Both move on with each block, like the hardware's address counters
+        uint16_t _dest = 0;
+        uint8_t _blocksLeft = 0;
+        uint8_t _hblankActive = 0;
     };
 
-    void TickOAMDMA(DMACtrl& dma, MMU& mmu, PeripheralIO& pIO);
+    // Hooks HDMA1 - HDMA5 and the PPU's HBlank, transfers go to the PPU's VRAM
+    void BootVRAMDMA(VRAMDMACtrl& dma, CPU& cpu, PPU& ppu);
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "common.hpp"
+#include "Cartridge.hpp"
+#include "DMA.hpp"
+#include "JIT.hpp"
+#include "MMU.hpp"
+#include "PPU.hpp"
+#include "SM83.hpp"
+#include "Scheduler.hpp"
+
+namespace emu::SM83
+{
+    // A whole DMG wired up and ticked in the right order, so frontends only have to deal with input and output
+    // All of its memory lives in the struct itself, bar the cartridge's RAM and translated code, and the ROM which is used in place
+    // Big enough that it's best put on the heap
+    struct GameBoy
+    {
+        CPU _cpu;
+        PPU _ppu;
+        MMU _mmu;
+        DMACtrl _dma;
+        VRAMDMACtrl _vramDMA;
+        Cartridge _cart;
+        Scheduler _sched;
+        JIT _jit;
+        TileCache _tileCache;
+
+        ExecutionMode _mode = ExecutionMode::CycleAccurate;
+        uint64_t _targetCycle = 0;      // Where the runs so far were meant to end, _sched._currCycle can be a little past it
+
+        uint64_t _ppuWriteCycle = 0;    // Of the last write to the PPU registers outside of cycle accurate mode
+
+        uint8_t _vram[8 * 1024] = {};
+        uint8_t _oam[256] = {};
+        uint8_t _wram[2][4 * 1024] = {};    // Echoed at $E000
+    };
+
+    // Starts off in the boot ROM, with the PPU not drawing anywhere until it gets a framebuffer or output hooks
+    // The ROM has to stay around for as long as the Game Boy does, false if it isn't one that can be run
+    // Compiled mode falls back to instruction mode when there's no executable memory to be had
+    bool BootGameBoy(GameBoy& gb, uint8_t* rom, uint32_t romSize, ExecutionMode mode = ExecutionMode::CycleAccurate);
+    void DestroyGameBoy(GameBoy& gb);
+
+    // Anything but cycle accurate mode runs whole instructions, and can overshoot by part of one
+    // The next call accounts for it, so the Game Boy never drifts from the cycles it was asked to run
+    void RunCycles(GameBoy& gb, uint64_t cycles);
+
+    // Up to the end of the current frame, frames always end on the same cycle whatever ran past the last one
+    void RunFrame(GameBoy& gb);
+
+    // Runs until the predicate returns true, or for at most maxCycles, returns whether the predicate was met
+    // Checked before running anything and then after every instruction, or every cycle in cycle accurate mode
+    using FnRunPredicate = bool(*)(void* userData, const GameBoy& gb);
+    bool RunUntil(GameBoy& gb, FnRunPredicate predicate, void* userData, uint64_t maxCycles);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+namespace emu::SM83
+{
+    struct CPU;
+    struct MMU;
+    struct Registers;
+
+    // Translated code for a run of instructions, returns the T-cycles taken and leaves PC on the next instruction to run
+    // Stops ahead of the next instruction once it has taken maxCycles or more, returns 0 if it had to bail before finishing the first one
+    using JITBlockFn = uint32_t (*)(Registers* regs, MMU* mmu, uint32_t maxCycles);
+
+    struct JITBlock
+    {
+        JITBlockFn _func = nullptr;     // Null if nothing at this address could be translated
+
+        // ROM bytes the block was translated from, which tells apart the same address in different banks
+        // Blocks never cross a 16KB bank boundary, so this is all it takes to check the block is still mapped
+        const uint8_t* _source = nullptr;
+
+        uint16_t _address = 0;
+        uint8_t _instructionCount = 0;
+        uint8_t _nativeInstructionCount = 0;   // Never call into the interpreter, so can't make the block bail
+        uint8_t _firstOpCode = 0;
+    };
+
+    struct JITStats
+    {
+        uint64_t _blockRuns = 0;
+        uint64_t _interpretedSteps = 0;
+        uint32_t _compiledBlocks = 0;
+        uint32_t _flushes = 0;
+    };
+
+    constexpr const uint32_t JIT_DEFAULT_CODE_SIZE = 4 * 1024 * 1024;
+    constexpr const uint32_t JIT_MAX_BLOCK_INSTRUCTIONS = 32;
+    constexpr const uint8_t JIT_HOT_BLOCK_THRESHOLD = 16;  // Executions through the interpreter before a block gets translated
+
+    // Translates hot basic blocks of cartridge ROM to native code, only available on x86-64
+    // Anything outside of read-only segments (WRAM, HRAM, ...) always goes through the interpreter
+    struct JIT
+    {
+        uint8_t* _code = nullptr;
+        uint32_t _codeSize = 0;
+        uint32_t _codeCapacity = 0;
+
+        std::unordered_map<const uint8_t*, JITBlock> _blocks;  // Keyed by ROM location, i.e. bank and address
+        std::unique_ptr<const JITBlock*[]> _blockLookup;        // By address, checked against the MMU segments before use
+        std::unique_ptr<uint8_t[]> _blockHeat;
+
+        JITStats _stats;
+    };
+
+    bool InitJIT(JIT& jit, uint32_t codeSize = JIT_DEFAULT_CODE_SIZE);
+    void DestroyJIT(JIT& jit);
+
+    // Throws away all translated code
+    void FlushJIT(JIT& jit);
+
+    // Translates up to maxInstructions starting at address, without adding the block to the cache
+    // The block can be invalidated by any later translation, as that may need to flush
+    JITBlock CompileBlock(JIT& jit, const MMU& mmu, uint16_t address, uint32_t maxInstructions);
+
+    // Runs a block in place of StepCPU, the CPU has to be at the block's first instruction
+    // Leaves the block at the first instruction boundary at or past maxCycles, where stepping would have stopped to catch up
+    // Returns 0 without touching the CPU if the first instruction has to go through the interpreter
+    uint32_t RunBlock(const JITBlock& block, CPU& cpu, MMU& mmu, uint32_t maxCycles = UINT32_MAX);
+
+    // Same as StepCPU, but runs translated code when there is a block for PC, up to the first instruction boundary
+    // at or past maxCycles or the timer raising its interrupt
+    // ROM bank switches remap the ROM segments, which is all it takes for stale blocks to stop being used
+    uint32_t StepCPUCompiled(JIT& jit, CPU& cpu, MMU& mmu, uint32_t maxCycles);
+}
@@ -7,34 +7,150 @@ namespace emu::SM83
     static constexpr uint16_t MMU_SEGMENT_SIZE = 256;
     static constexpr uint16_t MMU_SEGMENT_COUNT = (64 * 1024) / 256;
 
-    static constexpr uint8_t MMU_READ = 1;
-    static constexpr uint8_t MMU_WRITE = 2;
+    // $FF80 - $FFFE, in the same page as the IO registers
+    static constexpr uint16_t MMU_HRAM_BEGIN = 0xFF80;
+    static constexpr uint16_t MMU_HRAM_END = 0xFFFF;
+
+    struct MMU;
+
+    // Memory mapped IO, for regions where accesses have side effects
+    // Handlers take over the whole access, the region's memory is only there for them to use
+    // Either one can be left out, reads or writes then go straight to memory as usual
+    using MMIOReadFn = uint8_t (*)(void* context, uint16_t address);
+    using MMIOWriteFn = void (*)(void* context, MMU& mmu, uint16_t address, uint8_t val);
+
+    struct MMIOHandler
+    {
+        MMIOReadFn _read = nullptr;
+        MMIOWriteFn _write = nullptr;
+        void* _context = nullptr;
+    };
+
+    // The buses OAM DMA can keep the CPU off of, OAM itself is always locked along with them
+    // The external bus covers ROM, cartridge RAM and WRAM, the video bus covers VRAM
+    enum class MMUBus : uint8_t
+    {
+        None = 0,
+        External,
+        Video,
+
+        Count
+    };
+
+    // What the PPU keeps the CPU off of while it reads from video memory, OAM during OAM scan and VRAM during pixel fetch
+    enum class MMUVideoLock : uint8_t
+    {
+        None = 0,
+        OAM,
+        VRAM,
+
+        Count
+    };
+
+    struct MMUPageTable
+    {
+        const uint8_t* _read[MMU_SEGMENT_COUNT] = {};
+        uint8_t* _write[MMU_SEGMENT_COUNT] = {};
+    };
+
     struct MMU
     {
+        // What accesses go through, a plain RAM/ROM access is a single lookup into the table of the current locks
+        // There's a table for every pairing of locked bus and video lock
+        // Read-only and unmapped pages point at a sink page for writes and a page of 0xFF for reads
+        // Null takes the slow path, which is where MMIO handlers get called and locked pages get turned away
+        MMUPageTable _pageTables[uint32_t(MMUBus::Count) * uint32_t(MMUVideoLock::Count)];
+        MMUBus _lockedBus = MMUBus::None;
+        MMUVideoLock _videoLock = MMUVideoLock::None;
+        uint8_t _pageTableIdx = 0;          // Locking is just a matter of switching tables
+
+        // The mapping the pages above get built from, plus the boot ROM overlay in the last slot
         uint8_t* _segmentPtrs[MMU_SEGMENT_COUNT + 1] = {};
         uint8_t _segmentFlags[MMU_SEGMENT_COUNT + 1] = {};
+        MMIOHandler _segmentHandlers[MMU_SEGMENT_COUNT + 1] = {};
+
+        uint8_t _writeSink[MMU_SEGMENT_SIZE] = {};
 
-        uint16_t _address = 0;
-        uint16_t _RW = 0;
-        uint8_t _data = 0;
+        // Plain memory behind HRAM, accesses to it skip the handler of the page it shares with the IO registers
+        uint8_t* _hram = nullptr;
     };
 
     enum MMRegionFlags
     {
         MMRF_ReadOnly = 0x01,
         MMRF_Redirect = 0x02,
-        MMRF_DMALock = 0x04,
+        MMRF_ReadHandler = 0x04,    // Set by MapMemoryRegion from the handler the region comes with
+        MMRF_WriteHandler = 0x08,
     };
 
     enum class MMRegionHandle : uint64_t {};
 
-    void MapMemoryRegion(MMU& mmu, uint16_t address, uint32_t size, uint8_t* ptr, uint8_t flags);
+    void MapMemoryRegion(MMU& mmu, uint16_t address, uint32_t size, uint8_t* ptr, uint8_t flags, const MMIOHandler* handler = nullptr);
     void UnmapMemoryRegion(MMU& mmu, uint16_t address, uint32_t size);
 
+    // Whether anything is mapped at the address, bus locks aside
+    inline bool IsMemoryMapped(const MMU& mmu, uint16_t address)
+    {
+        return mmu._segmentPtrs[address / MMU_SEGMENT_SIZE] != nullptr;
+    }
+
     void RedirectZeroSegment(MMU& mmu, uint8_t* ptr);
     void RemoveZeroSegmentRedirect(MMU& mmu);
 
-    void MMUWrite(MMU& mmu, uint16_t address, uint8_t val);
-    uint8_t MMURead(MMU& mmu, uint16_t address);
+    // Lets HRAM accesses go straight to ptr ahead of the handler of the IO page, which has to be mapped already
+    // Nothing ever locks HRAM, it stays in place until the IO page gets mapped over or unmapped
+    void MapHRAM(MMU& mmu, uint8_t* ptr);
+
+    // Host memory behind an address as mapped, including the boot ROM overlay but regardless of bus locks and handlers
+    // Null if nothing is mapped there
+    const uint8_t* GetMappedMemory(const MMU& mmu, uint16_t address);
+
+    // Pages on a locked bus read as 0xFF and ignore writes, until the bus gets unlocked
+    void LockBus(MMU& mmu, MMUBus bus);
+    void UnlockBus(MMU& mmu);
+
+    // Same for the video memory the PPU is using, the mapping itself stays as it is
+    // Set on PPU mode changes, independently of the bus lock
+    void SetVideoLock(MMU& mmu, MMUVideoLock lock);
+
+    // Whether the PPU is keeping the CPU off the address
+    bool IsVideoLocked(const MMU& mmu, uint16_t address);
+
+    // Accesses the fast path can't handle, i.e. pages that haven't been set up yet, have MMIO handlers or are locked
+    uint8_t MMUReadSlow(const MMU& mmu, uint16_t address);
+    void MMUWriteSlow(MMU& mmu, uint16_t address, uint8_t val);
+
+    inline uint8_t MMURead(const MMU& mmu, uint16_t address)
+    {
+        const uint8_t* page = mmu._pageTables[mmu._pageTableIdx]._read[address / MMU_SEGMENT_SIZE];
+        if (page)
+        {
+            return page[address % MMU_SEGMENT_SIZE];
+        }
+
+        if (mmu._hram && address >= MMU_HRAM_BEGIN && address < MMU_HRAM_END)
+        {
+            return mmu._hram[address - MMU_HRAM_BEGIN];
+        }
+
+        return MMUReadSlow(mmu, address);
+    }
+
+    inline void MMUWrite(MMU& mmu, uint16_t address, uint8_t val)
+    {
+        uint8_t* page = mmu._pageTables[mmu._pageTableIdx]._write[address / MMU_SEGMENT_SIZE];
+        if (page)
+        {
+            page[address % MMU_SEGMENT_SIZE] = val;
+            return;
+        }
+
+        if (mmu._hram && address >= MMU_HRAM_BEGIN && address < MMU_HRAM_END)
+        {
+            mmu._hram[address - MMU_HRAM_BEGIN] = val;
+            return;
+        }
 
+        MMUWriteSlow(mmu, address, val);
+    }
 }
\ No newline at end of file
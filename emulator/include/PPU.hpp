@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 #include "MMU.hpp"
+#include "TileDecode.hpp"
 
 namespace emu::SM83
 {
@@ -101,7 +102,56 @@ namespace emu::SM83
         bool _isFetchingSprites = false;
     };
 
-    using FnDisplayPixelWrite = void(*)(void*, uint8_t pixel2bpp);
+    // Registers pixel fetching reads from, latched when a scanline gets rendered in one go
+    struct PPULineRegisters
+    {
+        uint8_t _LCDC = 0;
+        uint8_t _LY = 0;
+        uint8_t _SCY = 0;
+        uint8_t _SCX = 0;
+        uint8_t _WY = 0;
+        uint8_t _WX = 0;
+        uint8_t _BGP = 0;
+        uint8_t _OBP0 = 0;
+        uint8_t _OBP1 = 0;
+    };
+
+    constexpr const uint16_t TILE_CACHE_TILE_COUNT = 384;   // All of $8000-$97FF
+
+    // Tile data decoded to a colour index per pixel, plain and X flipped, for batched scanlines to read from
+    // Writes to tile data only mark tiles as dirty, they get decoded again the next time they're used
+    struct TileCache
+    {
+        uint64_t _rows[TILE_CACHE_TILE_COUNT][2][8] = {};               // By tile, X flip and row, leftmost pixel in the lowest byte
+        uint64_t _dirtyTiles[TILE_CACHE_TILE_COUNT / 64] = {};
+    };
+
+    void InvalidateTileCache(TileCache& cache, uint16_t address, uint32_t size);
+
+    enum class FramebufferFormat
+    {
+        Indexed2bpp,    // A byte per pixel holding its shade, 0 (lightest) to 3
+        RGBA8888,       // Bytes in that order
+        RGB565,
+        BGRA8888,       // Bytes in that order, same as 0xAARRGGBB on a little endian machine
+    };
+
+    // Where finished scanlines get written to, row LY starts pitch * LY bytes in
+    struct PPUFramebuffer
+    {
+        void* _pixels = nullptr;
+        uint32_t _pitch = 0;
+        FramebufferFormat _format = FramebufferFormat::Indexed2bpp;
+
+        // Colour of each shade as 0xAARRGGBB, converted to the framebuffer's format once up front
+        uint32_t _shades[4] = { 0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555, 0xFF000000 };
+    };
+
+    constexpr const uint32_t PPU_FRAME_SKIP_ALL = UINT32_MAX;      // No frame gets rendered until the frame skip changes
+
+    using FnScanlineHook = void(*)(void*, uint8_t LY);
+    using FnFrameHook = void(*)(void*);
+    using FnHBlankHook = void(*)(void*, MMU& mmu);
 
     struct PPU
     {
@@ -122,15 +172,65 @@ namespace emu::SM83
         uint8_t _currPixelXPos = 0;
         bool _windowScanlineHitThisFrame = false;
 
+        // Scanlines get rendered all at once when they enter HBlank, unless a PPU register is written during pixel fetch
+        // Pixel fetch is then caught up dot by dot from the latched registers, and carries on like that for the rest of the line
+        bool _batchScanlines = true;
+        bool _lineBatched = false;
+        uint16_t _hblankCycle = 0;          // Dot the batched line enters HBlank on, worked out up front
+        PPULineRegisters _lineRegs = {};
+
+        TileDecodeKernel _tileDecodeKernel = TileDecodeKernel::Scalar;    // What batched scanlines get decoded with
+        TileCache* _tileCache = nullptr;
+
         uint8_t* _vram = nullptr;
         uint8_t* _oam = nullptr;
 
-        FnDisplayPixelWrite _pixelWriteFn = nullptr;
-        void* _pixelWriteUserData = nullptr;
+        // Shades of the scanline being drawn, written to the framebuffer all at once when it's done
+        uint8_t _lineShades[SCREEN_WIDTH] = {};
+
+        PPUFramebuffer _framebuffer = {};
+        uint32_t _shadePixels[4] = {};      // _shades in the framebuffer's format
+
+        // Skipped frames keep all of their timing, down to what's left in the FIFOs, but don't work out any pixels
+        uint32_t _frameSkip = 0;            // Frames skipped after each rendered one
+        uint32_t _framesUntilRender = 0;
+        bool _renderFrame = true;
+
+        FnScanlineHook _scanlineFn = nullptr;
+        FnFrameHook _frameFn = nullptr;
+        void* _outputUserData = nullptr;
+
+        FnHBlankHook _hblankFn = nullptr;
+        void* _hblankUserData = nullptr;
     };
 
     struct PeripheralIO;
 
-    void BootPPU(PPU& ppu, uint8_t* vram, uint8_t* oam, FnDisplayPixelWrite pixelWriteFn, void* userData);
+    void BootPPU(PPU& ppu, uint8_t* vram, uint8_t* oam);
     void TickPPU(PPU& ppu, MMU& mmu, PeripheralIO& pIO);
+
+    // Lets the PPU know one of its registers is about to be written, or has just been written if it couldn't be told before
+    void NotifyPPURegisterWrite(PPU& ppu, uint16_t address);
+
+    // Has batched scanlines read tile data through the cache, null goes back to decoding it every time
+    // VRAM gets remapped for the cache to see CPU writes to tile data, anything else writing to VRAM has to invalidate it
+    void SetPPUTileCache(PPU& ppu, MMU& mmu, TileCache* cache);
+
+    // Scanlines only get written out once a framebuffer is set, which has to fit all of the screen
+    void SetPPUFramebuffer(PPU& ppu, const PPUFramebuffer& framebuffer);
+
+    // Scanline hook gets called once a scanline is in the framebuffer, frame hook once the last one is, when VBlank starts
+    // Either can be null
+    void SetPPUOutputHooks(PPU& ppu, FnScanlineHook scanlineFn, FnFrameHook frameFn, void* userData);
+
+    // Skips that many frames after each one that gets rendered, starting with the next frame, the one being drawn is left alone
+    // Scanline hooks only get called for rendered frames, frame hooks for every frame
+    void SetPPUFrameSkip(PPU& ppu, uint32_t skippedFrames);
+
+    // Gets called whenever a visible scanline enters HBlank, once VRAM is accessible again
+    void SetPPUHBlankHook(PPU& ppu, FnHBlankHook hblankFn, void* userData);
+
+    // Advances the PPU by a number of dots, skipping over dots without any work in bulk
+    // Returns the number of dots until the PPU needs to be advanced again, or 0 if it stays idle until one of its registers is written
+    uint32_t AdvancePPU(PPU& ppu, MMU& mmu, PeripheralIO& pIO, uint32_t cycles);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.hpp"
+#include "MMU.hpp"
 #include <cstddef>
 
 namespace emu::SM83
@@ -58,7 +59,7 @@ namespace emu::SM83
     };
 
     // Arithmetic Logic Unit (8 bit)
-    enum class ALUOp
+    enum class ALUOp : uint8_t
     {
         Add = 0,
         Adc,
@@ -123,7 +124,7 @@ namespace emu::SM83
     };
 
     // Increment Decrement Unit (16 bit)
-    enum class IDUOp
+    enum class IDUOp : uint8_t
     {
         Inc = 0,
         Dec,
@@ -235,6 +236,44 @@ namespace emu::SM83
         Misc _misc;
     };
 
+    // Predecoded form of an MCycle, as consumed by the decoder at runtime
+    // The fetch cycle overlapping an instruction's last MCycle is already merged in, and flags mark which phases have work to do
+    struct MicroOp
+    {
+        enum Flags : uint16_t
+        {
+            UOF_None = 0x0,
+            UOF_LastCycle = 0x01,
+            UOF_MemRead = 0x02,
+            UOF_MemWrite = 0x04,
+            UOF_UseOffsetAddress = 0x08,
+            UOF_TrackSignBit = 0x10,    // Memory read into Z, track its sign bit for relative jumps
+            UOF_ALU = 0x20,
+            UOF_IDU = 0x40,
+            UOF_Misc = 0x80,            // Register writes, interrupt enable changes and condition checks
+            UOF_PrefixCB = 0x100,
+            UOF_StopOrHalt = 0x200,
+        };
+
+        uint16_t _flags;
+        uint16_t _miscFlags;
+        uint16_t _miscValue;
+
+        ALUOp _aluOp;
+        RegisterOperand _aluOperandA;
+        RegisterOperand _aluOperandB;
+        RegisterOperand _aluDest;
+
+        IDUOp _iduOp;
+        RegisterOperand _iduOperand;
+        RegisterOperand _iduDest;
+
+        RegisterOperand _memReg;
+        RegisterOperand _memAddressSrc;
+        RegisterOperand _miscOperand;
+    };
+    static_assert(sizeof(MicroOp) == 16);
+
     enum TCycleState
     {
         T1_0 = 0,
@@ -265,9 +304,10 @@ namespace emu::SM83
 
         uint8_t _flags;
         uint8_t _nextMCycleIndex;
+        uint8_t _stepMCycle;            // MCycle of the instruction StepCPU is at, for IO handlers that need to know when an access happens
         TCycleState _tCycleState;
 
-        MCycle _currMCycle;
+        const MicroOp* _currOp;
         InstructionTable _table;
     };
 
@@ -343,22 +383,119 @@ namespace emu::SM83
     };
     static_assert(sizeof(PeripheralIO) == 256);
 
+    // DIV and TIMA are only brought up to date when their registers get accessed, or when TIMA overflows
+    struct Timer
+    {
+        uint32_t _syncCycle;        // CPU T-cycle the registers were last updated at
+        uint32_t _overflowCycles;   // T-cycles from _syncCycle until TIMA overflows, UINT32_MAX while it's disabled
+    };
+
+    // For components outside of the CPU that own registers on the IO page
+    struct IOWriteHandler
+    {
+        MMIOWriteFn _write = nullptr;
+        void* _context = nullptr;
+    };
+
+    // Lets a component that only gets caught up now and then bring itself up to date right before the CPU accesses its registers
+    using IOSyncFn = void (*)(void* context, uint16_t address, bool write);
+
+    struct IOSyncHandler
+    {
+        IOSyncFn _sync = nullptr;
+        void* _context = nullptr;
+    };
+
     struct CPU
     {
         IO _io;
         Registers _registers;
         Decoder _decoder;
         PeripheralIO _peripheralIO;
+        Timer _timer;
 
         uint8_t _bootROM[256];
         uint32_t _tcycle;
+        uint32_t _stallCycles;      // T-cycles DMA still keeps the CPU off the bus for
+
+        IOWriteHandler _ioWriteHandlers[sizeof(PeripheralIO)] = {};
+        IOSyncHandler _ioSyncHandlers[sizeof(PeripheralIO)] = {};
     };
 
-    struct MMU;
+    // The CPU can either be ticked T-cycle by T-cycle, or stepped a whole instruction at a time
+    // Both work on the same state, so switching between them is possible at any instruction boundary
+    enum class ExecutionMode : uint8_t
+    {
+        CycleAccurate,  // TickCPU
+        Instruction,    // StepCPU
+        Compiled,       // StepCPUCompiled, runs translated blocks of ROM code where it can (see JIT.hpp)
+    };
 
     void BootCPU(CPU& cpu, uint16_t initSP, uint16_t initPC, uint8_t initBootCtrl = 0);
+    // Also puts the boot ROM over $0000 - $00FF if the CPU boots through it, the mapping below stays as is
     void MapPeripheralIOMemory(CPU& cpu, MMU& mmu);
+
+    // Gets called after the CPU wrote to the register at the given address, once the write took effect
+    void SetIOWriteHandler(CPU& cpu, uint16_t address, MMIOWriteFn handler, void* context);
+
+    // Gets called before the CPU reads or writes the register at the given address
+    void SetIOSyncHandler(CPU& cpu, uint16_t address, IOSyncFn handler, void* context);
     void TickCPU(CPU& cpu, MMU& mmu, uint32_t cycles);
 
+    // Keeps the CPU from running for that many T-cycles on top of any stall already going on, the timer still runs meanwhile
+    // Ticking eats into the stall before running anything, stepping takes all of it in one go
+    inline void StallCPU(CPU& cpu, uint32_t cycles)
+    {
+        cpu._stallCycles += cycles;
+    }
+
+    // Catches DIV and TIMA up to the current cycle, for anything looking at the timer registers without going through the MMU
+    void SyncTimer(CPU& cpu);
+
+    // T-cycles until the timer raises its interrupt, counting the T-cycle it happens in
+    // UINT32_MAX if the timer can't interrupt the CPU, because it's disabled or its interrupt isn't enabled
+    uint32_t GetCyclesUntilTimerInterrupt(const CPU& cpu);
+
+    // Steps check for interrupts as they finish, an interrupt raised from outside the CPU during the step's last MCycle
+    // only gets seen by that check if it gets repeated once the interrupt is in IF. Does nothing if one is already being dispatched
+    void RecheckInterrupts(CPU& cpu);
+
+    // Executes the next instruction (or interrupt dispatch) in one go, returns the number of T-cycles it took
+    // Memory accesses happen in order, but everything else only gets to observe them once the instruction is done
+    uint32_t StepCPU(CPU& cpu, MMU& mmu);
+
+    // True if no MCycle of the instruction in IR has run yet
+    inline bool IsAtInstructionBoundary(const CPU& cpu)
+    {
+        return cpu._decoder._tCycleState == T1_0 && cpu._decoder._nextMCycleIndex == 0;
+    }
+
+    // True while the CPU sits in HALT, waiting for an interrupt
+    inline bool IsHalted(const CPU& cpu)
+    {
+        return (cpu._decoder._flags & (Decoder::DF_ExecutionStopped | Decoder::DF_ExecutionHalted)) == Decoder::DF_ExecutionHalted;
+    }
+
+    // Lets up to maxCycles pass on a halted CPU in one go, stopping early at the MCycle the timer interrupt would wake it up in
+    // Only valid while nothing else raises an interrupt in that time, returns the T-cycles skipped (0 if the CPU isn't halted)
+    // The result is the same as ticking or stepping the CPU for as long
+    uint32_t SkipHaltedCycles(CPU& cpu, uint32_t maxCycles);
+
+    // Returns true if the next T-cycle will put a memory write on the bus, along with the address being written to
+    // Writes are put on the bus in the T-cycle covering T2_0 and T2_1. Queried every cycle, so this lives in the header
+    inline bool PeekPendingMemWrite(const CPU& cpu, uint16_t& address)
+    {
+        const Decoder& decoder = cpu._decoder;
+        if ((decoder._flags & (Decoder::DF_ExecutionStopped | Decoder::DF_ExecutionHalted)) ||
+            decoder._tCycleState != T2_0 ||
+            !(decoder._currOp->_flags & MicroOp::UOF_MemWrite))
+        {
+            return false;
+        }
+
+        address = cpu._io._address;
+        return true;
+    }
+
     const char* GetOpcodeName(InstructionTable table, uint8_t opCode);
 }
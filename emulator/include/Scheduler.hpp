@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace emu::SM83
+{
+    enum class SchedulerEvent : uint8_t
+    {
+        PPU = 0,
+        OAMDMA,
+
+        Count
+    };
+
+    constexpr const uint64_t SCHEDULER_NEVER = ~uint64_t(0);
+    constexpr const uint32_t CYCLES_PER_FRAME = 456 * 154;
+
+    // Central event queue keyed on the master cycle counter
+    // Every component registers the cycle at which it next has work to do, and only gets serviced once that cycle is reached
+    // Each event also remembers up to which cycle its component has been brought up to date, so components can catch up in bulk
+    // The queue is consulted on every cycle, so everything except resetting lives in the header
+    struct Scheduler
+    {
+        uint64_t _currCycle = 0;
+        uint64_t _nextDeadline = SCHEDULER_NEVER;
+
+        uint64_t _deadlines[uint32_t(SchedulerEvent::Count)] = {};
+        uint64_t _syncCycles[uint32_t(SchedulerEvent::Count)] = {};
+    };
+
+    void ResetScheduler(Scheduler& sched);
+
+    inline void ScheduleEvent(Scheduler& sched, SchedulerEvent event, uint64_t cycle)
+    {
+        sched._deadlines[uint32_t(event)] = cycle;
+
+        sched._nextDeadline = SCHEDULER_NEVER;
+        for (uint64_t deadline : sched._deadlines)
+        {
+            sched._nextDeadline = (deadline < sched._nextDeadline) ? deadline : sched._nextDeadline;
+        }
+    }
+
+    inline void CancelEvent(Scheduler& sched, SchedulerEvent event)
+    {
+        ScheduleEvent(sched, event, SCHEDULER_NEVER);
+    }
+
+    inline bool AnyEventDue(const Scheduler& sched)
+    {
+        return sched._currCycle >= sched._nextDeadline;
+    }
+
+    inline bool IsEventDue(const Scheduler& sched, SchedulerEvent event)
+    {
+        return sched._currCycle >= sched._deadlines[uint32_t(event)];
+    }
+
+    // Marks the component behind an event as up to date until (but not including) the target cycle
+    // Returns the number of cycles the component needs to catch up on
+    inline uint64_t SyncEvent(Scheduler& sched, SchedulerEvent event, uint64_t targetCycle)
+    {
+        uint64_t& syncCycle = sched._syncCycles[uint32_t(event)];
+        EMU_ASSERT(targetCycle >= syncCycle);
+
+        uint64_t elapsed = targetCycle - syncCycle;
+        syncCycle = targetCycle;
+        return elapsed;
+    }
+
+    inline void AdvanceScheduler(Scheduler& sched, uint64_t cycles)
+    {
+        sched._currCycle += cycles;
+    }
+}
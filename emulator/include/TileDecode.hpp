@@ -0,0 +1,27 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace emu::SM83
+{
+    enum class TileDecodeKernel
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        Count
+    };
+
+    // SSE2 is always there on x86-64, AVX2 depends on the CPU and OS
+    bool IsTileDecodeKernelSupported(TileDecodeKernel kernel);
+
+    // Widest kernel the machine supports, only checked once
+    TileDecodeKernel GetTileDecodeKernel();
+
+    // Turns rows of 2bpp tile data into one colour index (0-3) per pixel, leftmost pixel first unless flipped
+    // Each row is its low bitplane byte followed by its high one, the way they are laid out in VRAM, and produces 8 indices
+    void DecodeTileRows(TileDecodeKernel kernel, const uint8_t* rows, uint32_t rowCount, bool xFlip, uint8_t* indices);
+
+    // Looks colour indices up in a DMG palette register (BGP, OBP0 or OBP1), indices and colors may be the same buffer
+    void ApplyPalette(TileDecodeKernel kernel, const uint8_t* indices, uint32_t count, uint8_t palette, uint8_t* colors);
+}
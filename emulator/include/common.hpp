@@ -8,6 +8,10 @@
     #define EMU_COMPILER_CLANG 1
     #define EMU_COMPILER_NAME "Clang"
 
+#elif defined (__GNUC__)
+    #define EMU_COMPILER_GCC 1
+    #define EMU_COMPILER_NAME "GCC"
+
 #elif defined (_MSC_VER)
     #define EMU_COMPILER_MSVC 1
     #define EMU_COMPILER_NAME "MSVC"
@@ -20,6 +24,10 @@
     #define EMU_COMPILER_CLANG 0
 #endif
 
+#if !defined (EMU_COMPILER_GCC)
+    #define EMU_COMPILER_GCC 0
+#endif
+
 #if !defined (EMU_COMPILER_MSVC)
     #define EMU_COMPILER_MSVC 0
 #endif
@@ -29,26 +37,44 @@
     #define EMU_PLATFORM_WINDOWS 1
     #define EMU_PLATFORM_DESKTOP 1
     #define EMU_PLATFORM_NAME "Windows"
+
+#elif defined(__linux__)
+    #define EMU_PLATFORM_LINUX 1
+    #define EMU_PLATFORM_DESKTOP 1
+    #define EMU_PLATFORM_NAME "Linux"
 #endif
 
 #if !defined(EMU_PLATFORM_WINDOWS)
     #define EMU_PLATFORM_WINDOWS 0
 #endif
 
+#if !defined(EMU_PLATFORM_LINUX)
+    #define EMU_PLATFORM_LINUX 0
+#endif
+
 #if !defined(EMU_PLATFORM_DESKTOP)
     #define EMU_PLATFORM_DESKTOP 0
 #endif
 
+// Architecture defines
+#if defined(_M_X64) || defined(__x86_64__)
+    #define EMU_ARCH_X64 1
+#endif
+
+#if !defined(EMU_ARCH_X64)
+    #define EMU_ARCH_X64 0
+#endif
+
 
 // Common macros
-#if EMU_COMPILER_CLANG
+#if EMU_COMPILER_CLANG || EMU_COMPILER_GCC
     #include <signal.h>
 #endif
 
 #if EMU_COMPILER_MSVC
     #define EMU_DEBUG_BREAK() __debugbreak()
 
-#elif EMU_COMPILER_CLANG
+#elif EMU_COMPILER_CLANG || EMU_COMPILER_GCC
     #define EMU_DEBUG_BREAK() raise(SIGTRAP)
 
 #endif
@@ -21,6 +21,11 @@ project "emulator"
         "include"
     }
 
+    -- The opcode tables are built by constexpr evaluation, which takes more steps than MSVC allows by default
+    filter "toolset:msc*"
+        buildoptions { "/constexpr:steps4000000" }
+    filter {}
+
     libdirs {
         "%{wks.location}/%{cfg.buildcfg}"
     }
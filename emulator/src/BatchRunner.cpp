@@ -0,0 +1,233 @@
+#include "BatchRunner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace emu::SM83
+{
+    namespace
+    {
+        // Slices are long enough that a lock per pop doesn't show up next to running them
+        struct WorkerQueue
+        {
+            std::mutex _lock;
+            std::deque<uint32_t> _jobs;
+        };
+
+        struct BatchContext
+        {
+            BatchJob* _jobs = nullptr;
+            std::unique_ptr<std::unique_ptr<GameBoy>[]> _instances;   // Only around while their job is in progress
+            std::unique_ptr<WorkerQueue[]> _queues;
+            uint32_t _workerCount = 0;
+
+            std::atomic<uint32_t> _remainingJobs = 0;
+            std::atomic<uint32_t> _steals = 0;
+
+            // Workers with nothing to pop or steal sleep until a job gets pushed back or the last one is done
+            // Pushing only takes the lock to wake one up while there are any asleep, it's off the hot path otherwise
+            std::atomic<uint32_t> _queuedJobs = 0;    // Across all queues
+            std::atomic<uint32_t> _sleepingWorkers = 0;
+            std::mutex _idleLock;
+            std::condition_variable _idleWait;
+        };
+
+        // The owner works from the back, so it keeps going with the job it just ran a slice of
+        bool PopJob(BatchContext& ctxt, WorkerQueue& queue, uint32_t& jobIdx)
+        {
+            std::lock_guard<std::mutex> lock(queue._lock);
+            if (queue._jobs.empty())
+            {
+                return false;
+            }
+
+            jobIdx = queue._jobs.back();
+            queue._jobs.pop_back();
+            ctxt._queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        void PushJob(BatchContext& ctxt, WorkerQueue& queue, uint32_t jobIdx)
+        {
+            // Counted before it's in the queue, so the count never drops below what's actually in there
+            ctxt._queuedJobs.fetch_add(1);
+            {
+                std::lock_guard<std::mutex> lock(queue._lock);
+                queue._jobs.push_back(jobIdx);
+            }
+
+            // Sleepers count themselves before checking for queued jobs, so either they see this one or it sees them
+            if (ctxt._sleepingWorkers.load() > 0)
+            {
+                std::lock_guard<std::mutex> lock(ctxt._idleLock);
+                ctxt._idleWait.notify_one();
+            }
+        }
+
+        // Thieves take from the front, where the jobs nobody has started yet are
+        bool StealJob(BatchContext& ctxt, uint32_t workerIdx, uint32_t& jobIdx)
+        {
+            for (uint32_t i = 1; i < ctxt._workerCount; ++i)
+            {
+                WorkerQueue& victim = ctxt._queues[(workerIdx + i) % ctxt._workerCount];
+
+                std::lock_guard<std::mutex> lock(victim._lock);
+                if (!victim._jobs.empty())
+                {
+                    jobIdx = victim._jobs.front();
+                    victim._jobs.pop_front();
+                    ctxt._queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                    ctxt._steals.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // Returns true once the job is done, whether it ran to the end or never got to boot
+        bool RunJobSlice(BatchContext& ctxt, uint32_t jobIdx)
+        {
+            BatchJob& job = ctxt._jobs[jobIdx];
+            std::unique_ptr<GameBoy>& gb = ctxt._instances[jobIdx];
+
+            if (!gb)
+            {
+                gb = std::make_unique<GameBoy>();
+                job._booted = BootGameBoy(*gb, job._rom, job._romSize, job._mode);
+                if (!job._booted)
+                {
+                    gb.reset();
+                    return true;
+                }
+
+                if (job._onBoot)
+                {
+                    job._onBoot(job._userData, *gb);
+                }
+            }
+
+            // Whole instructions can take a run past the end, RunCycles makes up for it on the next slice
+            const uint64_t targetCycle = gb->_targetCycle;
+            const uint64_t sliceCycles = std::min(job._cycles - std::min(targetCycle, job._cycles), BATCH_SLICE_CYCLES);
+            if (job._predicate)
+            {
+                job._predicateMet = RunUntil(*gb, job._predicate, job._userData, sliceCycles);
+            }
+            else
+            {
+                RunCycles(*gb, sliceCycles);
+            }
+
+            job._cyclesRun = gb->_sched._currCycle;
+            if (!job._predicateMet && job._cyclesRun < job._cycles)
+            {
+                return false;
+            }
+
+            if (job._onFinish)
+            {
+                job._onFinish(job._userData, *gb);
+            }
+
+            DestroyGameBoy(*gb);
+            gb.reset();
+            return true;
+        }
+
+        void RunWorker(BatchContext& ctxt, uint32_t workerIdx)
+        {
+            WorkerQueue& queue = ctxt._queues[workerIdx];
+            while (ctxt._remainingJobs.load(std::memory_order_acquire) > 0)
+            {
+                uint32_t jobIdx = 0;
+                if (!PopJob(ctxt, queue, jobIdx) && !StealJob(ctxt, workerIdx, jobIdx))
+                {
+                    // The last jobs are still in progress on other workers, they get pushed back after every slice
+                    std::unique_lock<std::mutex> lock(ctxt._idleLock);
+                    ctxt._sleepingWorkers.fetch_add(1);
+                    ctxt._idleWait.wait(lock, [&ctxt]
+                    {
+                        return ctxt._remainingJobs.load(std::memory_order_acquire) == 0 || ctxt._queuedJobs.load() > 0;
+                    });
+
+                    ctxt._sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (!RunJobSlice(ctxt, jobIdx))
+                {
+                    PushJob(ctxt, queue, jobIdx);
+                }
+                else if (ctxt._remainingJobs.fetch_sub(1, std::memory_order_release) == 1)
+                {
+                    // Under the lock, so a worker that just found nothing to do can't miss it before it starts waiting
+                    std::lock_guard<std::mutex> lock(ctxt._idleLock);
+                    ctxt._idleWait.notify_all();
+                }
+            }
+        }
+    }
+
+    BatchStats RunBatch(BatchJob* jobs, uint32_t jobCount, uint32_t workerCount)
+    {
+        EMU_ASSERT(jobs || jobCount == 0);
+
+        if (workerCount == 0)
+        {
+            workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        BatchContext ctxt;
+        ctxt._jobs = jobs;
+        ctxt._instances = std::make_unique<std::unique_ptr<GameBoy>[]>(jobCount);
+        ctxt._workerCount = std::max(std::min(workerCount, jobCount), 1u);
+        ctxt._queues = std::make_unique<WorkerQueue[]>(ctxt._workerCount);
+        ctxt._remainingJobs = jobCount;
+        ctxt._queuedJobs = jobCount;
+
+        // Dealt out like cards, stealing takes care of jobs that turn out to be shorter than others
+        for (uint32_t i = 0; i < jobCount; ++i)
+        {
+            jobs[i]._cyclesRun = 0;
+            jobs[i]._booted = false;
+            jobs[i]._predicateMet = false;
+            ctxt._queues[i % ctxt._workerCount]._jobs.push_front(i);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        // The calling thread is the first worker
+        std::vector<std::thread> threads;
+        for (uint32_t i = 1; i < ctxt._workerCount; ++i)
+        {
+            threads.emplace_back(RunWorker, std::ref(ctxt), i);
+        }
+
+        RunWorker(ctxt, 0);
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        BatchStats stats;
+        stats._workerCount = ctxt._workerCount;
+        stats._steals = ctxt._steals.load();
+        stats._seconds = std::chrono::duration<double>(end - start).count();
+        for (uint32_t i = 0; i < jobCount; ++i)
+        {
+            stats._cycles += jobs[i]._cyclesRun;
+        }
+
+        return stats;
+    }
+}
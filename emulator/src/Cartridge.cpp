@@ -7,6 +7,7 @@ namespace emu::SM83
     {
         enum CartAddresses
         {
+            ADDR_CGB_FLAG =         0x0143,
             ADDR_CART_TYPE =        0x0147,
             ADDR_ROM_SIZE =         0x0148,
             ADDR_RAM_SIZE =         0x0149,
@@ -179,14 +180,26 @@ namespace emu::SM83
         return true;
     }
 
-    void MapCartridgeROM(Cartridge& cart, MMU& mmu)
+    bool IsCGBCartridge(const Cartridge& cart)
     {
-        MapMemoryRegion(mmu, 0x0000, 16 * 1024, cart._rom, MMRF_ReadOnly);
-        MapMemoryRegion(mmu, 0x4000, 16 * 1024, cart._rom + 16 * 1024, MMRF_ReadOnly);
+        EMU_ASSERT(cart._rom);
+        return (cart._rom[ADDR_CGB_FLAG] & 0x80) != 0;
     }
 
     namespace
     {
+        void WriteMBC(void* context, MMU& mmu, uint16_t address, uint8_t val);
+
+        // Bank switches happen through writes to ROM, so every ROM mapping comes with the MBC's handler
+        void MapROMBank(Cartridge& cart, MMU& mmu, uint16_t address, uint8_t* romPtr)
+        {
+            MMIOHandler handler;
+            handler._write = WriteMBC;
+            handler._context = &cart;
+
+            bool hasMBC = cart._mbc._type != MBCType::None;
+            MapMemoryRegion(mmu, address, 16 * 1024, romPtr, MMRF_ReadOnly, hasMBC ? &handler : nullptr);
+        }
 
         enum
         {
@@ -205,91 +218,93 @@ namespace emu::SM83
             MBC1_REG_BANK_MODE_END =    0x7FFF
         };
 
-        void TickMBC1(Cartridge& cart, MMU& mmu)
+        void WriteMBC1(Cartridge& cart, MMU& mmu, uint16_t address, uint8_t val)
         {
             MBC& mbc = cart._mbc;
-            if (mmu._RW == MMU_WRITE)
+
+            // Check for RAM enable writes
+            if (address >= MBC1_REG_RAM_ENABLE_BEGIN &&
+                address <= MBC1_REG_RAM_ENABLED_END)
             {
-                // Check for RAM enable writes
-                if (mmu._address >= MBC1_REG_RAM_ENABLE_BEGIN &&
-                    mmu._address <= MBC1_REG_RAM_ENABLED_END)
+                if (mbc._MBC1._RAMEnable != (val & 0xF))
                 {
-                    if (mbc._MBC1._RAMEnable != (mmu._data & 0xF))
+                    mbc._MBC1._RAMEnable = val & 0xF;
+                    if (mbc._MBC1._RAMEnable == MBC1_REG_RAM_ENABLED)
                     {
-                        mbc._MBC1._RAMEnable = mmu._data & 0xF;
-                        if (mbc._MBC1._RAMEnable == MBC1_REG_RAM_ENABLED)
-                        {
-                            uint8_t* ramPtr = cart._ram.get() + (8 * 1024) * mbc._MBC1._RAMBankNumber;
-                            MapMemoryRegion(mmu, 0xA000, 8 * 1024, ramPtr, 0);
-                        }
-                        else
-                        {
-                            UnmapMemoryRegion(mmu, 0xA000, 8 * 1024);
-                        }
+                        uint8_t* ramPtr = cart._ram.get() + (8 * 1024) * mbc._MBC1._RAMBankNumber;
+                        MapMemoryRegion(mmu, 0xA000, 8 * 1024, ramPtr, 0);
                     }
-                }
-
-                // Check for ROM bank number writes
-                else if (mmu._address >= MBC1_REG_ROM_BANK_BEGIN &&
-                         mmu._address <= MBC1_REG_ROM_BANK_END)
-                {
-                    uint8_t bankNumber = mmu._data & 0x1F;
-                    if (bankNumber == 0)
+                    else
                     {
-                        bankNumber = 1;
+                        UnmapMemoryRegion(mmu, 0xA000, 8 * 1024);
                     }
+                }
+            }
 
-                    uint32_t romBankCount = cart._romSize / (16 * 1024);
-
-                    if (bankNumber < romBankCount &&
-                        bankNumber != mbc._MBC1._ROMBankNumber)
-                    {
-                        mbc._MBC1._ROMBankNumber = bankNumber;
-                        uint8_t* romPtr = cart._rom + (16 * 1024) * mbc._MBC1._ROMBankNumber;
-                        MapMemoryRegion(mmu, 0x4000, 16 * 1024, romPtr, MMRF_ReadOnly);
-                    }
+            // Check for ROM bank number writes
+            else if (address >= MBC1_REG_ROM_BANK_BEGIN &&
+                     address <= MBC1_REG_ROM_BANK_END)
+            {
+                uint8_t bankNumber = val & 0x1F;
+                if (bankNumber == 0)
+                {
+                    bankNumber = 1;
                 }
 
-                // Check for RAM bank number writes
-                else if (mmu._address >= MBC1_REG_RAM_BANK_BEGIN &&
-                         mmu._address <= MBC1_REG_RAM_BANK_END)
+                uint32_t romBankCount = cart._romSize / (16 * 1024);
+
+                if (bankNumber < romBankCount &&
+                    bankNumber != mbc._MBC1._ROMBankNumber)
                 {
-                    uint8_t bankNumber = mmu._data & 0x03;
-                    if (bankNumber < cart._ramBankCount &&
-                        bankNumber != mbc._MBC1._RAMBankNumber)
-                    {
-                        mbc._MBC1._RAMBankNumber = bankNumber;
-                        uint8_t* ramPtr = cart._ram.get() + (8 * 1024) * mbc._MBC1._RAMBankNumber;
-                        MapMemoryRegion(mmu, 0xA000, 8 * 1024, ramPtr, 0);
-                    }
+                    mbc._MBC1._ROMBankNumber = bankNumber;
+                    uint8_t* romPtr = cart._rom + (16 * 1024) * mbc._MBC1._ROMBankNumber;
+                    MapROMBank(cart, mmu, 0x4000, romPtr);
                 }
+            }
 
-                // Check for RAM bank number writes
-                else if (mmu._address >= MBC1_REG_BANK_MODE_BEGIN &&
-                         mmu._address <= MBC1_REG_BANK_MODE_END)
+            // Check for RAM bank number writes
+            else if (address >= MBC1_REG_RAM_BANK_BEGIN &&
+                     address <= MBC1_REG_RAM_BANK_END)
+            {
+                uint8_t bankNumber = val & 0x03;
+                if (bankNumber < cart._ramBankCount &&
+                    bankNumber != mbc._MBC1._RAMBankNumber)
                 {
-                    mbc._MBC1._BankModeSelect = mmu._data & 0x1;
+                    mbc._MBC1._RAMBankNumber = bankNumber;
+                    uint8_t* ramPtr = cart._ram.get() + (8 * 1024) * mbc._MBC1._RAMBankNumber;
+                    MapMemoryRegion(mmu, 0xA000, 8 * 1024, ramPtr, 0);
                 }
             }
+
+            // Check for RAM bank number writes
+            else if (address >= MBC1_REG_BANK_MODE_BEGIN &&
+                     address <= MBC1_REG_BANK_MODE_END)
+            {
+                mbc._MBC1._BankModeSelect = val & 0x1;
+            }
         }
-    }
 
-    void TickMBC(Cartridge& cart, MMU& mmu)
-    {
-        switch (cart._mbc._type)
+        void WriteMBC(void* context, MMU& mmu, uint16_t address, uint8_t val)
         {
-        case MBCType::None:
-            break;
+            Cartridge& cart = *static_cast<Cartridge*>(context);
+            switch (cart._mbc._type)
+            {
+            case MBCType::MBC1:
+            {
+                WriteMBC1(cart, mmu, address, val);
+            }
+                break;
 
-        case MBCType::MBC1:
-        {
-            TickMBC1(cart, mmu);
-        }
-            break;
-        
-        default:
-            EMU_ASSERT(0 && "MBC type not supported!");
-            break;
+            default:
+                EMU_ASSERT(0 && "MBC type not supported!");
+                break;
+            }
         }
     }
+
+    void MapCartridgeROM(Cartridge& cart, MMU& mmu)
+    {
+        MapROMBank(cart, mmu, 0x0000, cart._rom);
+        MapROMBank(cart, mmu, 0x4000, cart._rom + 16 * 1024);
+    }
 }
\ No newline at end of file
@@ -1,128 +1,220 @@
 #include "DMA.hpp"
 #include "SM83.hpp"
 #include "MMU.hpp"
+#include "PPU.hpp"
+
+#include <algorithm>
+#include <cstring>
 
 namespace emu::SM83
 {
     namespace
     {
         constexpr const uint16_t DMA_CYCLE_DURATION = 640;
-
-        void LockMMURegionForDMA(MMU& mmu, uint16_t address, uint16_t size)
+        constexpr const uint16_t DMA_CYCLES_PER_BYTE = DMA_CYCLE_DURATION / OAM_DMA_LENGTH;
+        constexpr const uint16_t ADDR_OAM_DMA = 0xFF46;
+
+        constexpr const uint16_t VRAM_DMA_BLOCK_SIZE = 16;
+        constexpr const uint32_t VRAM_DMA_BLOCK_CYCLES = 32;   // 8 MCycles per block, double speed isn't emulated
+        constexpr const uint16_t ADDR_HDMA1 = 0xFF51;
+        constexpr const uint16_t ADDR_HDMA2 = 0xFF52;
+        constexpr const uint16_t ADDR_HDMA3 = 0xFF53;
+        constexpr const uint16_t ADDR_HDMA4 = 0xFF54;
+        constexpr const uint16_t ADDR_HDMA5 = 0xFF55;
+        constexpr const uint8_t BIT_HDMA_HBLANK = 0x80;
+        constexpr const uint8_t BIT_LCD_ENABLE = 0x80;
+
+        void WriteOAMDMARegister(void* context, MMU&, uint16_t, uint8_t val)
         {
-            EMU_ASSERT((address % MMU_SEGMENT_SIZE) == 0);
-            EMU_ASSERT(size > 0 && (size % MMU_SEGMENT_SIZE) == 0);
-            EMU_ASSERT(uint32_t(address) + size <= 0x10000);
-
-            uint16_t startSegment = address / MMU_SEGMENT_SIZE;
-            uint16_t numSegments = size / MMU_SEGMENT_SIZE;
+            DMACtrl& dma = *static_cast<DMACtrl*>(context);
+            dma._startPending = 1;
+            dma._sourcePage = val;
+        }
 
-            for (uint16_t i = 0; i < numSegments; ++i)
+        void StartOAMDMA(DMACtrl& dma, MMU& mmu)
+        {
+            // A page never straddles two mappings, so the whole source comes from the same place
+            // Video memory the PPU is using reads as 0xFF, same as it would for the CPU
+            uint16_t sourceAddress = uint16_t(dma._sourcePage) << 8;
+            const uint8_t* source = IsVideoLocked(mmu, sourceAddress) ? nullptr : GetMappedMemory(mmu, sourceAddress);
+            if (source)
+            {
+                std::memcpy(dma._source, source, OAM_DMA_LENGTH);
+            }
+            else
             {
-                mmu._segmentFlags[startSegment + i] |= MMRF_DMALock;
+                std::memset(dma._source, 0xFF, OAM_DMA_LENGTH);
             }
+
+            bool videoSource = sourceAddress >= 0x8000 && sourceAddress < 0xA000;
+            LockBus(mmu, videoSource ? MMUBus::Video : MMUBus::External);
+
+            dma._dmaActive = 1;
+            dma._dmaCycles = 0;
+            dma._startPending = 0;
+        }
+
+        void UpdateHDMA5(VRAMDMACtrl& dma)
+        {
+            // Blocks left minus one, bit 7 stays clear while an HBlank transfer is running
+            uint8_t status = dma._hblankActive ? 0x00 : 0x80;
+            dma._cpu->_peripheralIO.HDMA5 = status | (uint8_t(dma._blocksLeft - 1) & 0x7F);
         }
 
-        void UnlockMMURegionForDMA(MMU& mmu, uint16_t address, uint16_t size)
+        // Blocks are 16 byte aligned, so each one comes from a single page
+        void CopyVRAMDMABlock(VRAMDMACtrl& dma, const MMU& mmu)
         {
-            EMU_ASSERT((address % MMU_SEGMENT_SIZE) == 0);
-            EMU_ASSERT(size > 0 && (size % MMU_SEGMENT_SIZE) == 0);
-            EMU_ASSERT(uint32_t(address) + size <= 0x10000);
+            EMU_ASSERT(dma._blocksLeft > 0);
 
-            uint16_t startSegment = address / MMU_SEGMENT_SIZE;
-            uint16_t numSegments = size / MMU_SEGMENT_SIZE;
+            const uint8_t* source = IsVideoLocked(mmu, dma._source) ? nullptr : GetMappedMemory(mmu, dma._source);
+            uint8_t* dest = dma._vram + dma._dest;
+            if (source)
+            {
+                std::memcpy(dest, source, VRAM_DMA_BLOCK_SIZE);
+            }
+            else
+            {
+                std::memset(dest, 0xFF, VRAM_DMA_BLOCK_SIZE);
+            }
 
-            for (uint16_t i = 0; i < numSegments; ++i)
+            if (dma._ppu->_tileCache)
             {
-                mmu._segmentFlags[startSegment + i] &= ~MMRF_DMALock;
+                InvalidateTileCache(*dma._ppu->_tileCache, uint16_t(0x8000 + dma._dest), VRAM_DMA_BLOCK_SIZE);
             }
+
+            dma._source += VRAM_DMA_BLOCK_SIZE;
+            dma._dest = (dma._dest + VRAM_DMA_BLOCK_SIZE) & 0x1FF0;
+            dma._blocksLeft--;
         }
 
-        void DMAWrite(MMU& mmu, uint16_t address, uint8_t val)
+        void CopyHBlankDMABlock(VRAMDMACtrl& dma, const MMU& mmu)
         {
-            EMU_ASSERT(address >= 0xFE00 && address < 0xFEA0);
+            CopyVRAMDMABlock(dma, mmu);
+            StallCPU(*dma._cpu, VRAM_DMA_BLOCK_CYCLES);
 
-            uint16_t segmentIdx = address / MMU_SEGMENT_SIZE;
-            if (mmu._segmentFlags[segmentIdx] & MMRF_Redirect)
+            dma._hblankActive = dma._blocksLeft != 0;
+            UpdateHDMA5(dma);
+        }
+
+        void StartVRAMDMA(VRAMDMACtrl& dma, const MMU& mmu, uint8_t val)
+        {
+            // Clearing bit 7 while an HBlank transfer runs stops it instead, what's left of it can still be read back
+            if (dma._hblankActive && !(val & BIT_HDMA_HBLANK))
             {
-                segmentIdx = MMU_SEGMENT_COUNT;
+                dma._hblankActive = 0;
+                UpdateHDMA5(dma);
+                return;
             }
 
-            if (mmu._segmentFlags[segmentIdx] & MMRF_ReadOnly ||
-                !mmu._segmentPtrs[segmentIdx])
+            dma._blocksLeft = (val & 0x7F) + 1;
+            if (val & BIT_HDMA_HBLANK)
             {
+                dma._hblankActive = 1;
+                UpdateHDMA5(dma);
+
+                // Nothing would happen until the next HBlank otherwise
+                bool displayEnabled = (dma._cpu->_peripheralIO.LCDC & BIT_LCD_ENABLE) != 0;
+                if (!displayEnabled || dma._ppu->_currMode == PPU::Mode::HBlank)
+                {
+                    CopyHBlankDMABlock(dma, mmu);
+                }
                 return;
             }
 
-            uint16_t offsetInSegment = address % MMU_SEGMENT_SIZE;
-            mmu._segmentPtrs[segmentIdx][offsetInSegment] = val;
+            // The CPU can't see any of it happening, so it's all copied at once
+            uint32_t cycles = dma._blocksLeft * VRAM_DMA_BLOCK_CYCLES;
+            while (dma._blocksLeft > 0)
+            {
+                CopyVRAMDMABlock(dma, mmu);
+            }
+
+            StallCPU(*dma._cpu, cycles);
+            UpdateHDMA5(dma);
         }
 
-        uint8_t DMARead(MMU& mmu, uint16_t address)
+        void WriteVRAMDMARegister(void* context, MMU& mmu, uint16_t address, uint8_t val)
         {
-            uint16_t segmentIdx = address / MMU_SEGMENT_SIZE;
-            if (mmu._segmentFlags[segmentIdx] & MMRF_Redirect)
+            VRAMDMACtrl& dma = *static_cast<VRAMDMACtrl*>(context);
+            const PeripheralIO& pIO = dma._cpu->_peripheralIO;
+            switch (address)
             {
-                segmentIdx = MMU_SEGMENT_COUNT;
+            case ADDR_HDMA1:
+            case ADDR_HDMA2:
+                dma._source = uint16_t((pIO.HDMA1 << 8) | pIO.HDMA2) & 0xFFF0;
+                break;
+            case ADDR_HDMA3:
+            case ADDR_HDMA4:
+                dma._dest = uint16_t((pIO.HDMA3 << 8) | pIO.HDMA4) & 0x1FF0;
+                break;
+            case ADDR_HDMA5:
+                StartVRAMDMA(dma, mmu, val);
+                break;
+            default:
+                break;
             }
+        }
 
-            if (!mmu._segmentPtrs[segmentIdx])
+        void OnPPUHBlank(void* context, MMU& mmu)
+        {
+            VRAMDMACtrl& dma = *static_cast<VRAMDMACtrl*>(context);
+            if (dma._hblankActive)
             {
-                return 0xFF;
+                CopyHBlankDMABlock(dma, mmu);
             }
-
-            uint16_t offsetInSegment = address % MMU_SEGMENT_SIZE;
-            return mmu._segmentPtrs[segmentIdx][offsetInSegment];
         }
-
     }
-    void TickOAMDMA(DMACtrl& dma, MMU& mmu, PeripheralIO& pIO)
-    {
-        if (pIO.OAM_DMA != dma._lastDMARegValue)
-        {
-            // Lock VRAM and OAM
-            LockMMURegionForDMA(mmu, 0x8000, 8 * 1024);
-            LockMMURegionForDMA(mmu, 0xFE00, 256);
 
-            // Lock work RAM + echo
-            LockMMURegionForDMA(mmu, 0xC000, 4 * 1024);
-            LockMMURegionForDMA(mmu, 0xD000, 4 * 1024);
-            LockMMURegionForDMA(mmu, 0xE000, 4 * 1024);  // Echo RAM
-            LockMMURegionForDMA(mmu, 0xF000, 4 * 1024);  // Echo RAM
+    void BootOAMDMA(DMACtrl& dma, CPU& cpu, uint8_t* oam)
+    {
+        EMU_ASSERT(oam);
 
-            dma._dmaActive = 1;
-            dma._dmaCycles = 0;
-            dma._lastDMARegValue = pIO.OAM_DMA;
-        }
+        dma = {};
+        dma._oam = oam;
+        SetIOWriteHandler(cpu, ADDR_OAM_DMA, WriteOAMDMARegister, &dma);
+    }
 
+    uint32_t AdvanceOAMDMA(DMACtrl& dma, MMU& mmu, uint32_t cycles)
+    {
         if (dma._dmaActive)
         {
-            if ((dma._dmaCycles % 4) == 0)
-            {
-                uint16_t src = (uint16_t(pIO.OAM_DMA) << 8) + (dma._dmaCycles / 4);
-                uint16_t dest = 0xFE00 + (dma._dmaCycles / 4);
-                DMAWrite(mmu, dest, DMARead(mmu, src));
-            }
-            
-            dma._dmaCycles++;
+            // Each byte lands on the first cycle of its 4
+            uint32_t endCycle = std::min<uint32_t>(dma._dmaCycles + cycles, DMA_CYCLE_DURATION);
+            uint32_t beginByte = (dma._dmaCycles + DMA_CYCLES_PER_BYTE - 1) / DMA_CYCLES_PER_BYTE;
+            uint32_t endByte = (endCycle + DMA_CYCLES_PER_BYTE - 1) / DMA_CYCLES_PER_BYTE;
+            std::memcpy(dma._oam + beginByte, dma._source + beginByte, endByte - beginByte);
 
+            dma._dmaCycles = uint16_t(endCycle);
             if (dma._dmaCycles >= DMA_CYCLE_DURATION)
             {
                 dma._dmaActive = 0;
                 dma._dmaCycles = 0;
-                dma._lastDMARegValue = 0;
-                pIO.OAM_DMA = 0;
-
-                // Unlock VRAM and OAM
-                UnlockMMURegionForDMA(mmu, 0x8000, 8 * 1024);
-                UnlockMMURegionForDMA(mmu, 0xFE00, 256);
-
-                // Unlock work RAM + echo
-                UnlockMMURegionForDMA(mmu, 0xC000, 4 * 1024);
-                UnlockMMURegionForDMA(mmu, 0xD000, 4 * 1024);
-                UnlockMMURegionForDMA(mmu, 0xE000, 4 * 1024);  // Echo RAM
-                UnlockMMURegionForDMA(mmu, 0xF000, 4 * 1024);  // Echo RAM
+                UnlockBus(mmu);
             }
         }
+
+        if (dma._startPending)
+        {
+            StartOAMDMA(dma, mmu);
+        }
+
+        return dma._dmaActive ? DMA_CYCLE_DURATION - dma._dmaCycles : 0;
+    }
+
+    void BootVRAMDMA(VRAMDMACtrl& dma, CPU& cpu, PPU& ppu)
+    {
+        EMU_ASSERT(ppu._vram);
+
+        dma = {};
+        dma._cpu = &cpu;
+        dma._ppu = &ppu;
+        dma._vram = ppu._vram;
+        UpdateHDMA5(dma);
+
+        for (uint16_t address = ADDR_HDMA1; address <= ADDR_HDMA5; ++address)
+        {
+            SetIOWriteHandler(cpu, address, WriteVRAMDMARegister, &dma);
+        }
+
+        SetPPUHBlankHook(ppu, OnPPUHBlank, &dma);
     }
 }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "GameBoy.hpp"
+#include "Interpreter.hpp"
+
+#include <algorithm>
+
+namespace emu::SM83
+{
+    namespace
+    {
+        constexpr const uint16_t ADDR_PPU_REGS_BEGIN = 0xFF40;
+        constexpr const uint16_t ADDR_PPU_REGS_END = 0xFF4B;
+        constexpr const uint16_t ADDR_OAM_DMA = 0xFF46;
+
+        void WritePPURegister(void* context, MMU&, uint16_t address, uint8_t)
+        {
+            GameBoy& gb = *static_cast<GameBoy*>(context);
+
+            // A scanline being drawn in one go has to switch to going dot by dot from here on
+            NotifyPPURegisterWrite(gb._ppu, address);
+        }
+
+        void ServiceOAMDMA(GameBoy& gb, uint64_t targetCycle)
+        {
+            uint64_t cycles = SyncEvent(gb._sched, SchedulerEvent::OAMDMA, targetCycle);
+            uint32_t remainingCycles = AdvanceOAMDMA(gb._dma, gb._mmu, uint32_t(std::min<uint64_t>(cycles, UINT32_MAX)));
+            ScheduleEvent(gb._sched, SchedulerEvent::OAMDMA, remainingCycles ? targetCycle + remainingCycles : SCHEDULER_NEVER);
+        }
+
+        void ServicePPU(GameBoy& gb, uint64_t targetCycle)
+        {
+            // The DMA only copies to OAM when serviced, so the PPU has to see it caught up first
+            if (gb._dma._dmaActive)
+            {
+                ServiceOAMDMA(gb, targetCycle);
+            }
+
+            uint64_t cycles = SyncEvent(gb._sched, SchedulerEvent::PPU, targetCycle);
+            uint32_t nextCycles = AdvancePPU(gb._ppu, gb._mmu, gb._cpu._peripheralIO, uint32_t(cycles));
+            ScheduleEvent(gb._sched, SchedulerEvent::PPU, nextCycles ? (targetCycle - 1) + nextCycles : SCHEDULER_NEVER);
+        }
+
+        // Outside of cycle accurate mode the PPU only catches up after each instruction, which is too late for LY, STAT or a write
+        // that turns the display on. The interpreter counts the MCycles of the instruction, which tells when the access happens
+        void SyncPPUForAccess(void* context, uint16_t, bool write)
+        {
+            GameBoy& gb = *static_cast<GameBoy*>(context);
+            if (gb._mode == ExecutionMode::CycleAccurate)
+            {
+                return;
+            }
+
+            // Same cycles as going T-cycle by T-cycle: reads happen at the start of their MCycle, writes one T-cycle later
+            Scheduler& sched = gb._sched;
+            uint64_t accessCycle = sched._currCycle + gb._cpu._decoder._stepMCycle * M_CYCLE_LENGTH;
+            if (write)
+            {
+                gb._ppuWriteCycle = accessCycle + 1;
+                ServicePPU(gb, gb._ppuWriteCycle);
+                ScheduleEvent(sched, SchedulerEvent::PPU, gb._ppuWriteCycle);
+            }
+            else if (sched._deadlines[uint32_t(SchedulerEvent::PPU)] < accessCycle)
+            {
+                ServicePPU(gb, accessCycle);
+            }
+        }
+
+        // OAM_DMA already has the DMA's handler, pending transfers are visible through it instead
+        void MapPPURegisters(GameBoy& gb)
+        {
+            for (uint16_t address = ADDR_PPU_REGS_BEGIN; address <= ADDR_PPU_REGS_END; ++address)
+            {
+                if (address != ADDR_OAM_DMA)
+                {
+                    SetIOWriteHandler(gb._cpu, address, WritePPURegister, &gb);
+                }
+
+                SetIOSyncHandler(gb._cpu, address, SyncPPUForAccess, &gb);
+            }
+        }
+
+        // Interrupts can only come from the timer or a scheduled event, so a halted CPU gets fast-forwarded up to whichever is first
+        // Returns the number of cycles skipped, the scheduler still has to be advanced by that much
+        uint32_t SkipHaltedCPU(GameBoy& gb, uint64_t endCycle)
+        {
+            const Scheduler& sched = gb._sched;
+            if (!IsHalted(gb._cpu) || AnyEventDue(sched))
+            {
+                return 0;
+            }
+
+            uint64_t maxCycles = std::min(sched._nextDeadline, endCycle) - sched._currCycle;
+            return SkipHaltedCycles(gb._cpu, uint32_t(std::min<uint64_t>(maxCycles, UINT32_MAX)));
+        }
+
+        void RunScheduledCycles(GameBoy& gb, uint32_t cycles)
+        {
+            Scheduler& sched = gb._sched;
+            for (uint32_t i = 0; i < cycles; ++i)
+            {
+                const uint64_t currCycle = sched._currCycle;
+
+                uint32_t skippedCycles = SkipHaltedCPU(gb, currCycle + (cycles - i));
+                if (skippedCycles)
+                {
+                    AdvanceScheduler(sched, skippedCycles);
+                    i += skippedCycles - 1;
+                    continue;
+                }
+
+                bool anyEventDue = AnyEventDue(sched);
+                if (anyEventDue && IsEventDue(sched, SchedulerEvent::OAMDMA))
+                {
+                    ServiceOAMDMA(gb, currCycle);
+                }
+
+                // Writes to PPU registers can change what the PPU does next, so bring it up to date before the write lands
+                uint16_t writeAddress = 0;
+                bool ppuRegWrite = PeekPendingMemWrite(gb._cpu, writeAddress) &&
+                    writeAddress >= ADDR_PPU_REGS_BEGIN &&
+                    writeAddress <= ADDR_PPU_REGS_END;
+
+                if (ppuRegWrite)
+                {
+                    ServicePPU(gb, currCycle);
+                    ScheduleEvent(sched, SchedulerEvent::PPU, currCycle);
+                }
+
+                TickCPU(gb._cpu, gb._mmu, 1);
+
+                // DMA picks up a new transfer right after the register write, the CPU is locked out from the next cycle on
+                if (gb._dma._startPending)
+                {
+                    ServiceOAMDMA(gb, currCycle);
+                }
+
+                if ((anyEventDue || ppuRegWrite) && IsEventDue(sched, SchedulerEvent::PPU))
+                {
+                    ServicePPU(gb, currCycle + 1);
+                }
+
+                AdvanceScheduler(sched, 1);
+            }
+        }
+
+        uint32_t RunCPUStep(GameBoy& gb)
+        {
+            if (gb._mode != ExecutionMode::Compiled)
+            {
+                return StepCPU(gb._cpu, gb._mmu);
+            }
+
+            // Translated blocks stop at the first instruction boundary once anything else is due
+            const Scheduler& sched = gb._sched;
+            uint64_t cyclesUntilDeadline = (sched._nextDeadline > sched._currCycle) ? sched._nextDeadline - sched._currCycle : 0;
+            uint32_t maxCycles = uint32_t(std::min<uint64_t>(cyclesUntilDeadline, UINT32_MAX));
+            return StepCPUCompiled(gb._jit, gb._cpu, gb._mmu, maxCycles);
+        }
+
+        // Same as above, but the CPU runs whole instructions (or translated blocks of them) and everything else catches up afterwards
+        void RunScheduledInstructions(GameBoy& gb, uint32_t cycles)
+        {
+            Scheduler& sched = gb._sched;
+            const uint64_t endCycle = sched._currCycle + cycles;
+            while (sched._currCycle < endCycle)
+            {
+                uint32_t skippedCycles = SkipHaltedCPU(gb, endCycle);
+                if (skippedCycles)
+                {
+                    AdvanceScheduler(sched, skippedCycles);
+                    continue;
+                }
+
+                uint32_t instructionCycles = RunCPUStep(gb);
+
+                // Writes to the PPU registers already had the PPU caught up, a new transfer starts from the write on
+                if (gb._dma._startPending)
+                {
+                    ServiceOAMDMA(gb, gb._ppuWriteCycle);
+                }
+
+                if (sched._nextDeadline >= sched._currCycle + instructionCycles)
+                {
+                    AdvanceScheduler(sched, instructionCycles);
+                    continue;
+                }
+
+                for (uint32_t i = 0; i < instructionCycles; ++i)
+                {
+                    const uint64_t currCycle = sched._currCycle;
+                    if (AnyEventDue(sched))
+                    {
+                        if (IsEventDue(sched, SchedulerEvent::OAMDMA))
+                        {
+                            ServiceOAMDMA(gb, currCycle);
+                        }
+
+                        if (IsEventDue(sched, SchedulerEvent::PPU))
+                        {
+                            ServicePPU(gb, currCycle + 1);
+                        }
+                    }
+
+                    // Going T-cycle by T-cycle, the interrupt check is in the step's last T-cycle, after the PPU's caught up to it
+                    if (i + 2 == instructionCycles)
+                    {
+                        RecheckInterrupts(gb._cpu);
+                    }
+
+                    AdvanceScheduler(sched, 1);
+                }
+            }
+        }
+
+        // Whole instructions can take it past endCycle outside of cycle accurate mode
+        void RunToCycle(GameBoy& gb, uint64_t endCycle)
+        {
+            while (gb._sched._currCycle < endCycle)
+            {
+                uint32_t runCycles = uint32_t(std::min<uint64_t>(endCycle - gb._sched._currCycle, UINT32_MAX));
+                if (gb._mode != ExecutionMode::CycleAccurate)
+                {
+                    RunScheduledInstructions(gb, runCycles);
+                }
+                else
+                {
+                    RunScheduledCycles(gb, runCycles);
+                }
+            }
+        }
+    }
+
+    bool BootGameBoy(GameBoy& gb, uint8_t* rom, uint32_t romSize, ExecutionMode mode)
+    {
+        if (!LoadROM(gb._cart, rom, romSize))
+        {
+            return false;
+        }
+
+        gb._mode = mode;
+        if (mode == ExecutionMode::Compiled && !InitJIT(gb._jit))
+        {
+            gb._mode = ExecutionMode::Instruction;
+        }
+
+        MMU& mmu = gb._mmu;
+        MapMemoryRegion(mmu, 0x8000, sizeof(gb._vram), gb._vram, 0);
+        MapMemoryRegion(mmu, 0xFE00, sizeof(gb._oam), gb._oam, 0);
+        MapMemoryRegion(mmu, 0xC000, sizeof(gb._wram[0]), gb._wram[0], 0);
+        MapMemoryRegion(mmu, 0xD000, sizeof(gb._wram[1]), gb._wram[1], 0);
+        MapMemoryRegion(mmu, 0xE000, sizeof(gb._wram[0]), gb._wram[0], 0);
+        MapMemoryRegion(mmu, 0xF000, sizeof(gb._wram[1]), gb._wram[1], 0);
+
+        BootCPU(gb._cpu, 0, 0);
+        MapPeripheralIOMemory(gb._cpu, mmu);
+        BootOAMDMA(gb._dma, gb._cpu, gb._oam);
+        MapPPURegisters(gb);
+
+        BootPPU(gb._ppu, gb._vram, gb._oam);
+        SetPPUTileCache(gb._ppu, mmu, &gb._tileCache);
+
+        // VRAM DMA is CGB hardware, on DMG ROMs its registers stay as unwired as they are on a DMG
+        if (IsCGBCartridge(gb._cart))
+        {
+            BootVRAMDMA(gb._vramDMA, gb._cpu, gb._ppu);
+        }
+
+        MapCartridgeROM(gb._cart, mmu);
+
+        // The PPU starts ticking right away, everything else waits until it gets triggered
+        ResetScheduler(gb._sched);
+        ScheduleEvent(gb._sched, SchedulerEvent::PPU, 0);
+        gb._targetCycle = 0;
+        return true;
+    }
+
+    void DestroyGameBoy(GameBoy& gb)
+    {
+        DestroyJIT(gb._jit);
+    }
+
+    void RunCycles(GameBoy& gb, uint64_t cycles)
+    {
+        // Counted from where the last run was meant to end rather than where it did, so overshoot doesn't add up
+        gb._targetCycle += cycles;
+        RunToCycle(gb, gb._targetCycle);
+    }
+
+    void RunFrame(GameBoy& gb)
+    {
+        uint64_t frameEndCycle = (gb._targetCycle / CYCLES_PER_FRAME + 1) * CYCLES_PER_FRAME;
+        RunCycles(gb, frameEndCycle - gb._targetCycle);
+    }
+
+    bool RunUntil(GameBoy& gb, FnRunPredicate predicate, void* userData, uint64_t maxCycles)
+    {
+        const uint64_t endCycle = gb._targetCycle + maxCycles;
+        while (!predicate(userData, gb))
+        {
+            if (gb._sched._currCycle >= endCycle)
+            {
+                gb._targetCycle = endCycle;
+                return false;
+            }
+
+            // A single cycle is a whole instruction outside of cycle accurate mode, stopping after it leaves nothing to make up for
+            RunToCycle(gb, gb._sched._currCycle + 1);
+            gb._targetCycle = std::max(gb._targetCycle, gb._sched._currCycle);
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,715 @@
+#include "Interpreter.hpp"
+#include "OpCodes.hpp"
+#include "MMU.hpp"
+
+namespace emu::SM83
+{
+    namespace
+    {
+        // Opcode register index (B, C, D, E, H, L, (HL), A) to 8 bit register file index
+        constexpr const uint8_t REG8_INDEX[8] = { 1, 0, 3, 2, 5, 4, 0xFF, 7 };
+        constexpr const uint8_t REG_INDEX_HL_INDIRECT = 6;
+
+        // Opcode register pair index (BC, DE, HL, SP) to 16 bit register file index
+        constexpr const uint8_t REG16_INDEX[4] = { 0, 1, 2, 4 };
+
+        // Every bus access takes an MCycle of its own, counting them lets IO handlers tell which MCycle of the step they're in
+        uint8_t BusRead(Decoder& decoder, const MMU& mmu, uint16_t address)
+        {
+            uint8_t value = MMURead(mmu, address);
+            decoder._stepMCycle++;
+            return value;
+        }
+
+        void BusWrite(Decoder& decoder, MMU& mmu, uint16_t address, uint8_t val)
+        {
+            MMUWrite(mmu, address, val);
+            decoder._stepMCycle++;
+        }
+
+        uint8_t ReadImm8(Registers& regs, Decoder& decoder, const MMU& mmu)
+        {
+            return BusRead(decoder, mmu, regs._reg16.PC++);
+        }
+
+        uint16_t ReadImm16(Registers& regs, Decoder& decoder, const MMU& mmu)
+        {
+            uint8_t lsb = ReadImm8(regs, decoder, mmu);
+            uint8_t msb = ReadImm8(regs, decoder, mmu);
+            return uint16_t(lsb) | (uint16_t(msb) << 8);
+        }
+
+        void Push(Registers& regs, Decoder& decoder, MMU& mmu, uint16_t value)
+        {
+            // SP gets decremented in an MCycle of its own before the first write
+            decoder._stepMCycle++;
+            BusWrite(decoder, mmu, --regs._reg16.SP, uint8_t(value >> 8));
+            BusWrite(decoder, mmu, --regs._reg16.SP, uint8_t(value & 0xFF));
+        }
+
+        uint16_t Pop(Registers& regs, Decoder& decoder, const MMU& mmu)
+        {
+            uint8_t lsb = BusRead(decoder, mmu, regs._reg16.SP++);
+            uint8_t msb = BusRead(decoder, mmu, regs._reg16.SP++);
+            return uint16_t(lsb) | (uint16_t(msb) << 8);
+        }
+
+        // Condition index from opcode bits: NZ, Z, NC, C
+        bool CheckCondition(const Registers& regs, uint8_t condition)
+        {
+            bool flagSet = (regs._reg8.F & ((condition & 0x02) ? SF_Carry : SF_Zero)) != 0;
+            return (condition & 0x01) ? flagSet : !flagSet;
+        }
+
+        uint8_t MakeFlags(bool zero, bool subtract, bool halfCarry, bool carry)
+        {
+            return (zero ? SF_Zero : 0) |
+                (subtract ? SF_Subtract : 0) |
+                (halfCarry ? SF_HalfCarry : 0) |
+                (carry ? SF_Carry : 0);
+        }
+
+        // Flag behaviour below mirrors ProcessALUOp, the micro-sequenced core is the reference
+
+        // ADD, ADC, SUB, SBC, AND, XOR, OR, CP on A
+        void ALU8(Registers& regs, uint8_t op, uint8_t operand)
+        {
+            uint8_t& A = regs._reg8.A;
+            int carry = ((op == 1 || op == 3) && (regs._reg8.F & SF_Carry)) ? 1 : 0;
+            switch (op)
+            {
+            case 0:
+            case 1:
+            {
+                int result = A + operand + carry;
+                regs._reg8.F = MakeFlags((result & 0xFF) == 0, false, ((A & 0xF) + (operand & 0xF) + carry) > 0xF, result > 0xFF);
+                A = uint8_t(result);
+            }
+                break;
+            case 2:
+            case 3:
+            case 7:
+            {
+                int result = A - operand - carry;
+                regs._reg8.F = MakeFlags((result & 0xFF) == 0, true, ((A & 0xF) - (operand & 0xF) - carry) < 0, result < 0);
+                A = (op == 7) ? A : uint8_t(result);
+            }
+                break;
+            case 4:
+                A &= operand;
+                regs._reg8.F = MakeFlags(A == 0, false, true, false);
+                break;
+            case 5:
+                A ^= operand;
+                regs._reg8.F = MakeFlags(A == 0, false, false, false);
+                break;
+            case 6:
+                A |= operand;
+                regs._reg8.F = MakeFlags(A == 0, false, false, false);
+                break;
+            default:
+                break;
+            }
+        }
+
+        uint8_t Inc8(Registers& regs, uint8_t value)
+        {
+            uint8_t result = value + 1;
+            regs._reg8.F = MakeFlags(result == 0, false, (value & 0xF) == 0xF, regs._reg8.F & SF_Carry);
+            return result;
+        }
+
+        uint8_t Dec8(Registers& regs, uint8_t value)
+        {
+            uint8_t result = value - 1;
+            regs._reg8.F = MakeFlags(result == 0, true, (value & 0xF) == 0, regs._reg8.F & SF_Carry);
+            return result;
+        }
+
+        // RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL
+        uint8_t RotateShift(Registers& regs, uint8_t op, uint8_t value)
+        {
+            uint8_t carryIn = (regs._reg8.F & SF_Carry) ? 1 : 0;
+            uint8_t result = 0;
+            bool carry = false;
+            switch (op)
+            {
+            case 0:
+                result = uint8_t(value << 1) | (value >> 7);
+                carry = value & 0x80;
+                break;
+            case 1:
+                result = (value >> 1) | uint8_t(value << 7);
+                carry = value & 0x01;
+                break;
+            case 2:
+                result = uint8_t(value << 1) | carryIn;
+                carry = value & 0x80;
+                break;
+            case 3:
+                result = (value >> 1) | uint8_t(carryIn << 7);
+                carry = value & 0x01;
+                break;
+            case 4:
+                result = uint8_t(value << 1);
+                carry = value & 0x80;
+                break;
+            case 5:
+                result = (value & 0x80) | (value >> 1);
+                carry = value & 0x01;
+                break;
+            case 6:
+                result = uint8_t(value << 4) | (value >> 4);
+                carry = false;
+                break;
+            case 7:
+                result = value >> 1;
+                carry = value & 0x01;
+                break;
+            default:
+                break;
+            }
+
+            regs._reg8.F = MakeFlags(result == 0, false, false, carry);
+            return result;
+        }
+
+        // Whole prefix CB instruction, the prefix byte itself is already in IR
+        uint32_t ExecutePrefixCB(Registers& regs, Decoder& decoder, MMU& mmu)
+        {
+            uint8_t opCode = ReadImm8(regs, decoder, mmu);
+            regs._reg8.IR = opCode;
+
+            uint8_t x = opCode >> 6;
+            uint8_t y = (opCode >> 3) & 0x07;
+            uint8_t z = opCode & 0x07;
+
+            uint8_t value = (z == REG_INDEX_HL_INDIRECT) ?
+                BusRead(decoder, mmu, regs._reg16.HL) :
+                regs._reg8Arr[REG8_INDEX[z]];
+
+            uint8_t result = value;
+            switch (x)
+            {
+            case 0:
+                result = RotateShift(regs, y, value);
+                break;
+            case 1:
+                regs._reg8.F = MakeFlags((value & (1 << y)) == 0, false, true, regs._reg8.F & SF_Carry);
+                break;
+            case 2:
+                result = value & ~(1 << y);
+                break;
+            case 3:
+                result = value | (1 << y);
+                break;
+            default:
+                break;
+            }
+
+            if (z != REG_INDEX_HL_INDIRECT)
+            {
+                regs._reg8Arr[REG8_INDEX[z]] = result;
+                return 2;
+            }
+
+            // BIT only reads (HL)
+            if (x == 1)
+            {
+                return 3;
+            }
+
+            BusWrite(decoder, mmu, regs._reg16.HL, result);
+            return 4;
+        }
+
+        uint32_t ExecuteInterrupt(Registers& regs, Decoder& decoder, MMU& mmu)
+        {
+            // IR holds the handler address, and PC already moved past the opcode that got replaced
+            regs._reg16.PC--;
+            regs._reg8.IME = 0;
+            decoder._stepMCycle++;
+
+            Push(regs, decoder, mmu, regs._reg16.PC);
+            regs._reg16.PC = regs._reg8.IR;
+            return 5;
+        }
+
+        uint32_t ExecuteQuadrant00(Registers& regs, Decoder& decoder, MMU& mmu, uint8_t opCode)
+        {
+            uint8_t y = (opCode >> 3) & 0x07;
+            uint8_t p = (opCode >> 4) & 0x03;
+
+            switch (opCode)
+            {
+            // NOP
+            case 0x00:
+                return 1;
+
+            // STOP
+            case 0x10:
+                decoder._flags |= Decoder::DF_ExecutionStopped;
+                return 1;
+
+            // LD rr, d16
+            case 0x01:
+            case 0x11:
+            case 0x21:
+            case 0x31:
+                regs._reg16Arr[REG16_INDEX[p]] = ReadImm16(regs, decoder, mmu);
+                return 3;
+
+            // LD (BC), A / LD (DE), A
+            case 0x02:
+            case 0x12:
+                BusWrite(decoder, mmu, regs._reg16Arr[p], regs._reg8.A);
+                return 2;
+
+            // LD (HL+), A / LD (HL-), A
+            case 0x22:
+                BusWrite(decoder, mmu, regs._reg16.HL++, regs._reg8.A);
+                return 2;
+            case 0x32:
+                BusWrite(decoder, mmu, regs._reg16.HL--, regs._reg8.A);
+                return 2;
+
+            // LD A, (BC) / LD A, (DE)
+            case 0x0A:
+            case 0x1A:
+                regs._reg8.A = BusRead(decoder, mmu, regs._reg16Arr[p]);
+                return 2;
+
+            // LD A, (HL+) / LD A, (HL-)
+            case 0x2A:
+                regs._reg8.A = BusRead(decoder, mmu, regs._reg16.HL++);
+                return 2;
+            case 0x3A:
+                regs._reg8.A = BusRead(decoder, mmu, regs._reg16.HL--);
+                return 2;
+
+            // INC rr / DEC rr
+            case 0x03:
+            case 0x13:
+            case 0x23:
+            case 0x33:
+                regs._reg16Arr[REG16_INDEX[p]]++;
+                return 2;
+            case 0x0B:
+            case 0x1B:
+            case 0x2B:
+            case 0x3B:
+                regs._reg16Arr[REG16_INDEX[p]]--;
+                return 2;
+
+            // INC r / DEC r
+            case 0x04:
+            case 0x0C:
+            case 0x14:
+            case 0x1C:
+            case 0x24:
+            case 0x2C:
+            case 0x3C:
+                regs._reg8Arr[REG8_INDEX[y]] = Inc8(regs, regs._reg8Arr[REG8_INDEX[y]]);
+                return 1;
+            case 0x05:
+            case 0x0D:
+            case 0x15:
+            case 0x1D:
+            case 0x25:
+            case 0x2D:
+            case 0x3D:
+                regs._reg8Arr[REG8_INDEX[y]] = Dec8(regs, regs._reg8Arr[REG8_INDEX[y]]);
+                return 1;
+
+            // INC (HL) / DEC (HL)
+            case 0x34:
+                BusWrite(decoder, mmu, regs._reg16.HL, Inc8(regs, BusRead(decoder, mmu, regs._reg16.HL)));
+                return 3;
+            case 0x35:
+                BusWrite(decoder, mmu, regs._reg16.HL, Dec8(regs, BusRead(decoder, mmu, regs._reg16.HL)));
+                return 3;
+
+            // LD r, d8
+            case 0x06:
+            case 0x0E:
+            case 0x16:
+            case 0x1E:
+            case 0x26:
+            case 0x2E:
+            case 0x3E:
+                regs._reg8Arr[REG8_INDEX[y]] = ReadImm8(regs, decoder, mmu);
+                return 2;
+
+            // LD (HL), d8
+            case 0x36:
+                BusWrite(decoder, mmu, regs._reg16.HL, ReadImm8(regs, decoder, mmu));
+                return 3;
+
+            // RLCA, RRCA, RLA, RRA (Z flag is always cleared)
+            case 0x07:
+            case 0x0F:
+            case 0x17:
+            case 0x1F:
+                regs._reg8.A = RotateShift(regs, y, regs._reg8.A);
+                regs._reg8.F &= ~SF_Zero;
+                return 1;
+
+            // LD (a16), SP
+            case 0x08:
+            {
+                uint16_t address = ReadImm16(regs, decoder, mmu);
+                BusWrite(decoder, mmu, address, regs._reg8.SPL);
+                BusWrite(decoder, mmu, address + 1, regs._reg8.SPH);
+            }
+                return 5;
+
+            // ADD HL, rr
+            case 0x09:
+            case 0x19:
+            case 0x29:
+            case 0x39:
+            {
+                uint16_t HL = regs._reg16.HL;
+                uint16_t operand = regs._reg16Arr[REG16_INDEX[p]];
+                uint32_t result = uint32_t(HL) + operand;
+                regs._reg8.F = MakeFlags(regs._reg8.F & SF_Zero, false, ((HL & 0xFFF) + (operand & 0xFFF)) > 0xFFF, result > 0xFFFF);
+                regs._reg16.HL = uint16_t(result);
+            }
+                return 2;
+
+            // JR r8 / JR cc, r8
+            case 0x18:
+            case 0x20:
+            case 0x28:
+            case 0x30:
+            case 0x38:
+            {
+                int8_t offset = int8_t(ReadImm8(regs, decoder, mmu));
+                if (opCode != 0x18 && !CheckCondition(regs, y & 0x03))
+                {
+                    return 2;
+                }
+
+                regs._reg16.PC += offset;
+            }
+                return 3;
+
+            // DAA
+            case 0x27:
+            {
+                uint8_t& A = regs._reg8.A;
+                bool subtract = regs._reg8.F & SF_Subtract;
+                bool carry = false;
+                uint8_t adjust = 0;
+                if ((regs._reg8.F & SF_HalfCarry) || (!subtract && (A & 0xF) > 0x9))
+                {
+                    adjust |= 0x06;
+                }
+
+                if ((regs._reg8.F & SF_Carry) || (!subtract && A > 0x99))
+                {
+                    adjust |= 0x60;
+                    carry = true;
+                }
+
+                A = subtract ? A - adjust : A + adjust;
+                regs._reg8.F = MakeFlags(A == 0, subtract, false, carry);
+            }
+                return 1;
+
+            // CPL
+            case 0x2F:
+                regs._reg8.A = ~regs._reg8.A;
+                regs._reg8.F |= SF_Subtract | SF_HalfCarry;
+                return 1;
+
+            // SCF / CCF
+            case 0x37:
+                regs._reg8.F = MakeFlags(regs._reg8.F & SF_Zero, false, false, true);
+                return 1;
+            case 0x3F:
+                regs._reg8.F = MakeFlags(regs._reg8.F & SF_Zero, false, false, !(regs._reg8.F & SF_Carry));
+                return 1;
+
+            default:
+                break;
+            }
+
+            EMU_ASSERT("Unhandled opcode" && false);
+            return 1;
+        }
+
+        uint32_t ExecuteQuadrant01(Registers& regs, Decoder& decoder, MMU& mmu, uint8_t opCode)
+        {
+            uint8_t y = (opCode >> 3) & 0x07;
+            uint8_t z = opCode & 0x07;
+
+            // HALT, the opcode after it gets fetched without incrementing PC
+            if (opCode == 0x76)
+            {
+                regs._reg8.IR = BusRead(decoder, mmu, regs._reg16.PC);
+                decoder._flags |= Decoder::DF_ExecutionHalted;
+
+                // The micro-sequenced core keeps replaying this while halted
+                decoder._currOp = &GetMicroOp(InstructionTable::Default, opCode, 0);
+                return 1;
+            }
+
+            // LD (HL), r
+            if (y == REG_INDEX_HL_INDIRECT)
+            {
+                BusWrite(decoder, mmu, regs._reg16.HL, regs._reg8Arr[REG8_INDEX[z]]);
+                return 2;
+            }
+
+            // LD r, (HL)
+            if (z == REG_INDEX_HL_INDIRECT)
+            {
+                regs._reg8Arr[REG8_INDEX[y]] = BusRead(decoder, mmu, regs._reg16.HL);
+                return 2;
+            }
+
+            // LD r, r
+            regs._reg8Arr[REG8_INDEX[y]] = regs._reg8Arr[REG8_INDEX[z]];
+            return 1;
+        }
+
+        uint32_t ExecuteQuadrant10(Registers& regs, Decoder& decoder, MMU& mmu, uint8_t opCode)
+        {
+            uint8_t y = (opCode >> 3) & 0x07;
+            uint8_t z = opCode & 0x07;
+
+            // ALU A, (HL)
+            if (z == REG_INDEX_HL_INDIRECT)
+            {
+                ALU8(regs, y, BusRead(decoder, mmu, regs._reg16.HL));
+                return 2;
+            }
+
+            // ALU A, r
+            ALU8(regs, y, regs._reg8Arr[REG8_INDEX[z]]);
+            return 1;
+        }
+
+        uint32_t ExecuteQuadrant11(Registers& regs, Decoder& decoder, MMU& mmu, uint8_t opCode)
+        {
+            uint8_t y = (opCode >> 3) & 0x07;
+            uint8_t p = (opCode >> 4) & 0x03;
+
+            switch (opCode)
+            {
+            // RET cc
+            case 0xC0:
+            case 0xC8:
+            case 0xD0:
+            case 0xD8:
+                if (!CheckCondition(regs, y & 0x03))
+                {
+                    return 2;
+                }
+
+                // The condition check takes an MCycle ahead of the reads
+                decoder._stepMCycle++;
+                regs._reg16.PC = Pop(regs, decoder, mmu);
+                return 5;
+
+            // RET / RETI
+            case 0xC9:
+                regs._reg16.PC = Pop(regs, decoder, mmu);
+                return 4;
+            case 0xD9:
+                regs._reg16.PC = Pop(regs, decoder, mmu);
+                regs._reg8.IME = 1;
+                return 4;
+
+            // POP rr (only the upper nibble of F exists)
+            case 0xC1:
+            case 0xD1:
+            case 0xE1:
+                regs._reg16Arr[p] = Pop(regs, decoder, mmu);
+                return 3;
+            case 0xF1:
+                regs._reg16.AF = Pop(regs, decoder, mmu) & 0xFFF0;
+                return 3;
+
+            // PUSH rr
+            case 0xC5:
+            case 0xD5:
+            case 0xE5:
+            case 0xF5:
+                Push(regs, decoder, mmu, regs._reg16Arr[p]);
+                return 4;
+
+            // JP a16 / JP cc, a16
+            case 0xC3:
+            case 0xC2:
+            case 0xCA:
+            case 0xD2:
+            case 0xDA:
+            {
+                uint16_t address = ReadImm16(regs, decoder, mmu);
+                if (opCode != 0xC3 && !CheckCondition(regs, y & 0x03))
+                {
+                    return 3;
+                }
+
+                regs._reg16.PC = address;
+            }
+                return 4;
+
+            // CALL a16 / CALL cc, a16
+            case 0xCD:
+            case 0xC4:
+            case 0xCC:
+            case 0xD4:
+            case 0xDC:
+            {
+                uint16_t address = ReadImm16(regs, decoder, mmu);
+                if (opCode != 0xCD && !CheckCondition(regs, y & 0x03))
+                {
+                    return 3;
+                }
+
+                Push(regs, decoder, mmu, regs._reg16.PC);
+                regs._reg16.PC = address;
+            }
+                return 6;
+
+            // RST
+            case 0xC7:
+            case 0xCF:
+            case 0xD7:
+            case 0xDF:
+            case 0xE7:
+            case 0xEF:
+            case 0xF7:
+            case 0xFF:
+                Push(regs, decoder, mmu, regs._reg16.PC);
+                regs._reg16.PC = opCode & 0x38;
+                return 4;
+
+            // ALU A, d8
+            case 0xC6:
+            case 0xCE:
+            case 0xD6:
+            case 0xDE:
+            case 0xE6:
+            case 0xEE:
+            case 0xF6:
+            case 0xFE:
+                ALU8(regs, y, ReadImm8(regs, decoder, mmu));
+                return 2;
+
+            // PREFIX CB
+            case 0xCB:
+                return ExecutePrefixCB(regs, decoder, mmu);
+
+            // LDH (a8), A / LDH A, (a8)
+            case 0xE0:
+                BusWrite(decoder, mmu, 0xFF00 + ReadImm8(regs, decoder, mmu), regs._reg8.A);
+                return 3;
+            case 0xF0:
+                regs._reg8.A = BusRead(decoder, mmu, 0xFF00 + ReadImm8(regs, decoder, mmu));
+                return 3;
+
+            // LD (C), A / LD A, (C)
+            case 0xE2:
+                BusWrite(decoder, mmu, 0xFF00 + regs._reg8.C, regs._reg8.A);
+                return 2;
+            case 0xF2:
+                regs._reg8.A = BusRead(decoder, mmu, 0xFF00 + regs._reg8.C);
+                return 2;
+
+            // LD (a16), A / LD A, (a16)
+            case 0xEA:
+                BusWrite(decoder, mmu, ReadImm16(regs, decoder, mmu), regs._reg8.A);
+                return 4;
+            case 0xFA:
+                regs._reg8.A = BusRead(decoder, mmu, ReadImm16(regs, decoder, mmu));
+                return 4;
+
+            // ADD SP, e / LD HL, SP+e (flags come from the unsigned low byte addition)
+            case 0xE8:
+            case 0xF8:
+            {
+                uint8_t offset = ReadImm8(regs, decoder, mmu);
+                uint16_t SP = regs._reg16.SP;
+                regs._reg8.F = MakeFlags(false, false, ((SP & 0xF) + (offset & 0xF)) > 0xF, ((SP & 0xFF) + offset) > 0xFF);
+
+                uint16_t result = SP + int8_t(offset);
+                if (opCode == 0xE8)
+                {
+                    regs._reg16.SP = result;
+                    return 4;
+                }
+
+                regs._reg16.HL = result;
+            }
+                return 3;
+
+            // JP HL / LD SP, HL
+            case 0xE9:
+                regs._reg16.PC = regs._reg16.HL;
+                return 1;
+            case 0xF9:
+                regs._reg16.SP = regs._reg16.HL;
+                return 2;
+
+            // DI / EI, both take effect right away
+            case 0xF3:
+                regs._reg8.IME = 0;
+                return 1;
+            case 0xFB:
+                regs._reg8.IME = 1;
+                return 1;
+
+            default:
+                break;
+            }
+
+            EMU_ASSERT("Invalid opcode" && false);
+            return 1;
+        }
+    }
+
+    uint32_t ExecuteInstruction(Registers& regs, Decoder& decoder, MMU& mmu)
+    {
+        decoder._stepMCycle = 0;
+
+        uint32_t mCycles = 0;
+        if (decoder._table == InstructionTable::Interrupt)
+        {
+            mCycles = ExecuteInterrupt(regs, decoder, mmu);
+        }
+        else
+        {
+            uint8_t opCode = regs._reg8.IR;
+            switch (opCode >> 6)
+            {
+            case 0:
+                mCycles = ExecuteQuadrant00(regs, decoder, mmu, opCode);
+                break;
+            case 1:
+                mCycles = ExecuteQuadrant01(regs, decoder, mmu, opCode);
+                break;
+            case 2:
+                mCycles = ExecuteQuadrant10(regs, decoder, mmu, opCode);
+                break;
+            default:
+                mCycles = ExecuteQuadrant11(regs, decoder, mmu, opCode);
+                break;
+            }
+        }
+
+        decoder._table = InstructionTable::Default;
+
+        // Overlapping fetch of the next opcode in the last MCycle, HALT takes care of its own
+        if ((decoder._flags & Decoder::DF_ExecutionHalted) == 0)
+        {
+            decoder._stepMCycle = uint8_t(mCycles - 1);
+            regs._reg8.IR = ReadImm8(regs, decoder, mmu);
+        }
+
+        return mCycles * M_CYCLE_LENGTH;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "SM83.hpp"
+
+namespace emu::SM83
+{
+    struct MMU;
+
+    constexpr const uint32_t M_CYCLE_LENGTH = 4;   // T-cycles per M-cycle
+
+    // Runs the instruction in IR from start to finish, including the overlapping fetch of the next opcode
+    // Interrupt checks are left to the caller. Returns the number of T-cycles taken
+    uint32_t ExecuteInstruction(Registers& regs, Decoder& decoder, MMU& mmu);
+
+    // Bookkeeping after a step of the given length: timer and interrupt checks
+    void CompleteStep(CPU& cpu, uint32_t cycles);
+}
@@ -0,0 +1,1007 @@
+#include "JIT.hpp"
+#include "SM83.hpp"
+#include "MMU.hpp"
+#include "Interpreter.hpp"
+#include "X64Emitter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#if EMU_PLATFORM_WINDOWS
+    #include <Windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+namespace emu::SM83
+{
+    namespace
+    {
+        constexpr const uint32_t ROM_BANK_SIZE = 16 * 1024;
+        constexpr const uint32_t ROM_END = 0x8000;
+        constexpr const uint32_t MAX_BLOCK_CODE_SIZE = 8 * 1024;
+
+        // Byte offsets into Registers
+        constexpr const int8_t REG_OFFSET_F = 6;
+        constexpr const int8_t REG_OFFSET_A = 7;
+        constexpr const int8_t REG_OFFSET_HL = 4;
+        constexpr const int8_t REG_OFFSET_SP = 8;
+        constexpr const int8_t REG_OFFSET_PC = 10;
+
+        // Opcode register index (B, C, D, E, H, L, (HL), A) to Registers offset
+        constexpr const int8_t REG8_OFFSET[8] = { 1, 0, 3, 2, 5, 4, -1, 7 };
+        constexpr const uint8_t REG_INDEX_HL_INDIRECT = 6;
+
+        // Opcode register pair index (BC, DE, HL, SP) to Registers offset
+        constexpr const int8_t REG16_OFFSET[4] = { 0, 2, 4, 8 };
+
+        // Host registers the translated code keeps its state in, all callee saved
+        constexpr const X64Reg HOST_REGS = X64Reg::RBX;
+        constexpr const X64Reg HOST_MMU = X64Reg::R12;
+        constexpr const X64Reg HOST_FLAG_TABLE = X64Reg::R13;
+        constexpr const X64Reg HOST_CYCLES = X64Reg::R14;
+        constexpr const X64Reg HOST_MAX_CYCLES = X64Reg::R15;
+
+#if EMU_PLATFORM_WINDOWS
+        constexpr const X64Reg HOST_ARG0 = X64Reg::RCX;
+        constexpr const X64Reg HOST_ARG1 = X64Reg::RDX;
+        constexpr const X64Reg HOST_ARG2 = X64Reg::R8;
+#else
+        constexpr const X64Reg HOST_ARG0 = X64Reg::RDI;
+        constexpr const X64Reg HOST_ARG1 = X64Reg::RSI;
+        constexpr const X64Reg HOST_ARG2 = X64Reg::RDX;
+#endif
+
+        // Host flags as stored by LAHF (CF bit 0, AF bit 4, ZF bit 6) to the Z, H and C flags
+        constexpr const std::array<uint8_t, 256> FLAGS_FROM_HOST = []()
+        {
+            std::array<uint8_t, 256> table = {};
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                table[i] = ((i & 0x40) ? SF_Zero : 0) |
+                    ((i & 0x10) ? SF_HalfCarry : 0) |
+                    ((i & 0x01) ? SF_Carry : 0);
+            }
+
+            return table;
+        }();
+
+        // SM83 ALU op order (ADD, ADC, SUB, SBC, AND, XOR, OR, CP) to the matching host op
+        constexpr const X64ALUOp HOST_ALU_OPS[8] =
+        {
+            X64ALUOp::Add,
+            X64ALUOp::Adc,
+            X64ALUOp::Sub,
+            X64ALUOp::Sbb,
+            X64ALUOp::And,
+            X64ALUOp::Xor,
+            X64ALUOp::Or,
+            X64ALUOp::Cmp
+        };
+
+        bool IsIOAddress(uint16_t address)
+        {
+            return (address >= 0xFF00 && address < 0xFF80) || address == 0xFFFF;
+        }
+
+        // Peripherals only get brought up to date in between steps, so register accesses have to be left to StepCPU
+        bool IsSensitiveRead(uint16_t address)
+        {
+            return IsIOAddress(address);
+        }
+
+        // Same for writes, which can also end up in the cartridge's MBC
+        bool IsSensitiveWrite(uint16_t address)
+        {
+            return address < ROM_END || IsIOAddress(address);
+        }
+
+        // Reads what is mapped at an address, without any side effects
+        uint8_t Peek(const MMU& mmu, uint16_t address)
+        {
+            const uint8_t* source = GetMappedMemory(mmu, address);
+            return source ? *source : 0xFF;
+        }
+
+        uint8_t GetInstructionLength(uint8_t opCode)
+        {
+            switch (opCode)
+            {
+            case 0x01: case 0x11: case 0x21: case 0x31:
+            case 0x08:
+            case 0xC2: case 0xC3: case 0xC4: case 0xCA: case 0xCC: case 0xCD:
+            case 0xD2: case 0xD4: case 0xDA: case 0xDC:
+            case 0xEA: case 0xFA:
+                return 3;
+
+            case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x36: case 0x3E:
+            case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+            case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+            case 0xE0: case 0xF0:
+            case 0xE8: case 0xF8:
+            case 0xCB:
+                return 2;
+
+            default:
+                return 1;
+            }
+        }
+
+        enum class Translation : uint8_t
+        {
+            Native,
+            Interpreted,        // Calls into the interpreter, which can bail out of the block before anything happens
+            InterpretedBranch,  // Same, but ends the block
+            Unsupported,        // Left to StepCPU, the block ends right before it
+        };
+
+        Translation ClassifyInstruction(const uint8_t* bytes)
+        {
+            uint8_t opCode = bytes[0];
+            uint8_t x = opCode >> 6;
+            uint8_t y = (opCode >> 3) & 0x07;
+            uint8_t z = opCode & 0x07;
+            uint16_t imm16 = uint16_t(bytes[1]) | (uint16_t(bytes[2]) << 8);
+
+            switch (opCode)
+            {
+            // Changes to the execution state or interrupts, these have to be seen right away
+            case 0x10:
+            case 0x76:
+            case 0xF3:
+            case 0xFB:
+            case 0xD9:
+
+            // LD (C), A / LD A, (C) go to IO registers pretty much all the time
+            case 0xE2:
+            case 0xF2:
+
+            // Invalid opcodes
+            case 0xD3:
+            case 0xDB:
+            case 0xDD:
+            case 0xE3:
+            case 0xE4:
+            case 0xEB:
+            case 0xEC:
+            case 0xED:
+            case 0xF4:
+            case 0xFC:
+            case 0xFD:
+                return Translation::Unsupported;
+
+            // Fixed addresses can be checked right away, LDH past the IO registers is always HRAM
+            case 0xE0:
+            case 0xF0:
+                return IsIOAddress(0xFF00 + bytes[1]) ? Translation::Unsupported : Translation::Native;
+            case 0xEA:
+                return IsSensitiveWrite(imm16) ? Translation::Unsupported : Translation::Interpreted;
+            case 0xFA:
+                return IsSensitiveRead(imm16) ? Translation::Unsupported : Translation::Interpreted;
+            case 0x08:
+                return (IsSensitiveWrite(imm16) || IsSensitiveWrite(imm16 + 1)) ? Translation::Unsupported : Translation::Interpreted;
+
+            // RET, CALL and RST go through the stack
+            case 0xC0:
+            case 0xC8:
+            case 0xD0:
+            case 0xD8:
+            case 0xC9:
+            case 0xC4:
+            case 0xCC:
+            case 0xD4:
+            case 0xDC:
+            case 0xCD:
+            case 0xC7:
+            case 0xCF:
+            case 0xD7:
+            case 0xDF:
+            case 0xE7:
+            case 0xEF:
+            case 0xF7:
+            case 0xFF:
+                return Translation::InterpretedBranch;
+
+            // JR, JP, JP HL and LD SP, HL
+            case 0x18:
+            case 0x20:
+            case 0x28:
+            case 0x30:
+            case 0x38:
+            case 0xC3:
+            case 0xC2:
+            case 0xCA:
+            case 0xD2:
+            case 0xDA:
+            case 0xE9:
+            case 0xF9:
+                return Translation::Native;
+
+            default:
+                break;
+            }
+
+            switch (x)
+            {
+            case 0:
+                switch (z)
+                {
+                case 0:     // NOP
+                case 3:     // INC rr / DEC rr
+                    return Translation::Native;
+                case 1:     // LD rr, d16 / ADD HL, rr
+                    return (y & 0x01) ? Translation::Interpreted : Translation::Native;
+                case 4:     // INC r / DEC r / LD r, d8
+                case 5:
+                case 6:
+                    return (y == REG_INDEX_HL_INDIRECT) ? Translation::Interpreted : Translation::Native;
+                case 7:     // Rotates and DAA, then CPL, SCF and CCF
+                    return (y < 5) ? Translation::Interpreted : Translation::Native;
+                default:
+                    return Translation::Interpreted;
+                }
+
+            // LD r, r
+            case 1:
+                return (y == REG_INDEX_HL_INDIRECT || z == REG_INDEX_HL_INDIRECT) ? Translation::Interpreted : Translation::Native;
+
+            // ALU A, r
+            case 2:
+                return (z == REG_INDEX_HL_INDIRECT) ? Translation::Interpreted : Translation::Native;
+
+            // ALU A, d8 and whatever is left
+            default:
+                return (z == 6) ? Translation::Native : Translation::Interpreted;
+            }
+        }
+
+        // Checks the addresses an instruction will access at runtime, fixed addresses are already taken care of
+        bool TouchesSensitiveMemory(const Registers& regs, uint8_t opCode, uint8_t opCodeCB)
+        {
+            const uint16_t HL = regs._reg16.HL;
+            const uint16_t SP = regs._reg16.SP;
+            switch (opCode)
+            {
+            case 0x02:
+                return IsSensitiveWrite(regs._reg16.BC);
+            case 0x12:
+                return IsSensitiveWrite(regs._reg16.DE);
+            case 0x0A:
+                return IsSensitiveRead(regs._reg16.BC);
+            case 0x1A:
+                return IsSensitiveRead(regs._reg16.DE);
+
+            case 0x22:
+            case 0x32:
+            case 0x34:
+            case 0x35:
+            case 0x36:
+                return IsSensitiveWrite(HL);
+            case 0x2A:
+            case 0x3A:
+                return IsSensitiveRead(HL);
+
+            // POP and RET
+            case 0xC1:
+            case 0xD1:
+            case 0xE1:
+            case 0xF1:
+            case 0xC0:
+            case 0xC8:
+            case 0xD0:
+            case 0xD8:
+            case 0xC9:
+                return IsSensitiveRead(SP) || IsSensitiveRead(SP + 1);
+
+            // PUSH, CALL and RST
+            case 0xC5:
+            case 0xD5:
+            case 0xE5:
+            case 0xF5:
+            case 0xC4:
+            case 0xCC:
+            case 0xD4:
+            case 0xDC:
+            case 0xCD:
+            case 0xC7:
+            case 0xCF:
+            case 0xD7:
+            case 0xDF:
+            case 0xE7:
+            case 0xEF:
+            case 0xF7:
+            case 0xFF:
+                return IsSensitiveWrite(SP - 1) || IsSensitiveWrite(SP - 2);
+
+            // BIT only reads (HL), everything else writes it back
+            case 0xCB:
+                if ((opCodeCB & 0x07) != REG_INDEX_HL_INDIRECT)
+                {
+                    return false;
+                }
+                return ((opCodeCB >> 6) == 1) ? IsSensitiveRead(HL) : IsSensitiveWrite(HL);
+
+            default:
+                break;
+            }
+
+            // LD r, (HL) / LD (HL), r / ALU A, (HL)
+            uint8_t x = opCode >> 6;
+            if (x == 1 || x == 2)
+            {
+                if (x == 1 && ((opCode >> 3) & 0x07) == REG_INDEX_HL_INDIRECT)
+                {
+                    return IsSensitiveWrite(HL);
+                }
+
+                if ((opCode & 0x07) == REG_INDEX_HL_INDIRECT)
+                {
+                    return IsSensitiveRead(HL);
+                }
+            }
+
+            return false;
+        }
+
+        // Called from translated code for anything that isn't emitted inline
+        // The instruction is packed as address | opcode << 16 | prefix CB opcode << 24
+        // Returns the T-cycles taken, or 0 without running it if it has to be left to StepCPU
+        uint32_t InterpretInstruction(Registers* regs, MMU* mmu, uint32_t instruction)
+        {
+            uint16_t address = uint16_t(instruction);
+            uint8_t opCode = uint8_t(instruction >> 16);
+            if (TouchesSensitiveMemory(*regs, opCode, uint8_t(instruction >> 24)))
+            {
+                return 0;
+            }
+
+            regs->_reg16.PC = address + 1;
+            regs->_reg8.IR = opCode;
+
+            Decoder decoder = {};
+            decoder._table = InstructionTable::Default;
+            uint32_t cycles = ExecuteInstruction(*regs, decoder, *mmu);
+
+            // Undo the overlapping fetch, whatever runs next picks up from PC
+            regs->_reg16.PC--;
+            return cycles;
+        }
+
+        struct BlockCompiler
+        {
+            X64Emitter _emitter;
+            uint32_t _pendingCycles;    // Cycles of inline instructions not yet added to the running count
+        };
+
+        void EmitPrologue(X64Emitter& e)
+        {
+            X64Push(e, X64Reg::RBX);
+            X64Push(e, X64Reg::R12);
+            X64Push(e, X64Reg::R13);
+            X64Push(e, X64Reg::R14);
+            X64Push(e, X64Reg::R15);
+
+            // Keeps the stack 16 byte aligned for calls, and covers the shadow space Windows wants
+            X64ALUReg64Imm8(e, X64ALUOp::Sub, X64Reg::RSP, 48);
+
+            X64MovReg64Reg64(e, HOST_REGS, HOST_ARG0);
+            X64MovReg64Reg64(e, HOST_MMU, HOST_ARG1);
+            X64MovReg64Reg64(e, HOST_MAX_CYCLES, HOST_ARG2);
+            X64MovReg64Imm64(e, HOST_FLAG_TABLE, reinterpret_cast<uint64_t>(FLAGS_FROM_HOST.data()));
+            X64ALUReg32Reg32(e, X64ALUOp::Xor, HOST_CYCLES, HOST_CYCLES);
+        }
+
+        void EmitEpilogue(X64Emitter& e)
+        {
+            X64ALUReg64Imm8(e, X64ALUOp::Add, X64Reg::RSP, 48);
+            X64Pop(e, X64Reg::R15);
+            X64Pop(e, X64Reg::R14);
+            X64Pop(e, X64Reg::R13);
+            X64Pop(e, X64Reg::R12);
+            X64Pop(e, X64Reg::RBX);
+            X64Ret(e);
+        }
+
+        void FlushCycles(BlockCompiler& c)
+        {
+            if (c._pendingCycles)
+            {
+                X64ALUReg32Imm32(c._emitter, X64ALUOp::Add, HOST_CYCLES, c._pendingCycles);
+                c._pendingCycles = 0;
+            }
+        }
+
+        // Returns from the block with the cycles taken so far, plus extraCycles
+        // Doesn't touch the pending cycles, so other paths can still exit later on
+        void EmitExit(BlockCompiler& c, bool setPC, uint16_t PC, uint32_t extraCycles)
+        {
+            X64Emitter& e = c._emitter;
+            if (setPC)
+            {
+                X64Store16Imm(e, HOST_REGS, REG_OFFSET_PC, PC);
+            }
+
+            X64MovReg32Reg32(e, X64Reg::RAX, HOST_CYCLES);
+            if (c._pendingCycles + extraCycles)
+            {
+                X64ALUReg32Imm32(e, X64ALUOp::Add, X64Reg::RAX, c._pendingCycles + extraCycles);
+            }
+
+            EmitEpilogue(e);
+        }
+
+        // Leaves the block ahead of the instruction at PC once the cycles taken reach the block's maxCycles
+        // Stepping one instruction at a time, that's where everything else would have been caught up
+        void EmitMaxCyclesCheck(BlockCompiler& c, uint16_t PC)
+        {
+            X64Emitter& e = c._emitter;
+            FlushCycles(c);
+
+            X64ALUReg32Reg32(e, X64ALUOp::Cmp, HOST_CYCLES, HOST_MAX_CYCLES);
+            uint32_t withinMaxCycles = X64JccRel8(e, X64Cond::B);
+            EmitExit(c, true, PC, 0);
+
+            X64PatchRel8(e, withinMaxCycles);
+        }
+
+        // Condition index from opcode bits: NZ, Z, NC, C
+        void EmitConditionalExit(BlockCompiler& c, uint8_t condition, uint16_t takenPC, uint32_t takenCycles, uint16_t nextPC, uint32_t nextCycles)
+        {
+            X64Emitter& e = c._emitter;
+            X64Test8Imm(e, HOST_REGS, REG_OFFSET_F, (condition & 0x02) ? SF_Carry : SF_Zero);
+
+            // ZF ends up set if the flag is clear
+            uint32_t notTaken = X64JccRel8(e, (condition & 0x01) ? X64Cond::Z : X64Cond::NZ);
+            EmitExit(c, true, takenPC, takenCycles);
+
+            X64PatchRel8(e, notTaken);
+            EmitExit(c, true, nextPC, nextCycles);
+        }
+
+        // F from the host flags of the last 8 bit operation
+        // Only Z, H and C come from the host, keepMask picks which of those to keep, setFlags get set on top
+        void EmitFlagsFromHost(X64Emitter& e, uint8_t keepMask, uint8_t setFlags, bool keepCarry)
+        {
+            X64Lahf(e);
+            X64MovzxReg32AH(e, X64Reg::RCX);
+            X64LoadIndexed8Zx(e, X64Reg::RCX, HOST_FLAG_TABLE, X64Reg::RCX);
+
+            if (keepMask != (SF_Zero | SF_HalfCarry | SF_Carry))
+            {
+                X64ALUReg8Imm8(e, X64ALUOp::And, X64Reg::RCX, keepMask);
+            }
+
+            if (setFlags)
+            {
+                X64ALUReg8Imm8(e, X64ALUOp::Or, X64Reg::RCX, setFlags);
+            }
+
+            if (keepCarry)
+            {
+                X64Load8(e, X64Reg::RDX, HOST_REGS, REG_OFFSET_F);
+                X64ALUReg8Imm8(e, X64ALUOp::And, X64Reg::RDX, SF_Carry);
+                X64ALUReg8Reg8(e, X64ALUOp::Or, X64Reg::RCX, X64Reg::RDX);
+            }
+
+            X64Store8(e, HOST_REGS, REG_OFFSET_F, X64Reg::RCX);
+        }
+
+        // ADD, ADC, SUB, SBC, AND, XOR, OR, CP on A, with the operand already in CL
+        void EmitALU8(X64Emitter& e, uint8_t op)
+        {
+            X64Load8(e, X64Reg::RAX, HOST_REGS, REG_OFFSET_A);
+
+            // Carry in for ADC and SBC
+            if (op == 1 || op == 3)
+            {
+                X64Load8(e, X64Reg::RDX, HOST_REGS, REG_OFFSET_F);
+                X64BtReg32Imm8(e, X64Reg::RDX, 4);
+            }
+
+            X64ALUReg8Reg8(e, HOST_ALU_OPS[op], X64Reg::RAX, X64Reg::RCX);
+
+            switch (op)
+            {
+            case 0:
+            case 1:
+                EmitFlagsFromHost(e, SF_Zero | SF_HalfCarry | SF_Carry, 0, false);
+                break;
+            case 2:
+            case 3:
+            case 7:
+                EmitFlagsFromHost(e, SF_Zero | SF_HalfCarry | SF_Carry, SF_Subtract, false);
+                break;
+            case 4:
+                EmitFlagsFromHost(e, SF_Zero, SF_HalfCarry, false);
+                break;
+            default:
+                EmitFlagsFromHost(e, SF_Zero, 0, false);
+                break;
+            }
+
+            if (op != 7)
+            {
+                X64Store8(e, HOST_REGS, REG_OFFSET_A, X64Reg::RAX);
+            }
+        }
+
+        void EmitIncDec8(X64Emitter& e, int8_t offset, bool decrement)
+        {
+            X64Load8(e, X64Reg::RAX, HOST_REGS, offset);
+            if (decrement)
+            {
+                X64DecReg8(e, X64Reg::RAX);
+            }
+            else
+            {
+                X64IncReg8(e, X64Reg::RAX);
+            }
+
+            EmitFlagsFromHost(e, SF_Zero | SF_HalfCarry, decrement ? SF_Subtract : 0, true);
+            X64Store8(e, HOST_REGS, offset, X64Reg::RAX);
+        }
+
+        // LDH A, (a8) / LDH (a8), A on HRAM, which nothing ever locks
+        // It goes away along with the IO page though, the block bails ahead of it if it isn't mapped
+        void EmitHRAMAccess(BlockCompiler& c, uint16_t address, uint8_t offset, bool load)
+        {
+            X64Emitter& e = c._emitter;
+            X64MovReg64Reg64(e, X64Reg::RAX, HOST_MMU);
+            X64Load64(e, X64Reg::RAX, X64Reg::RAX, int32_t(offsetof(MMU, _hram)));
+            X64TestReg64Reg64(e, X64Reg::RAX, X64Reg::RAX);
+            uint32_t mapped = X64JccRel8(e, X64Cond::NZ);
+            EmitExit(c, true, address, 0);
+
+            X64PatchRel8(e, mapped);
+            if (load)
+            {
+                X64Load8(e, X64Reg::RCX, X64Reg::RAX, int8_t(offset));
+                X64Store8(e, HOST_REGS, REG_OFFSET_A, X64Reg::RCX);
+            }
+            else
+            {
+                X64Load8(e, X64Reg::RCX, HOST_REGS, REG_OFFSET_A);
+                X64Store8(e, X64Reg::RAX, int8_t(offset), X64Reg::RCX);
+            }
+
+            c._pendingCycles += 12;
+        }
+
+        // Returns true if the instruction ends the block
+        bool EmitNativeInstruction(BlockCompiler& c, const uint8_t* bytes, uint16_t address)
+        {
+            X64Emitter& e = c._emitter;
+            uint8_t opCode = bytes[0];
+            uint8_t y = (opCode >> 3) & 0x07;
+            uint8_t z = opCode & 0x07;
+            uint8_t p = (opCode >> 4) & 0x03;
+            uint16_t imm16 = uint16_t(bytes[1]) | (uint16_t(bytes[2]) << 8);
+            uint16_t nextPC = address + GetInstructionLength(opCode);
+
+            switch (opCode)
+            {
+            // JR r8 / JR cc, r8
+            case 0x18:
+                EmitExit(c, true, uint16_t(nextPC + int8_t(bytes[1])), 12);
+                return true;
+            case 0x20:
+            case 0x28:
+            case 0x30:
+            case 0x38:
+                EmitConditionalExit(c, y & 0x03, uint16_t(nextPC + int8_t(bytes[1])), 12, nextPC, 8);
+                return true;
+
+            // JP a16 / JP cc, a16
+            case 0xC3:
+                EmitExit(c, true, imm16, 16);
+                return true;
+            case 0xC2:
+            case 0xCA:
+            case 0xD2:
+            case 0xDA:
+                EmitConditionalExit(c, y & 0x03, imm16, 16, nextPC, 12);
+                return true;
+
+            // JP HL
+            case 0xE9:
+                X64Load16Zx(e, X64Reg::RAX, HOST_REGS, REG_OFFSET_HL);
+                X64Store16(e, HOST_REGS, REG_OFFSET_PC, X64Reg::RAX);
+                EmitExit(c, false, 0, 4);
+                return true;
+
+            // LD SP, HL
+            case 0xF9:
+                X64Load16Zx(e, X64Reg::RAX, HOST_REGS, REG_OFFSET_HL);
+                X64Store16(e, HOST_REGS, REG_OFFSET_SP, X64Reg::RAX);
+                c._pendingCycles += 8;
+                return false;
+
+            // LDH (a8), A / LDH A, (a8)
+            case 0xE0:
+            case 0xF0:
+                EmitHRAMAccess(c, address, uint8_t(0xFF00 + bytes[1] - MMU_HRAM_BEGIN), opCode == 0xF0);
+                return false;
+
+            // NOP
+            case 0x00:
+                c._pendingCycles += 4;
+                return false;
+
+            // CPL / SCF / CCF
+            case 0x2F:
+                X64Not8(e, HOST_REGS, REG_OFFSET_A);
+                X64ALU8Imm(e, X64ALUOp::Or, HOST_REGS, REG_OFFSET_F, SF_Subtract | SF_HalfCarry);
+                c._pendingCycles += 4;
+                return false;
+            case 0x37:
+                X64ALU8Imm(e, X64ALUOp::And, HOST_REGS, REG_OFFSET_F, SF_Zero);
+                X64ALU8Imm(e, X64ALUOp::Or, HOST_REGS, REG_OFFSET_F, SF_Carry);
+                c._pendingCycles += 4;
+                return false;
+            case 0x3F:
+                X64ALU8Imm(e, X64ALUOp::And, HOST_REGS, REG_OFFSET_F, SF_Zero | SF_Carry);
+                X64ALU8Imm(e, X64ALUOp::Xor, HOST_REGS, REG_OFFSET_F, SF_Carry);
+                c._pendingCycles += 4;
+                return false;
+
+            default:
+                break;
+            }
+
+            switch (opCode >> 6)
+            {
+            case 0:
+                switch (z)
+                {
+                // LD rr, d16
+                case 1:
+                    X64Store16Imm(e, HOST_REGS, REG16_OFFSET[p], imm16);
+                    c._pendingCycles += 12;
+                    break;
+
+                // INC rr / DEC rr
+                case 3:
+                    if (y & 0x01)
+                    {
+                        X64Dec16(e, HOST_REGS, REG16_OFFSET[p]);
+                    }
+                    else
+                    {
+                        X64Inc16(e, HOST_REGS, REG16_OFFSET[p]);
+                    }
+                    c._pendingCycles += 8;
+                    break;
+
+                // INC r / DEC r
+                case 4:
+                case 5:
+                    EmitIncDec8(e, REG8_OFFSET[y], z == 5);
+                    c._pendingCycles += 4;
+                    break;
+
+                // LD r, d8
+                case 6:
+                    X64Store8Imm(e, HOST_REGS, REG8_OFFSET[y], bytes[1]);
+                    c._pendingCycles += 8;
+                    break;
+
+                default:
+                    EMU_ASSERT("Not a native instruction" && false);
+                    break;
+                }
+                break;
+
+            // LD r, r
+            case 1:
+                X64Load8(e, X64Reg::RAX, HOST_REGS, REG8_OFFSET[z]);
+                X64Store8(e, HOST_REGS, REG8_OFFSET[y], X64Reg::RAX);
+                c._pendingCycles += 4;
+                break;
+
+            // ALU A, r
+            case 2:
+                X64Load8(e, X64Reg::RCX, HOST_REGS, REG8_OFFSET[z]);
+                EmitALU8(e, y);
+                c._pendingCycles += 4;
+                break;
+
+            // ALU A, d8
+            default:
+                X64MovReg32Imm32(e, X64Reg::RCX, bytes[1]);
+                EmitALU8(e, y);
+                c._pendingCycles += 8;
+                break;
+            }
+
+            return false;
+        }
+
+        void EmitInterpretedInstruction(BlockCompiler& c, const uint8_t* bytes, uint16_t address, bool endsBlock)
+        {
+            X64Emitter& e = c._emitter;
+            FlushCycles(c);
+
+            uint32_t instruction = uint32_t(address) | (uint32_t(bytes[0]) << 16) | (uint32_t(bytes[1]) << 24);
+            X64MovReg64Reg64(e, HOST_ARG0, HOST_REGS);
+            X64MovReg64Reg64(e, HOST_ARG1, HOST_MMU);
+            X64MovReg32Imm32(e, HOST_ARG2, instruction);
+            X64MovReg64Imm64(e, X64Reg::RAX, reinterpret_cast<uint64_t>(&InterpretInstruction));
+            X64CallReg(e, X64Reg::RAX);
+
+            // Bail out of the block if the interpreter refused to run it
+            X64TestReg32Reg32(e, X64Reg::RAX, X64Reg::RAX);
+            uint32_t ran = X64JccRel8(e, X64Cond::NZ);
+            EmitExit(c, true, address, 0);
+
+            X64PatchRel8(e, ran);
+            X64ALUReg32Reg32(e, X64ALUOp::Add, HOST_CYCLES, X64Reg::RAX);
+
+            // Branches leave PC wherever they went
+            if (endsBlock)
+            {
+                EmitExit(c, false, 0, 0);
+            }
+        }
+
+        uint8_t* AllocateExecutableMemory(uint32_t size)
+        {
+#if EMU_PLATFORM_WINDOWS
+            return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+#else
+            void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            return (ptr == MAP_FAILED) ? nullptr : static_cast<uint8_t*>(ptr);
+#endif
+        }
+
+        void FreeExecutableMemory(uint8_t* ptr, uint32_t size)
+        {
+#if EMU_PLATFORM_WINDOWS
+            (void)size;
+            VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+            munmap(ptr, size);
+#endif
+        }
+
+        const JITBlock* FindBlock(JIT& jit, const CPU& cpu, const MMU& mmu)
+        {
+            if (!jit._code ||
+                cpu._stallCycles != 0 ||
+                mmu._lockedBus != MMUBus::None ||
+                cpu._decoder._flags != Decoder::DF_None ||
+                cpu._decoder._table != InstructionTable::Default)
+            {
+                return nullptr;
+            }
+
+            uint16_t address = cpu._registers._reg16.PC - 1;
+            if (address >= ROM_END)
+            {
+                return nullptr;
+            }
+
+            // Only code in ROM can be trusted not to change under the block's feet
+            // The boot ROM overlay and DMA are left to the interpreter as well
+            uint16_t segmentIdx = address / MMU_SEGMENT_SIZE;
+            const uint8_t* segment = mmu._segmentPtrs[segmentIdx];
+            if ((mmu._segmentFlags[segmentIdx] & (MMRF_ReadOnly | MMRF_Redirect)) != MMRF_ReadOnly || !segment)
+            {
+                return nullptr;
+            }
+
+            const uint8_t* source = segment + (address % MMU_SEGMENT_SIZE);
+            const JITBlock* block = jit._blockLookup[address];
+            if (block && block->_source == source)
+            {
+                return block;
+            }
+
+            // Only worth translating once it has run a few times, the heat saturates so that
+            // addresses that were hot once go straight to the cache after a bank switch
+            if (jit._blockHeat[address] < JIT_HOT_BLOCK_THRESHOLD && ++jit._blockHeat[address] < JIT_HOT_BLOCK_THRESHOLD)
+            {
+                return nullptr;
+            }
+
+            // Either never seen, or a different bank got mapped in since
+            auto it = jit._blocks.find(source);
+            if (it == jit._blocks.end())
+            {
+                JITBlock compiled = CompileBlock(jit, mmu, address, JIT_MAX_BLOCK_INSTRUCTIONS);
+                it = jit._blocks.emplace(source, compiled).first;
+            }
+
+            jit._blockLookup[address] = &it->second;
+            return &it->second;
+        }
+    }
+
+    bool InitJIT(JIT& jit, uint32_t codeSize)
+    {
+        DestroyJIT(jit);
+
+#if EMU_ARCH_X64
+        jit._code = AllocateExecutableMemory(codeSize);
+#endif
+        if (!jit._code)
+        {
+            return false;
+        }
+
+        jit._codeCapacity = codeSize;
+        jit._codeSize = 0;
+        jit._blockLookup = std::make_unique<const JITBlock*[]>(ROM_END);
+        jit._blockHeat = std::make_unique<uint8_t[]>(ROM_END);
+        jit._stats = {};
+        return true;
+    }
+
+    void DestroyJIT(JIT& jit)
+    {
+        if (jit._code)
+        {
+            FreeExecutableMemory(jit._code, jit._codeCapacity);
+        }
+
+        jit._code = nullptr;
+        jit._codeSize = 0;
+        jit._codeCapacity = 0;
+        jit._blocks.clear();
+        jit._blockLookup.reset();
+        jit._blockHeat.reset();
+    }
+
+    void FlushJIT(JIT& jit)
+    {
+        jit._codeSize = 0;
+        jit._blocks.clear();
+        if (jit._blockLookup)
+        {
+            std::memset(jit._blockLookup.get(), 0, ROM_END * sizeof(const JITBlock*));
+        }
+
+        jit._stats._flushes++;
+    }
+
+    JITBlock CompileBlock(JIT& jit, const MMU& mmu, uint16_t address, uint32_t maxInstructions)
+    {
+        JITBlock block = {};
+        block._address = address;
+        block._source = GetMappedMemory(mmu, address);
+        if (!jit._code || !block._source)
+        {
+            return block;
+        }
+
+        block._firstOpCode = *block._source;
+
+        if (jit._codeCapacity - jit._codeSize < MAX_BLOCK_CODE_SIZE)
+        {
+            FlushJIT(jit);
+        }
+
+        BlockCompiler c = {};
+        c._emitter._code = jit._code + jit._codeSize;
+        c._emitter._capacity = jit._codeCapacity - jit._codeSize;
+        EmitPrologue(c._emitter);
+
+        // ROM blocks stay within their bank, so a block is either mapped as a whole or not at all
+        uint32_t endAddress = (address < ROM_END) ? (address / ROM_BANK_SIZE + 1) * ROM_BANK_SIZE : 0x10000;
+        uint32_t PC = address;
+        uint32_t instructionCount = 0;
+        uint32_t nativeInstructionCount = 0;
+        bool blockEnded = false;
+        while (!blockEnded && instructionCount < maxInstructions)
+        {
+            uint8_t bytes[3] = {};
+            bytes[0] = Peek(mmu, uint16_t(PC));
+
+            uint8_t length = GetInstructionLength(bytes[0]);
+            if (PC + length > endAddress)
+            {
+                break;
+            }
+
+            for (uint8_t i = 1; i < length; ++i)
+            {
+                bytes[i] = Peek(mmu, uint16_t(PC + i));
+            }
+
+            Translation translation = ClassifyInstruction(bytes);
+            if (translation == Translation::Unsupported)
+            {
+                break;
+            }
+
+            // The first instruction always runs, same as a step
+            if (instructionCount > 0)
+            {
+                EmitMaxCyclesCheck(c, uint16_t(PC));
+            }
+
+            if (translation == Translation::Native)
+            {
+                blockEnded = EmitNativeInstruction(c, bytes, uint16_t(PC));
+                nativeInstructionCount++;
+            }
+            else
+            {
+                blockEnded = translation == Translation::InterpretedBranch;
+                EmitInterpretedInstruction(c, bytes, uint16_t(PC), blockEnded);
+            }
+
+            instructionCount++;
+            PC += length;
+        }
+
+        if (!blockEnded)
+        {
+            EmitExit(c, true, uint16_t(PC), 0);
+        }
+
+        EMU_ASSERT(!c._emitter._overflow);
+        if (instructionCount == 0 || c._emitter._overflow)
+        {
+            return block;
+        }
+
+        block._func = reinterpret_cast<JITBlockFn>(c._emitter._code);
+        block._instructionCount = uint8_t(instructionCount);
+        block._nativeInstructionCount = uint8_t(nativeInstructionCount);
+
+        jit._codeSize += c._emitter._size;
+        jit._stats._compiledBlocks++;
+        return block;
+    }
+
+    uint32_t RunBlock(const JITBlock& block, CPU& cpu, MMU& mmu, uint32_t maxCycles)
+    {
+        EMU_ASSERT(IsAtInstructionBoundary(cpu));
+
+        Registers& regs = cpu._registers;
+        if (!block._func ||
+            cpu._decoder._flags != Decoder::DF_None ||
+            cpu._decoder._table != InstructionTable::Default ||
+            regs._reg8.IR != block._firstOpCode ||
+            uint16_t(regs._reg16.PC - 1) != block._address)
+        {
+            return 0;
+        }
+
+        uint32_t cycles = block._func(&regs, &mmu, maxCycles);
+        if (cycles == 0)
+        {
+            // Bailed on the very first instruction, which already got fetched
+            regs._reg16.PC = block._address + 1;
+            return 0;
+        }
+
+        // Overlapping fetch of the next opcode, which can be locked away like any other read
+        regs._reg8.IR = MMURead(mmu, regs._reg16.PC++);
+
+        CompleteStep(cpu, cycles);
+        return cycles;
+    }
+
+    uint32_t StepCPUCompiled(JIT& jit, CPU& cpu, MMU& mmu, uint32_t maxCycles)
+    {
+        // Interrupts only get checked once the block is done, so it has to stop once the timer raises one
+        maxCycles = std::min(maxCycles, GetCyclesUntilTimerInterrupt(cpu));
+
+        const JITBlock* block = FindBlock(jit, cpu, mmu);
+        if (block)
+        {
+            uint32_t cycles = RunBlock(*block, cpu, mmu, maxCycles);
+            if (cycles)
+            {
+                jit._stats._blockRuns++;
+                return cycles;
+            }
+        }
+
+        jit._stats._interpretedSteps++;
+        return StepCPU(cpu, mmu);
+    }
+}
@@ -3,19 +3,171 @@
 
 namespace emu::SM83
 {
-    void MapMemoryRegion(MMU& mmu, uint16_t address, uint32_t size, uint8_t* ptr, uint8_t flags)
+    namespace
+    {
+        struct OpenBusPage
+        {
+            uint8_t _bytes[MMU_SEGMENT_SIZE];
+        };
+
+        constexpr OpenBusPage BuildOpenBusPage()
+        {
+            OpenBusPage page = {};
+            for (uint8_t& byte : page._bytes)
+            {
+                byte = 0xFF;
+            }
+
+            return page;
+        }
+
+        // What reads from unmapped or locked pages see, shared by all MMUs as nothing ever writes to it
+        constexpr const OpenBusPage OPEN_BUS_PAGE = BuildOpenBusPage();
+
+        constexpr const uint16_t OAM_SEGMENT = 0xFE00 / MMU_SEGMENT_SIZE;
+        constexpr const uint16_t IO_SEGMENT = 0xFF00 / MMU_SEGMENT_SIZE;
+
+        bool IsVideoSegment(uint16_t segmentIdx)
+        {
+            return segmentIdx >= (0x8000 / MMU_SEGMENT_SIZE) && segmentIdx < (0xA000 / MMU_SEGMENT_SIZE);
+        }
+
+        constexpr const uint32_t PAGE_TABLE_COUNT = uint32_t(MMUBus::Count) * uint32_t(MMUVideoLock::Count);
+
+        uint8_t GetPageTableIndex(MMUBus bus, MMUVideoLock lock)
+        {
+            return uint8_t(uint32_t(bus) * uint32_t(MMUVideoLock::Count) + uint32_t(lock));
+        }
+
+        // OAM goes along with either bus, IO and HRAM are never locked
+        bool IsSegmentLocked(MMUBus bus, MMUVideoLock lock, uint16_t segmentIdx)
+        {
+            if (segmentIdx == IO_SEGMENT)
+            {
+                return false;
+            }
+
+            if ((lock == MMUVideoLock::OAM && segmentIdx == OAM_SEGMENT) ||
+                (lock == MMUVideoLock::VRAM && IsVideoSegment(segmentIdx)))
+            {
+                return true;
+            }
+
+            if (bus == MMUBus::None)
+            {
+                return false;
+            }
+
+            return segmentIdx == OAM_SEGMENT || IsVideoSegment(segmentIdx) == (bus == MMUBus::Video);
+        }
+
+        // Locked pages stay null in the tables of their locks
+        void SetPage(MMU& mmu, uint16_t segmentIdx, const uint8_t* readPtr, uint8_t* writePtr)
+        {
+            for (uint32_t i = 0; i < PAGE_TABLE_COUNT; ++i)
+            {
+                MMUBus bus = MMUBus(i / uint32_t(MMUVideoLock::Count));
+                MMUVideoLock lock = MMUVideoLock(i % uint32_t(MMUVideoLock::Count));
+                bool locked = IsSegmentLocked(bus, lock, segmentIdx);
+
+                mmu._pageTables[i]._read[segmentIdx] = locked ? nullptr : readPtr;
+                mmu._pageTables[i]._write[segmentIdx] = locked ? nullptr : writePtr;
+            }
+        }
+
+        // Rebuilds a page's read and write pointers from its mapping
+        void UpdateSegment(MMU& mmu, uint16_t segmentIdx)
+        {
+            EMU_ASSERT(segmentIdx < MMU_SEGMENT_COUNT);
+
+            uint16_t mappedIdx = (mmu._segmentFlags[segmentIdx] & MMRF_Redirect) ? MMU_SEGMENT_COUNT : segmentIdx;
+            uint8_t* ptr = mmu._segmentPtrs[mappedIdx];
+            uint8_t flags = mmu._segmentFlags[mappedIdx];
+
+            const uint8_t* readPtr = OPEN_BUS_PAGE._bytes;
+            uint8_t* writePtr = mmu._writeSink;
+            if (ptr)
+            {
+                readPtr = (flags & MMRF_ReadHandler) ? nullptr : ptr;
+
+                // Handlers get to see writes to read-only memory as well
+                if (flags & MMRF_WriteHandler)
+                {
+                    writePtr = nullptr;
+                }
+                else if (!(flags & MMRF_ReadOnly))
+                {
+                    writePtr = ptr;
+                }
+            }
+
+            SetPage(mmu, segmentIdx, readPtr, writePtr);
+        }
+
+        // The boot ROM overlay stays on top of whatever gets mapped below it
+        void RestoreZeroSegmentRedirect(MMU& mmu, uint8_t prevFlags)
+        {
+            if (prevFlags & MMRF_Redirect)
+            {
+                mmu._segmentFlags[0] |= MMRF_Redirect;
+                UpdateSegment(mmu, 0);
+            }
+        }
+
+        uint8_t MMIORead(const MMU& mmu, uint16_t segmentIdx, uint16_t address)
+        {
+            const MMIOHandler& handler = mmu._segmentHandlers[segmentIdx];
+            return handler._read(handler._context, address);
+        }
+
+        void MMIOWrite(MMU& mmu, uint16_t segmentIdx, uint16_t address, uint8_t val)
+        {
+            const MMIOHandler& handler = mmu._segmentHandlers[segmentIdx];
+            handler._write(handler._context, mmu, address, val);
+        }
+    }
+
+    void MapMemoryRegion(MMU& mmu, uint16_t address, uint32_t size, uint8_t* ptr, uint8_t flags, const MMIOHandler* handler)
     {
         EMU_ASSERT((address % MMU_SEGMENT_SIZE) == 0);
         EMU_ASSERT(size > 0 && (size % MMU_SEGMENT_SIZE) == 0);
         EMU_ASSERT(uint32_t(address) + size <= 0x10000);
+        EMU_ASSERT(ptr);
 
         uint16_t startSegment = address / MMU_SEGMENT_SIZE;
         uint16_t numSegments = size / MMU_SEGMENT_SIZE;
+        uint8_t zeroSegmentFlags = mmu._segmentFlags[0];
+
+        // Handlers only ever get looked at through the flags, so there's no need to clear them otherwise
+        flags &= ~(MMRF_ReadHandler | MMRF_WriteHandler);
+        if (handler)
+        {
+            flags |= (handler->_read ? MMRF_ReadHandler : 0) | (handler->_write ? MMRF_WriteHandler : 0);
+        }
+
+        if (startSegment + numSegments > IO_SEGMENT)
+        {
+            mmu._hram = nullptr;
+        }
 
         for (uint16_t i = 0; i < numSegments; ++i)
         {
             mmu._segmentPtrs[startSegment + i] = ptr + i * MMU_SEGMENT_SIZE;
             mmu._segmentFlags[startSegment + i] = flags;
+            UpdateSegment(mmu, startSegment + i);
+        }
+
+        if (handler)
+        {
+            for (uint16_t i = 0; i < numSegments; ++i)
+            {
+                mmu._segmentHandlers[startSegment + i] = *handler;
+            }
+        }
+
+        if (startSegment == 0)
+        {
+            RestoreZeroSegmentRedirect(mmu, zeroSegmentFlags);
         }
     }
 
@@ -27,19 +179,38 @@ namespace emu::SM83
 
         uint16_t startSegment = address / MMU_SEGMENT_SIZE;
         uint16_t numSegments = size / MMU_SEGMENT_SIZE;
+        uint8_t zeroSegmentFlags = mmu._segmentFlags[0];
+
+        if (startSegment + numSegments > IO_SEGMENT)
+        {
+            mmu._hram = nullptr;
+        }
 
         for (uint16_t i = 0; i < numSegments; ++i)
         {
             mmu._segmentPtrs[startSegment + i] = nullptr;
             mmu._segmentFlags[startSegment + i] = 0;
+            UpdateSegment(mmu, startSegment + i);
+        }
+
+        if (startSegment == 0)
+        {
+            RestoreZeroSegmentRedirect(mmu, zeroSegmentFlags);
         }
     }
 
+    void MapHRAM(MMU& mmu, uint8_t* ptr)
+    {
+        EMU_ASSERT(mmu._segmentPtrs[IO_SEGMENT]);
+        mmu._hram = ptr;
+    }
+
     void RedirectZeroSegment(MMU& mmu, uint8_t* ptr)
     {
         mmu._segmentFlags[0] |= MMRF_Redirect;
         mmu._segmentFlags[MMU_SEGMENT_COUNT] = MMRF_ReadOnly;
         mmu._segmentPtrs[MMU_SEGMENT_COUNT] = ptr;
+        UpdateSegment(mmu, 0);
     }
 
     void RemoveZeroSegmentRedirect(MMU& mmu)
@@ -47,55 +218,91 @@ namespace emu::SM83
         mmu._segmentPtrs[MMU_SEGMENT_COUNT] = nullptr;
         mmu._segmentFlags[MMU_SEGMENT_COUNT] = 0;
         mmu._segmentFlags[0] &= ~MMRF_Redirect;
+        UpdateSegment(mmu, 0);
+    }
+
+    void LockBus(MMU& mmu, MMUBus bus)
+    {
+        EMU_ASSERT(bus < MMUBus::Count);
+        mmu._lockedBus = bus;
+        mmu._pageTableIdx = GetPageTableIndex(bus, mmu._videoLock);
+    }
+
+    void UnlockBus(MMU& mmu)
+    {
+        LockBus(mmu, MMUBus::None);
+    }
+
+    void SetVideoLock(MMU& mmu, MMUVideoLock lock)
+    {
+        EMU_ASSERT(lock < MMUVideoLock::Count);
+        mmu._videoLock = lock;
+        mmu._pageTableIdx = GetPageTableIndex(mmu._lockedBus, lock);
     }
 
-    void MMUWrite(MMU& mmu, uint16_t address, uint8_t val)
+    bool IsVideoLocked(const MMU& mmu, uint16_t address)
     {
-        mmu._address = address;
-        mmu._RW = MMU_WRITE;
-        mmu._data = val;
+        return IsSegmentLocked(MMUBus::None, mmu._videoLock, address / MMU_SEGMENT_SIZE);
+    }
 
+    const uint8_t* GetMappedMemory(const MMU& mmu, uint16_t address)
+    {
         uint16_t segmentIdx = address / MMU_SEGMENT_SIZE;
         if (mmu._segmentFlags[segmentIdx] & MMRF_Redirect)
         {
             segmentIdx = MMU_SEGMENT_COUNT;
         }
 
-        if (mmu._segmentFlags[segmentIdx] & MMRF_ReadOnly ||
-            mmu._segmentFlags[segmentIdx] & MMRF_DMALock ||
+        const uint8_t* ptr = mmu._segmentPtrs[segmentIdx];
+        return ptr ? ptr + address % MMU_SEGMENT_SIZE : nullptr;
+    }
+
+    void MMUWriteSlow(MMU& mmu, uint16_t address, uint8_t val)
+    {
+        // The boot ROM overlay always has a page of its own, so it never gets here
+        uint16_t segmentIdx = address / MMU_SEGMENT_SIZE;
+        EMU_ASSERT(!(mmu._segmentFlags[segmentIdx] & MMRF_Redirect));
+
+        if (IsSegmentLocked(mmu._lockedBus, mmu._videoLock, segmentIdx) ||
             !mmu._segmentPtrs[segmentIdx])
         {
             return;
         }
 
+        // Handlers get to see writes to read-only memory as well
+        if (mmu._segmentFlags[segmentIdx] & MMRF_WriteHandler)
+        {
+            MMIOWrite(mmu, segmentIdx, address, val);
+            return;
+        }
+
+        if (mmu._segmentFlags[segmentIdx] & MMRF_ReadOnly)
+        {
+            return;
+        }
+
         uint16_t offsetInSegment = address % MMU_SEGMENT_SIZE;
         mmu._segmentPtrs[segmentIdx][offsetInSegment] = val;
     }
 
-    uint8_t MMURead(MMU& mmu, uint16_t address)
+    uint8_t MMUReadSlow(const MMU& mmu, uint16_t address)
     {
-        mmu._address = address;
-        mmu._RW = MMU_READ;
-
+        // The boot ROM overlay always has a page of its own, so it never gets here
         uint16_t segmentIdx = address / MMU_SEGMENT_SIZE;
-        if (mmu._segmentFlags[segmentIdx] & MMRF_Redirect)
-        {
-            segmentIdx = MMU_SEGMENT_COUNT;
-        }
+        EMU_ASSERT(!(mmu._segmentFlags[segmentIdx] & MMRF_Redirect));
 
-        uint8_t val = 0;
-        if (!mmu._segmentPtrs[segmentIdx] || 
-            mmu._segmentFlags[segmentIdx] & MMRF_DMALock)
+        if (IsSegmentLocked(mmu._lockedBus, mmu._videoLock, segmentIdx) ||
+            !mmu._segmentPtrs[segmentIdx])
         {
-            val = 0xFF;
+            return 0xFF;
         }
-        else
+
+        if (mmu._segmentFlags[segmentIdx] & MMRF_ReadHandler)
         {
-            uint16_t offsetInSegment = address % MMU_SEGMENT_SIZE;
-            val = mmu._segmentPtrs[segmentIdx][offsetInSegment];
+            return MMIORead(mmu, segmentIdx, address);
         }
 
-        mmu._data = val;
-        return val;
+        uint16_t offsetInSegment = address % MMU_SEGMENT_SIZE;
+        return mmu._segmentPtrs[segmentIdx][offsetInSegment];
     }
-}
\ No newline at end of file
+}
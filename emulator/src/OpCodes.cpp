@@ -7,19 +7,19 @@ namespace emu::SM83
     namespace
     {
 
-        const char* OPCODE_NAMES[] =
+        constexpr const char* const OPCODE_NAMES[] =
         {
             #include "OpCodeNames.hpp"
         };
         static_assert(sizeof(OPCODE_NAMES) / sizeof(OPCODE_NAMES[0]) == 256);
 
-        const char* PREFIX_OPCODE_NAMES[] =
+        constexpr const char* const PREFIX_OPCODE_NAMES[] =
         {
             #include "PrefixOpCodeNames.hpp"
         };
         static_assert(sizeof(PREFIX_OPCODE_NAMES) / sizeof(PREFIX_OPCODE_NAMES[0]) == 256);
 
-        const char** OPCODE_NAME_TABLES[] =
+        constexpr const char* const* const OPCODE_NAME_TABLES[] =
         {
             OPCODE_NAMES,
             PREFIX_OPCODE_NAMES
@@ -32,16 +32,16 @@ namespace emu::SM83
             std::array<MCycle, MAX_MCYCLE_COUNT> _cycles;
         };
 
-        Instruction INSTRUCTIONS[0x100] = {};
-        Instruction PREFIX_INSTRUCTIONS[0x100] = {};
-        Instruction INTERRUPT_INSTRUCTIONS[0x100] = {};
+        constexpr const uint32_t INTERRUPT_COUNT = 5;
 
-        const Instruction* INSTRUCTION_TABLES[] = 
+        using InstructionArray = std::array<Instruction, 0x100>;
+        using InterruptInstructionArray = std::array<Instruction, INTERRUPT_COUNT>;
+
+        // Interrupt vectors are 8 bytes apart, starting with VBLANK
+        constexpr uint32_t GetInterruptIndex(uint8_t vector)
         {
-            INSTRUCTIONS,
-            PREFIX_INSTRUCTIONS,
-            INTERRUPT_INSTRUCTIONS
-        };
+            return uint32_t(vector - INT_VBLANK) / 8;
+        }
 
         constexpr const RegisterOperand REGISTER_OPERAND_LUT[]
         {
@@ -55,22 +55,22 @@ namespace emu::SM83
             RegisterOperand::RegA
         };
 
-        inline RegisterOperand OpCodeRegisterIndexToRegisterOperand(uint8_t regIdx)
+        constexpr RegisterOperand OpCodeRegisterIndexToRegisterOperand(uint8_t regIdx)
         {
             return REGISTER_OPERAND_LUT[regIdx];
         }
 
-        inline RegisterOperand WideRegisterLSB(RegisterOperand reg)
+        constexpr RegisterOperand WideRegisterLSB(RegisterOperand reg)
         {
             return RegisterOperand((uint8_t(reg) - uint8_t(RegisterOperand::WideRegisterStart)) * 2 + 0);
         }
 
-        inline RegisterOperand WideRegisterMSB(RegisterOperand reg)
+        constexpr RegisterOperand WideRegisterMSB(RegisterOperand reg)
         {
             return RegisterOperand((uint8_t(reg) - uint8_t(RegisterOperand::WideRegisterStart)) * 2 + 1);
         }
 
-        MCycle::ALU MakeALU(
+        constexpr MCycle::ALU MakeALU(
             ALUOp op,
             RegisterOperand operandA,
             RegisterOperand operandB)
@@ -83,7 +83,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::ALU MakeALUExt(
+        constexpr MCycle::ALU MakeALUExt(
             ALUOp op,
             RegisterOperand operandA,
             RegisterOperand operandB,
@@ -97,7 +97,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::ALU NoALU()
+        constexpr MCycle::ALU NoALU()
         {
             return {
                 ._op = ALUOp::Nop,
@@ -107,7 +107,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::IDU MakeIDU(
+        constexpr MCycle::IDU MakeIDU(
             IDUOp op,
             RegisterOperand operand)
         {
@@ -118,7 +118,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::IDU MakeIDUExt(
+        constexpr MCycle::IDU MakeIDUExt(
             IDUOp op,
             RegisterOperand operand,
             RegisterOperand dest)
@@ -130,7 +130,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::IDU NoIDU()
+        constexpr MCycle::IDU NoIDU()
         {
             return {
                 ._op = IDUOp::Nop,
@@ -139,7 +139,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::MemOp MakeMemRead(
+        constexpr MCycle::MemOp MakeMemRead(
             RegisterOperand addressSrc,
             RegisterOperand dest)
         {
@@ -150,7 +150,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::MemOp MakeMemWrite(
+        constexpr MCycle::MemOp MakeMemWrite(
             RegisterOperand src,
             RegisterOperand addressSrc)
         {
@@ -161,7 +161,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::MemOp MakeMemReadWithOffset(
+        constexpr MCycle::MemOp MakeMemReadWithOffset(
             RegisterOperand addressSrc,
             RegisterOperand dest)
         {
@@ -172,7 +172,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::MemOp MakeMemWriteWithOffset(
+        constexpr MCycle::MemOp MakeMemWriteWithOffset(
             RegisterOperand src,
             RegisterOperand addressDest)
         {
@@ -183,14 +183,14 @@ namespace emu::SM83
             };
         }
 
-        MCycle::MemOp NoMem()
+        constexpr MCycle::MemOp NoMem()
         {
             return {
                 ._flags = 0,
             };
         }
 
-        MCycle::Misc MakeMisc(uint16_t miscFlags, RegisterOperand operand = RegisterOperand::None, uint16_t optValue = 0)
+        constexpr MCycle::Misc MakeMisc(uint16_t miscFlags, RegisterOperand operand = RegisterOperand::None, uint16_t optValue = 0)
         {
             return {
                 ._flags = miscFlags,
@@ -199,7 +199,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::Misc MakeMiscCheckC(uint8_t cycleIndexToJumpTo)
+        constexpr MCycle::Misc MakeMiscCheckC(uint8_t cycleIndexToJumpTo)
         {
             return {
                 ._flags = MCycle::Misc::MF_ConditionCheckC,
@@ -208,7 +208,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::Misc MakeMiscCheckNC(uint8_t cycleIndexToJumpTo)
+        constexpr MCycle::Misc MakeMiscCheckNC(uint8_t cycleIndexToJumpTo)
         {
             return {
                 ._flags = MCycle::Misc::MF_ConditionCheckNC,
@@ -217,7 +217,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::Misc MakeMiscCheckZ(uint8_t cycleIndexToJumpTo)
+        constexpr MCycle::Misc MakeMiscCheckZ(uint8_t cycleIndexToJumpTo)
         {
             return {
                 ._flags = MCycle::Misc::MF_ConditionCheckZ,
@@ -226,7 +226,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::Misc MakeMiscCheckNZ(uint8_t cycleIndexToJumpTo)
+        constexpr MCycle::Misc MakeMiscCheckNZ(uint8_t cycleIndexToJumpTo)
         {
             return {
                 ._flags = MCycle::Misc::MF_ConditionCheckNZ,
@@ -235,7 +235,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle::Misc NoMisc()
+        constexpr MCycle::Misc NoMisc()
         {
             return {
                 ._flags = MCycle::Misc::MF_None,
@@ -243,7 +243,7 @@ namespace emu::SM83
             };
         }
 
-        MCycle MakeCycle(
+        constexpr MCycle MakeCycle(
             const MCycle::ALU& alu,
             const MCycle::IDU& idu,
             const MCycle::MemOp& memOp,
@@ -257,21 +257,30 @@ namespace emu::SM83
             };
         }
 
-        const MCycle FETCH_MCYCLE = MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::RegIR));
+        constexpr const MCycle FETCH_MCYCLE = MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::RegIR));
 
-        Instruction MakeInstruction(std::initializer_list<MCycle> cycles)
+        constexpr Instruction MakeInstruction(std::initializer_list<MCycle> cycles)
         {
             EMU_ASSERT(cycles.size() <= MAX_MCYCLE_COUNT);
             Instruction instruction =
             {
                 ._cycleCount = uint32_t(cycles.size()),
+                ._cycles = {}
             };
 
-            std::memcpy(instruction._cycles.data(), cycles.begin(), sizeof(MCycle) * std::min(MAX_MCYCLE_COUNT, instruction._cycleCount));
+            uint32_t i = 0;
+            for (const MCycle& cycle : cycles)
+            {
+                if (i < MAX_MCYCLE_COUNT)
+                {
+                    instruction._cycles[i++] = cycle;
+                }
+            }
+
             return instruction;
         }
 
-        void PopulateQuadrant00BasicIncDecInstructions()
+        constexpr void PopulateQuadrant00BasicIncDecInstructions(InstructionArray& instructions)
         {
             auto MakeIncInstruction = [](RegisterOperand operand) -> Instruction
             {
@@ -288,24 +297,24 @@ namespace emu::SM83
             };
 
 
-            INSTRUCTIONS[0x04] = MakeIncInstruction(RegisterOperand::RegB);
-            INSTRUCTIONS[0x0C] = MakeIncInstruction(RegisterOperand::RegC);
-            INSTRUCTIONS[0x14] = MakeIncInstruction(RegisterOperand::RegD);
-            INSTRUCTIONS[0x1C] = MakeIncInstruction(RegisterOperand::RegE);
-            INSTRUCTIONS[0x24] = MakeIncInstruction(RegisterOperand::RegH);
-            INSTRUCTIONS[0x2C] = MakeIncInstruction(RegisterOperand::RegL);
-            INSTRUCTIONS[0x3C] = MakeIncInstruction(RegisterOperand::RegA);
-
-            INSTRUCTIONS[0x05] = MakeDecInstruction(RegisterOperand::RegB);
-            INSTRUCTIONS[0x0D] = MakeDecInstruction(RegisterOperand::RegC);
-            INSTRUCTIONS[0x15] = MakeDecInstruction(RegisterOperand::RegD);
-            INSTRUCTIONS[0x1D] = MakeDecInstruction(RegisterOperand::RegE);
-            INSTRUCTIONS[0x25] = MakeDecInstruction(RegisterOperand::RegH);
-            INSTRUCTIONS[0x2D] = MakeDecInstruction(RegisterOperand::RegL);
-            INSTRUCTIONS[0x3D] = MakeDecInstruction(RegisterOperand::RegA);
+            instructions[0x04] = MakeIncInstruction(RegisterOperand::RegB);
+            instructions[0x0C] = MakeIncInstruction(RegisterOperand::RegC);
+            instructions[0x14] = MakeIncInstruction(RegisterOperand::RegD);
+            instructions[0x1C] = MakeIncInstruction(RegisterOperand::RegE);
+            instructions[0x24] = MakeIncInstruction(RegisterOperand::RegH);
+            instructions[0x2C] = MakeIncInstruction(RegisterOperand::RegL);
+            instructions[0x3C] = MakeIncInstruction(RegisterOperand::RegA);
+
+            instructions[0x05] = MakeDecInstruction(RegisterOperand::RegB);
+            instructions[0x0D] = MakeDecInstruction(RegisterOperand::RegC);
+            instructions[0x15] = MakeDecInstruction(RegisterOperand::RegD);
+            instructions[0x1D] = MakeDecInstruction(RegisterOperand::RegE);
+            instructions[0x25] = MakeDecInstruction(RegisterOperand::RegH);
+            instructions[0x2D] = MakeDecInstruction(RegisterOperand::RegL);
+            instructions[0x3D] = MakeDecInstruction(RegisterOperand::RegA);
         }
 
-        void PopulateQuadrant0016BitIncDecInstructions()
+        constexpr void PopulateQuadrant0016BitIncDecInstructions(InstructionArray& instructions)
         {
             auto MakeIncInstruction = [](RegisterOperand operand) -> Instruction
             {
@@ -323,18 +332,18 @@ namespace emu::SM83
                     });
             };
 
-            INSTRUCTIONS[0x03] = MakeIncInstruction(RegisterOperand::RegBC);
-            INSTRUCTIONS[0x13] = MakeIncInstruction(RegisterOperand::RegDE);
-            INSTRUCTIONS[0x23] = MakeIncInstruction(RegisterOperand::RegHL);
-            INSTRUCTIONS[0x33] = MakeIncInstruction(RegisterOperand::RegSP);
+            instructions[0x03] = MakeIncInstruction(RegisterOperand::RegBC);
+            instructions[0x13] = MakeIncInstruction(RegisterOperand::RegDE);
+            instructions[0x23] = MakeIncInstruction(RegisterOperand::RegHL);
+            instructions[0x33] = MakeIncInstruction(RegisterOperand::RegSP);
 
-            INSTRUCTIONS[0x0B] = MakeDecInstruction(RegisterOperand::RegBC);
-            INSTRUCTIONS[0x1B] = MakeDecInstruction(RegisterOperand::RegDE);
-            INSTRUCTIONS[0x2B] = MakeDecInstruction(RegisterOperand::RegHL);
-            INSTRUCTIONS[0x3B] = MakeDecInstruction(RegisterOperand::RegSP);
+            instructions[0x0B] = MakeDecInstruction(RegisterOperand::RegBC);
+            instructions[0x1B] = MakeDecInstruction(RegisterOperand::RegDE);
+            instructions[0x2B] = MakeDecInstruction(RegisterOperand::RegHL);
+            instructions[0x3B] = MakeDecInstruction(RegisterOperand::RegSP);
         }
 
-        void PopulateQuadrant00ImmediateLDInstructions()
+        constexpr void PopulateQuadrant00ImmediateLDInstructions(InstructionArray& instructions)
         {
             auto MakeImmLDInstruction = [](RegisterOperand operand) -> Instruction
             {
@@ -344,16 +353,16 @@ namespace emu::SM83
                     });
             };
 
-            INSTRUCTIONS[0x06] = MakeImmLDInstruction(RegisterOperand::RegB);
-            INSTRUCTIONS[0x0E] = MakeImmLDInstruction(RegisterOperand::RegC);
-            INSTRUCTIONS[0x16] = MakeImmLDInstruction(RegisterOperand::RegD);
-            INSTRUCTIONS[0x1E] = MakeImmLDInstruction(RegisterOperand::RegE);
-            INSTRUCTIONS[0x26] = MakeImmLDInstruction(RegisterOperand::RegH);
-            INSTRUCTIONS[0x2E] = MakeImmLDInstruction(RegisterOperand::RegL);
-            INSTRUCTIONS[0x3E] = MakeImmLDInstruction(RegisterOperand::RegA);
+            instructions[0x06] = MakeImmLDInstruction(RegisterOperand::RegB);
+            instructions[0x0E] = MakeImmLDInstruction(RegisterOperand::RegC);
+            instructions[0x16] = MakeImmLDInstruction(RegisterOperand::RegD);
+            instructions[0x1E] = MakeImmLDInstruction(RegisterOperand::RegE);
+            instructions[0x26] = MakeImmLDInstruction(RegisterOperand::RegH);
+            instructions[0x2E] = MakeImmLDInstruction(RegisterOperand::RegL);
+            instructions[0x3E] = MakeImmLDInstruction(RegisterOperand::RegA);
         }
 
-        void PopulateQuadrant0016BitImmediateLDInstructions()
+        constexpr void PopulateQuadrant0016BitImmediateLDInstructions(InstructionArray& instructions)
         {
             auto MakeImmLDInstruction = [](RegisterOperand operand) -> Instruction
             {
@@ -364,13 +373,13 @@ namespace emu::SM83
                     });
             };
 
-            INSTRUCTIONS[0x01] = MakeImmLDInstruction(RegisterOperand::RegBC);
-            INSTRUCTIONS[0x11] = MakeImmLDInstruction(RegisterOperand::RegDE);
-            INSTRUCTIONS[0x21] = MakeImmLDInstruction(RegisterOperand::RegHL);
-            INSTRUCTIONS[0x31] = MakeImmLDInstruction(RegisterOperand::RegSP);
+            instructions[0x01] = MakeImmLDInstruction(RegisterOperand::RegBC);
+            instructions[0x11] = MakeImmLDInstruction(RegisterOperand::RegDE);
+            instructions[0x21] = MakeImmLDInstruction(RegisterOperand::RegHL);
+            instructions[0x31] = MakeImmLDInstruction(RegisterOperand::RegSP);
         }
 
-        void PopulateQuadrant0016BitALUInstructions()
+        constexpr void PopulateQuadrant0016BitALUInstructions(InstructionArray& instructions)
         {
             auto Make16BitAddInstruction = [](RegisterOperand operandA, RegisterOperand operandB) -> Instruction
             {
@@ -380,13 +389,13 @@ namespace emu::SM83
                 });
             };
 
-            INSTRUCTIONS[0x09] = Make16BitAddInstruction(RegisterOperand::RegHL, RegisterOperand::RegBC);
-            INSTRUCTIONS[0x19] = Make16BitAddInstruction(RegisterOperand::RegHL, RegisterOperand::RegDE);
-            INSTRUCTIONS[0x29] = Make16BitAddInstruction(RegisterOperand::RegHL, RegisterOperand::RegHL);
-            INSTRUCTIONS[0x39] = Make16BitAddInstruction(RegisterOperand::RegHL, RegisterOperand::RegSP);
+            instructions[0x09] = Make16BitAddInstruction(RegisterOperand::RegHL, RegisterOperand::RegBC);
+            instructions[0x19] = Make16BitAddInstruction(RegisterOperand::RegHL, RegisterOperand::RegDE);
+            instructions[0x29] = Make16BitAddInstruction(RegisterOperand::RegHL, RegisterOperand::RegHL);
+            instructions[0x39] = Make16BitAddInstruction(RegisterOperand::RegHL, RegisterOperand::RegSP);
         }
 
-        void PopulateQuadrant00IndirectStoreLDInstructions()
+        constexpr void PopulateQuadrant00IndirectStoreLDInstructions(InstructionArray& instructions)
         {
             auto MakeIndStoreLDInstruction = [](RegisterOperand src, RegisterOperand dest) -> Instruction
             {
@@ -404,13 +413,13 @@ namespace emu::SM83
                     });
             };
 
-            INSTRUCTIONS[0x02] = MakeIndStoreLDInstruction(RegisterOperand::RegA, RegisterOperand::RegBC);
-            INSTRUCTIONS[0x12] = MakeIndStoreLDInstruction(RegisterOperand::RegA, RegisterOperand::RegDE);
-            INSTRUCTIONS[0x22] = MakeIndStoreLDInstructionWithIncDec(RegisterOperand::RegA, RegisterOperand::RegHL, IDUOp::Inc);
-            INSTRUCTIONS[0x32] = MakeIndStoreLDInstructionWithIncDec(RegisterOperand::RegA, RegisterOperand::RegHL, IDUOp::Dec);
+            instructions[0x02] = MakeIndStoreLDInstruction(RegisterOperand::RegA, RegisterOperand::RegBC);
+            instructions[0x12] = MakeIndStoreLDInstruction(RegisterOperand::RegA, RegisterOperand::RegDE);
+            instructions[0x22] = MakeIndStoreLDInstructionWithIncDec(RegisterOperand::RegA, RegisterOperand::RegHL, IDUOp::Inc);
+            instructions[0x32] = MakeIndStoreLDInstructionWithIncDec(RegisterOperand::RegA, RegisterOperand::RegHL, IDUOp::Dec);
         }
 
-        void PopulateQuadrant00IndirectLDInstructions()
+        constexpr void PopulateQuadrant00IndirectLDInstructions(InstructionArray& instructions)
         {
             auto MakeIndirectLDInstruction = [](RegisterOperand src, RegisterOperand dest) -> Instruction
             {
@@ -428,13 +437,13 @@ namespace emu::SM83
                 });
             };
 
-            INSTRUCTIONS[0x0A] = MakeIndirectLDInstruction(RegisterOperand::RegBC, RegisterOperand::RegA);
-            INSTRUCTIONS[0x1A] = MakeIndirectLDInstruction(RegisterOperand::RegDE, RegisterOperand::RegA);
-            INSTRUCTIONS[0x2A] = MakeIndirectLDInstructionWithIncDec(RegisterOperand::RegHL, RegisterOperand::RegA, IDUOp::Inc);
-            INSTRUCTIONS[0x3A] = MakeIndirectLDInstructionWithIncDec(RegisterOperand::RegHL, RegisterOperand::RegA, IDUOp::Dec);
+            instructions[0x0A] = MakeIndirectLDInstruction(RegisterOperand::RegBC, RegisterOperand::RegA);
+            instructions[0x1A] = MakeIndirectLDInstruction(RegisterOperand::RegDE, RegisterOperand::RegA);
+            instructions[0x2A] = MakeIndirectLDInstructionWithIncDec(RegisterOperand::RegHL, RegisterOperand::RegA, IDUOp::Inc);
+            instructions[0x3A] = MakeIndirectLDInstructionWithIncDec(RegisterOperand::RegHL, RegisterOperand::RegA, IDUOp::Dec);
         }
 
-        void PopulateQuadrant00IndirectIncDecInstructions()
+        constexpr void PopulateQuadrant00IndirectIncDecInstructions(InstructionArray& instructions)
         {
             auto MakeIndirectIncDecInstruction = [](ALUOp op, RegisterOperand dest) -> Instruction
             {
@@ -445,11 +454,11 @@ namespace emu::SM83
                 });
             };
 
-            INSTRUCTIONS[0x34] = MakeIndirectIncDecInstruction(ALUOp::Inc, RegisterOperand::RegHL);
-            INSTRUCTIONS[0x35] = MakeIndirectIncDecInstruction(ALUOp::Dec, RegisterOperand::RegHL);
+            instructions[0x34] = MakeIndirectIncDecInstruction(ALUOp::Inc, RegisterOperand::RegHL);
+            instructions[0x35] = MakeIndirectIncDecInstruction(ALUOp::Dec, RegisterOperand::RegHL);
         }
 
-        void PopulateQuadrant00BitwiseInstructions()
+        constexpr void PopulateQuadrant00BitwiseInstructions(InstructionArray& instructions)
         {
             auto MakeALUInstruction = [](ALUOp op, RegisterOperand operand) -> Instruction
             {
@@ -458,28 +467,28 @@ namespace emu::SM83
                 });
             };
 
-            INSTRUCTIONS[0x07] = MakeALUInstruction(ALUOp::Rlc, RegisterOperand::RegA);
-            INSTRUCTIONS[0x17] = MakeALUInstruction(ALUOp::Rl, RegisterOperand::RegA);
-            INSTRUCTIONS[0x0F] = MakeALUInstruction(ALUOp::Rrc, RegisterOperand::RegA);
-            INSTRUCTIONS[0x1F] = MakeALUInstruction(ALUOp::Rr, RegisterOperand::RegA);
+            instructions[0x07] = MakeALUInstruction(ALUOp::Rlc, RegisterOperand::RegA);
+            instructions[0x17] = MakeALUInstruction(ALUOp::Rl, RegisterOperand::RegA);
+            instructions[0x0F] = MakeALUInstruction(ALUOp::Rrc, RegisterOperand::RegA);
+            instructions[0x1F] = MakeALUInstruction(ALUOp::Rr, RegisterOperand::RegA);
         }
 
-        void PopulateQuadrant00MiscInstructions()
+        constexpr void PopulateQuadrant00MiscInstructions(InstructionArray& instructions)
         {
             // STOP
-            INSTRUCTIONS[0x10] = MakeInstruction({
+            instructions[0x10] = MakeInstruction({
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMisc(MCycle::Misc::MF_StopExecution))
             });
 
             // LD (HL), d8
-            INSTRUCTIONS[0x36] = MakeInstruction({
+            instructions[0x36] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), NoIDU(), MakeMemWrite(RegisterOperand::TempRegZ, RegisterOperand::RegHL)),
                 MakeCycle(NoALU(), NoIDU(), NoMem())
             });
 
             // LD (a16), SP
-            INSTRUCTIONS[0x08] = MakeInstruction({
+            instructions[0x08] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegWZ), MakeMemWrite(RegisterOperand::RegSPL, RegisterOperand::RegWZ)),
@@ -488,27 +497,27 @@ namespace emu::SM83
             });
 
             // DAA
-            INSTRUCTIONS[0x27] = MakeInstruction({
+            instructions[0x27] = MakeInstruction({
                 MakeCycle(MakeALU(ALUOp::Da, RegisterOperand::RegA, RegisterOperand::RegA), NoIDU(), NoMem())
             });
 
             // SCF
-            INSTRUCTIONS[0x37] = MakeInstruction({
+            instructions[0x37] = MakeInstruction({
                 MakeCycle(MakeALU(ALUOp::Scf, RegisterOperand::RegA, RegisterOperand::RegA), NoIDU(), NoMem())
             });
 
             // CPL
-            INSTRUCTIONS[0x2F] = MakeInstruction({
+            instructions[0x2F] = MakeInstruction({
                 MakeCycle(MakeALU(ALUOp::Cpl, RegisterOperand::RegA, RegisterOperand::RegA), NoIDU(), NoMem())
             });
 
             // CCF
-            INSTRUCTIONS[0x3F] = MakeInstruction({
+            instructions[0x3F] = MakeInstruction({
                 MakeCycle(MakeALU(ALUOp::Ccf, RegisterOperand::RegA, RegisterOperand::RegA), NoIDU(), NoMem())
             });
 
             // JR r8
-            INSTRUCTIONS[0x18] = MakeInstruction({
+            instructions[0x18] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(MakeALU(ALUOp::Add, RegisterOperand::TempRegZ, RegisterOperand::RegPCL), MakeIDUExt(IDUOp::Adjust, RegisterOperand::RegPCH, RegisterOperand::TempRegW), NoMem(), MakeMisc(MCycle::Misc::MF_ALUKeepFlags)),
                 MakeCycle(NoALU(), MakeIDUExt(IDUOp::Inc, RegisterOperand::RegWZ, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegWZ, RegisterOperand::RegIR))
@@ -516,7 +525,7 @@ namespace emu::SM83
             });
 
             // JR NZ, r8
-            INSTRUCTIONS[0x20] = MakeInstruction({
+            instructions[0x20] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ), MakeMiscCheckNZ(2)),
 
                 // NZ false
@@ -528,7 +537,7 @@ namespace emu::SM83
             });
 
             // JR Z, r8
-            INSTRUCTIONS[0x28] = MakeInstruction({
+            instructions[0x28] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ), MakeMiscCheckZ(2)),
 
                 // Z false
@@ -540,7 +549,7 @@ namespace emu::SM83
             });
 
             // JR NC, r8
-            INSTRUCTIONS[0x30] = MakeInstruction({
+            instructions[0x30] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ), MakeMiscCheckNC(2)),
 
                 // NC false
@@ -552,7 +561,7 @@ namespace emu::SM83
             });
 
             // JR C, r8
-            INSTRUCTIONS[0x38] = MakeInstruction({
+            instructions[0x38] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ), MakeMiscCheckC(2)),
 
                 // C false
@@ -564,7 +573,7 @@ namespace emu::SM83
             });
         }
 
-        void PopulateQuadrant01BasicLDInstructions()
+        constexpr void PopulateQuadrant01BasicLDInstructions(InstructionArray& instructions)
         {
             // LD instructions: |01|yyy|zzz|
             // yyy: Dest, zzz: Src
@@ -576,14 +585,14 @@ namespace emu::SM83
                     if (z == 6) continue;           // Handle (HL) operand separately
 
                     uint8_t op = 0x40 | ((y & 0x07) << 3) | (z & 0x07);
-                    INSTRUCTIONS[op] = MakeInstruction({
+                    instructions[op] = MakeInstruction({
                             MakeCycle(MakeALU(ALUOp::Nop, OpCodeRegisterIndexToRegisterOperand(y), OpCodeRegisterIndexToRegisterOperand(z)), NoIDU(), NoMem())
                         });
                 }
             }
         }
 
-        void PopulateQuadrant01IndirectLDInstructions()
+        constexpr void PopulateQuadrant01IndirectLDInstructions(InstructionArray& instructions)
         {
             auto MakeIndLDInstruction = [](RegisterOperand operand) -> Instruction
             {
@@ -593,16 +602,16 @@ namespace emu::SM83
                     });
             };
 
-            INSTRUCTIONS[0x46] = MakeIndLDInstruction(RegisterOperand::RegB);
-            INSTRUCTIONS[0x4E] = MakeIndLDInstruction(RegisterOperand::RegC);
-            INSTRUCTIONS[0x56] = MakeIndLDInstruction(RegisterOperand::RegD);
-            INSTRUCTIONS[0x5E] = MakeIndLDInstruction(RegisterOperand::RegE);
-            INSTRUCTIONS[0x66] = MakeIndLDInstruction(RegisterOperand::RegH);
-            INSTRUCTIONS[0x6E] = MakeIndLDInstruction(RegisterOperand::RegL);
-            INSTRUCTIONS[0x7E] = MakeIndLDInstruction(RegisterOperand::RegA);
+            instructions[0x46] = MakeIndLDInstruction(RegisterOperand::RegB);
+            instructions[0x4E] = MakeIndLDInstruction(RegisterOperand::RegC);
+            instructions[0x56] = MakeIndLDInstruction(RegisterOperand::RegD);
+            instructions[0x5E] = MakeIndLDInstruction(RegisterOperand::RegE);
+            instructions[0x66] = MakeIndLDInstruction(RegisterOperand::RegH);
+            instructions[0x6E] = MakeIndLDInstruction(RegisterOperand::RegL);
+            instructions[0x7E] = MakeIndLDInstruction(RegisterOperand::RegA);
         }
 
-        void PopulateQuadrant01IndirectStoreLDInstructions()
+        constexpr void PopulateQuadrant01IndirectStoreLDInstructions(InstructionArray& instructions)
         {
             auto MakeIndStoreLDInstruction = [](RegisterOperand operand) -> Instruction
             {
@@ -612,24 +621,24 @@ namespace emu::SM83
                     });
             };
 
-            INSTRUCTIONS[0x70] = MakeIndStoreLDInstruction(RegisterOperand::RegB);
-            INSTRUCTIONS[0x71] = MakeIndStoreLDInstruction(RegisterOperand::RegC);
-            INSTRUCTIONS[0x72] = MakeIndStoreLDInstruction(RegisterOperand::RegD);
-            INSTRUCTIONS[0x73] = MakeIndStoreLDInstruction(RegisterOperand::RegE);
-            INSTRUCTIONS[0x74] = MakeIndStoreLDInstruction(RegisterOperand::RegH);
-            INSTRUCTIONS[0x75] = MakeIndStoreLDInstruction(RegisterOperand::RegL);
-            INSTRUCTIONS[0x77] = MakeIndStoreLDInstruction(RegisterOperand::RegA);
+            instructions[0x70] = MakeIndStoreLDInstruction(RegisterOperand::RegB);
+            instructions[0x71] = MakeIndStoreLDInstruction(RegisterOperand::RegC);
+            instructions[0x72] = MakeIndStoreLDInstruction(RegisterOperand::RegD);
+            instructions[0x73] = MakeIndStoreLDInstruction(RegisterOperand::RegE);
+            instructions[0x74] = MakeIndStoreLDInstruction(RegisterOperand::RegH);
+            instructions[0x75] = MakeIndStoreLDInstruction(RegisterOperand::RegL);
+            instructions[0x77] = MakeIndStoreLDInstruction(RegisterOperand::RegA);
         }
 
-        void PopulateQuadrant01MiscInstructions()
+        constexpr void PopulateQuadrant01MiscInstructions(InstructionArray& instructions)
         {
             // HALT
-            INSTRUCTIONS[0x76] = MakeInstruction({
+            instructions[0x76] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Nop, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::RegIR), MakeMisc(MCycle::Misc::MF_HaltExecution))
             });
         }
 
-        void PopulateQuadrant10BasicALUInstructions()
+        constexpr void PopulateQuadrant10BasicALUInstructions(InstructionArray& instructions)
         {
             // Basic ALU instructions |10|yyy|zzz|
             // yyy: ALU operation (except INC/DEC), zzz: Operand B
@@ -641,14 +650,14 @@ namespace emu::SM83
                     if (z == 6) continue;           // Handle (HL) operand separately
 
                     uint8_t op = 0x80 | ((y & 0x07) << 3) | (z & 0x07);
-                    INSTRUCTIONS[op] = MakeInstruction({
+                    instructions[op] = MakeInstruction({
                             MakeCycle(MakeALU(ALUOp(y), RegisterOperand::RegA, OpCodeRegisterIndexToRegisterOperand(z)), NoIDU(), NoMem())
                         });
                 }
             }
         }
 
-        void PopulateQuadrant10IndirectALUInstructions()
+        constexpr void PopulateQuadrant10IndirectALUInstructions(InstructionArray& instructions)
         {
             auto MakeIndALUInstruction = [](ALUOp op) -> Instruction
             {
@@ -658,17 +667,17 @@ namespace emu::SM83
                     });
             };
 
-            INSTRUCTIONS[0x86] = MakeIndALUInstruction(ALUOp::Add);
-            INSTRUCTIONS[0x8E] = MakeIndALUInstruction(ALUOp::Adc);
-            INSTRUCTIONS[0x96] = MakeIndALUInstruction(ALUOp::Sub);
-            INSTRUCTIONS[0x9E] = MakeIndALUInstruction(ALUOp::Sbc);
-            INSTRUCTIONS[0xA6] = MakeIndALUInstruction(ALUOp::And);
-            INSTRUCTIONS[0xAE] = MakeIndALUInstruction(ALUOp::Xor);
-            INSTRUCTIONS[0xB6] = MakeIndALUInstruction(ALUOp::Or);
-            INSTRUCTIONS[0xBE] = MakeIndALUInstruction(ALUOp::Cp);
+            instructions[0x86] = MakeIndALUInstruction(ALUOp::Add);
+            instructions[0x8E] = MakeIndALUInstruction(ALUOp::Adc);
+            instructions[0x96] = MakeIndALUInstruction(ALUOp::Sub);
+            instructions[0x9E] = MakeIndALUInstruction(ALUOp::Sbc);
+            instructions[0xA6] = MakeIndALUInstruction(ALUOp::And);
+            instructions[0xAE] = MakeIndALUInstruction(ALUOp::Xor);
+            instructions[0xB6] = MakeIndALUInstruction(ALUOp::Or);
+            instructions[0xBE] = MakeIndALUInstruction(ALUOp::Cp);
         }
 
-        void PopulateQuadrant11ImmALUInstructions()
+        constexpr void PopulateQuadrant11ImmALUInstructions(InstructionArray& instructions)
         {
             auto MakeImmALUInstruction = [](ALUOp op) -> Instruction
             {
@@ -678,17 +687,17 @@ namespace emu::SM83
                     });
             };
 
-            INSTRUCTIONS[0xC6] = MakeImmALUInstruction(ALUOp::Add);
-            INSTRUCTIONS[0xCE] = MakeImmALUInstruction(ALUOp::Adc);
-            INSTRUCTIONS[0xD6] = MakeImmALUInstruction(ALUOp::Sub);
-            INSTRUCTIONS[0xDE] = MakeImmALUInstruction(ALUOp::Sbc);
-            INSTRUCTIONS[0xE6] = MakeImmALUInstruction(ALUOp::And);
-            INSTRUCTIONS[0xEE] = MakeImmALUInstruction(ALUOp::Xor);
-            INSTRUCTIONS[0xF6] = MakeImmALUInstruction(ALUOp::Or);
-            INSTRUCTIONS[0xFE] = MakeImmALUInstruction(ALUOp::Cp);
+            instructions[0xC6] = MakeImmALUInstruction(ALUOp::Add);
+            instructions[0xCE] = MakeImmALUInstruction(ALUOp::Adc);
+            instructions[0xD6] = MakeImmALUInstruction(ALUOp::Sub);
+            instructions[0xDE] = MakeImmALUInstruction(ALUOp::Sbc);
+            instructions[0xE6] = MakeImmALUInstruction(ALUOp::And);
+            instructions[0xEE] = MakeImmALUInstruction(ALUOp::Xor);
+            instructions[0xF6] = MakeImmALUInstruction(ALUOp::Or);
+            instructions[0xFE] = MakeImmALUInstruction(ALUOp::Cp);
         }
 
-        void PopulateQuadrant11PushPopInstructions()
+        constexpr void PopulateQuadrant11PushPopInstructions(InstructionArray& instructions)
         {
             auto MakePushInstruction = [](RegisterOperand operand) -> Instruction
             {
@@ -709,47 +718,47 @@ namespace emu::SM83
                 });
             };
 
-            INSTRUCTIONS[0xC1] = MakePopInstruction(RegisterOperand::RegBC);
-            INSTRUCTIONS[0xD1] = MakePopInstruction(RegisterOperand::RegDE);
-            INSTRUCTIONS[0xE1] = MakePopInstruction(RegisterOperand::RegHL);
-            INSTRUCTIONS[0xF1] = MakePopInstruction(RegisterOperand::RegAF);
+            instructions[0xC1] = MakePopInstruction(RegisterOperand::RegBC);
+            instructions[0xD1] = MakePopInstruction(RegisterOperand::RegDE);
+            instructions[0xE1] = MakePopInstruction(RegisterOperand::RegHL);
+            instructions[0xF1] = MakePopInstruction(RegisterOperand::RegAF);
 
-            INSTRUCTIONS[0xC5] = MakePushInstruction(RegisterOperand::RegBC);
-            INSTRUCTIONS[0xD5] = MakePushInstruction(RegisterOperand::RegDE);
-            INSTRUCTIONS[0xE5] = MakePushInstruction(RegisterOperand::RegHL);
-            INSTRUCTIONS[0xF5] = MakePushInstruction(RegisterOperand::RegAF);
+            instructions[0xC5] = MakePushInstruction(RegisterOperand::RegBC);
+            instructions[0xD5] = MakePushInstruction(RegisterOperand::RegDE);
+            instructions[0xE5] = MakePushInstruction(RegisterOperand::RegHL);
+            instructions[0xF5] = MakePushInstruction(RegisterOperand::RegAF);
         }
 
-        void PopulateQuadrant11MiscInstructions()
+        constexpr void PopulateQuadrant11MiscInstructions(InstructionArray& instructions)
         {
             // LD (C), A
-            INSTRUCTIONS[0xE2] = MakeInstruction({
+            instructions[0xE2] = MakeInstruction({
                 MakeCycle(NoALU(), NoIDU(), MakeMemWriteWithOffset(RegisterOperand::RegA, RegisterOperand::RegC)),
                 MakeCycle(NoALU(), NoIDU(), NoMem())
             });
 
             // LD A, (C)
-            INSTRUCTIONS[0xF2] = MakeInstruction({
+            instructions[0xF2] = MakeInstruction({
                 MakeCycle(NoALU(), NoIDU(), MakeMemReadWithOffset(RegisterOperand::RegC, RegisterOperand::RegA)),
                 MakeCycle(NoALU(), NoIDU(), NoMem())
             });
 
             // LDH (a8), A
-            INSTRUCTIONS[0xE0] = MakeInstruction({
+            instructions[0xE0] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), NoIDU(), MakeMemWriteWithOffset(RegisterOperand::RegA, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), NoIDU(), NoMem())
             });
 
             // LD A, (a8)
-            INSTRUCTIONS[0xF0] = MakeInstruction({
+            instructions[0xF0] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), NoIDU(), MakeMemReadWithOffset(RegisterOperand::TempRegZ, RegisterOperand::RegA)),
                 MakeCycle(NoALU(), NoIDU(), NoMem())
             });
 
             // ADD SP, e
-            INSTRUCTIONS[0xE8] = MakeInstruction({
+            instructions[0xE8] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(MakeALU(ALUOp::Add, RegisterOperand::TempRegZ, RegisterOperand::RegSPL), NoIDU(), NoMem()),
                 MakeCycle(MakeALU(ALUOp::Adjust, RegisterOperand::TempRegW, RegisterOperand::RegSPH), NoIDU(), NoMem()),
@@ -757,25 +766,25 @@ namespace emu::SM83
             });
 
             // JP HL (note the custom opcode fetch!)
-            INSTRUCTIONS[0xE9] = MakeInstruction({
+            instructions[0xE9] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDUExt(IDUOp::Inc, RegisterOperand::RegHL, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegHL, RegisterOperand::RegIR))
             });
 
             // LD HL, SP+e
-            INSTRUCTIONS[0xF8] = MakeInstruction({
+            instructions[0xF8] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(MakeALUExt(ALUOp::Add, RegisterOperand::TempRegZ, RegisterOperand::RegSPL, RegisterOperand::RegL), NoIDU(), NoMem()),
                 MakeCycle(MakeALU(ALUOp::Adjust, RegisterOperand::RegH, RegisterOperand::RegSPH), NoIDU(), NoMem()),
             });
 
             // LD SP, HL
-            INSTRUCTIONS[0xF9] = MakeInstruction({
+            instructions[0xF9] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDUExt(IDUOp::Nop, RegisterOperand::RegHL, RegisterOperand::RegSP), NoMem()),
                 MakeCycle(NoALU(), NoIDU(), NoMem())
             });
 
             // LD (a16), A
-            INSTRUCTIONS[0xEA] = MakeInstruction({
+            instructions[0xEA] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW)),
                 MakeCycle(NoALU(), NoIDU(), MakeMemWrite(RegisterOperand::RegA, RegisterOperand::RegWZ)),
@@ -783,7 +792,7 @@ namespace emu::SM83
             });
 
             // LD (a16), A
-            INSTRUCTIONS[0xFA] = MakeInstruction({
+            instructions[0xFA] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW)),
                 MakeCycle(NoALU(), NoIDU(), MakeMemRead(RegisterOperand::RegWZ, RegisterOperand::TempRegZ)),
@@ -791,7 +800,7 @@ namespace emu::SM83
             });
 
             // JP a16
-            INSTRUCTIONS[0xC3] = MakeInstruction({
+            instructions[0xC3] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW)),
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMisc(MCycle::Misc::MF_WriteWZToWideRegister, RegisterOperand::RegPC)),
@@ -808,19 +817,19 @@ namespace emu::SM83
                 });
             };
 
-            INSTRUCTIONS[0xC7] = MakeRSTInstructions(0x00);
-            INSTRUCTIONS[0xD7] = MakeRSTInstructions(0x10);
-            INSTRUCTIONS[0xE7] = MakeRSTInstructions(0x20);
-            INSTRUCTIONS[0xF7] = MakeRSTInstructions(0x30);
+            instructions[0xC7] = MakeRSTInstructions(0x00);
+            instructions[0xD7] = MakeRSTInstructions(0x10);
+            instructions[0xE7] = MakeRSTInstructions(0x20);
+            instructions[0xF7] = MakeRSTInstructions(0x30);
 
-            INSTRUCTIONS[0xCF] = MakeRSTInstructions(0x08);
-            INSTRUCTIONS[0xDF] = MakeRSTInstructions(0x18);
-            INSTRUCTIONS[0xEF] = MakeRSTInstructions(0x28);
-            INSTRUCTIONS[0xFF] = MakeRSTInstructions(0x38);
+            instructions[0xCF] = MakeRSTInstructions(0x08);
+            instructions[0xDF] = MakeRSTInstructions(0x18);
+            instructions[0xEF] = MakeRSTInstructions(0x28);
+            instructions[0xFF] = MakeRSTInstructions(0x38);
 
 
             // RET
-            INSTRUCTIONS[0xC9] = MakeInstruction({
+            instructions[0xC9] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegSP), MakeMemRead(RegisterOperand::RegSP, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegSP), MakeMemRead(RegisterOperand::RegSP, RegisterOperand::TempRegW)),
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMisc(MCycle::Misc::MF_WriteWZToWideRegister, RegisterOperand::RegPC)),
@@ -828,7 +837,7 @@ namespace emu::SM83
             });
 
             // RETI
-            INSTRUCTIONS[0xD9] = MakeInstruction({
+            instructions[0xD9] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegSP), MakeMemRead(RegisterOperand::RegSP, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegSP), MakeMemRead(RegisterOperand::RegSP, RegisterOperand::TempRegW)),
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMisc(MCycle::Misc::MF_WriteWZToWideRegister | MCycle::Misc::MF_EnableInterrupts, RegisterOperand::RegPC)),
@@ -836,17 +845,17 @@ namespace emu::SM83
             });
 
             // DI
-            INSTRUCTIONS[0xF3] = MakeInstruction({
+            instructions[0xF3] = MakeInstruction({
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMisc(MCycle::Misc::MF_DisableInterrupts))
             });
 
             // EI
-            INSTRUCTIONS[0xFB] = MakeInstruction({
+            instructions[0xFB] = MakeInstruction({
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMisc(MCycle::Misc::MF_EnableInterrupts))
             });
 
             // CALL a16
-            INSTRUCTIONS[0xCD] = MakeInstruction({
+            instructions[0xCD] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Dec, RegisterOperand::RegSP), NoMem()),
@@ -856,7 +865,7 @@ namespace emu::SM83
             });
 
             // JP NZ, a16
-            INSTRUCTIONS[0xC2] = MakeInstruction({
+            instructions[0xC2] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW), MakeMiscCheckNZ(3)),
 
@@ -869,7 +878,7 @@ namespace emu::SM83
             });
 
             // JP Z, a16
-            INSTRUCTIONS[0xCA] = MakeInstruction({
+            instructions[0xCA] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW), MakeMiscCheckZ(3)),
 
@@ -882,7 +891,7 @@ namespace emu::SM83
             });
 
             // JP NC, a16
-            INSTRUCTIONS[0xD2] = MakeInstruction({
+            instructions[0xD2] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW), MakeMiscCheckNC(3)),
 
@@ -895,7 +904,7 @@ namespace emu::SM83
             });
 
             // JP Z, a16
-            INSTRUCTIONS[0xDA] = MakeInstruction({
+            instructions[0xDA] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW), MakeMiscCheckC(3)),
 
@@ -908,7 +917,7 @@ namespace emu::SM83
             });
 
             // RET NZ
-            INSTRUCTIONS[0xC0] = MakeInstruction({
+            instructions[0xC0] = MakeInstruction({
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMiscCheckNZ(2)),
                 
                 // NZ false
@@ -922,7 +931,7 @@ namespace emu::SM83
             });
 
             // RET Z
-            INSTRUCTIONS[0xC8] = MakeInstruction({
+            instructions[0xC8] = MakeInstruction({
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMiscCheckZ(2)),
                 
                 // Z false
@@ -936,7 +945,7 @@ namespace emu::SM83
             });
 
             // RET NC
-            INSTRUCTIONS[0xD0] = MakeInstruction({
+            instructions[0xD0] = MakeInstruction({
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMiscCheckNC(2)),
                 
                 // NC false
@@ -950,7 +959,7 @@ namespace emu::SM83
             });
 
             // RET C
-            INSTRUCTIONS[0xD8] = MakeInstruction({
+            instructions[0xD8] = MakeInstruction({
                 MakeCycle(NoALU(), NoIDU(), NoMem(), MakeMiscCheckC(2)),
                 
                 // C false
@@ -964,7 +973,7 @@ namespace emu::SM83
             });
 
             // CALL NZ, a16
-            INSTRUCTIONS[0xC4] = MakeInstruction({
+            instructions[0xC4] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW), MakeMiscCheckNZ(3)),
 
@@ -979,7 +988,7 @@ namespace emu::SM83
             });
 
             // CALL Z, a16
-            INSTRUCTIONS[0xCC] = MakeInstruction({
+            instructions[0xCC] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW), MakeMiscCheckZ(3)),
 
@@ -994,7 +1003,7 @@ namespace emu::SM83
             });
 
             // CALL NC, a16
-            INSTRUCTIONS[0xD4] = MakeInstruction({
+            instructions[0xD4] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW), MakeMiscCheckNC(3)),
 
@@ -1009,7 +1018,7 @@ namespace emu::SM83
             });
 
             // CALL C, a16
-            INSTRUCTIONS[0xDC] = MakeInstruction({
+            instructions[0xDC] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegZ)),
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::TempRegW), MakeMiscCheckC(3)),
 
@@ -1025,13 +1034,13 @@ namespace emu::SM83
 
             // PREFIX CB
             // Implement as a fetch cycle + a dummy cycle which will be overwritten by the next MCycle from the prefix table
-            INSTRUCTIONS[0xCB] = MakeInstruction({
+            instructions[0xCB] = MakeInstruction({
                 MakeCycle(NoALU(), MakeIDU(IDUOp::Inc, RegisterOperand::RegPC), MakeMemRead(RegisterOperand::RegPC, RegisterOperand::RegIR), MakeMisc(MCycle::Misc::MF_PrefixCB)),
                 MakeCycle(NoALU(), NoIDU(), NoMem())
             });
         }
 
-        void PopulatePrefixCBInstructions()
+        constexpr void PopulatePrefixCBInstructions(InstructionArray& instructions)
         {
             auto MakePrefixCBALUInstruction = [](ALUOp op, RegisterOperand operand) -> Instruction
             {
@@ -1076,28 +1085,28 @@ namespace emu::SM83
                 }
 
                 // RLC r8
-                PREFIX_INSTRUCTIONS[0x00 + i] = makeInstructionFn(ALUOp::Rlc, operand);
+                instructions[0x00 + i] = makeInstructionFn(ALUOp::Rlc, operand);
 
                 // RRC r8
-                PREFIX_INSTRUCTIONS[0x08 + i] = makeInstructionFn(ALUOp::Rrc, operand);
+                instructions[0x08 + i] = makeInstructionFn(ALUOp::Rrc, operand);
 
                 // RL r8
-                PREFIX_INSTRUCTIONS[0x10 + i] = makeInstructionFn(ALUOp::Rl, operand);
+                instructions[0x10 + i] = makeInstructionFn(ALUOp::Rl, operand);
 
                 // RR r8
-                PREFIX_INSTRUCTIONS[0x18 + i] = makeInstructionFn(ALUOp::Rr, operand);
+                instructions[0x18 + i] = makeInstructionFn(ALUOp::Rr, operand);
 
                 // SLA r8
-                PREFIX_INSTRUCTIONS[0x20 + i] = makeInstructionFn(ALUOp::Sla, operand);
+                instructions[0x20 + i] = makeInstructionFn(ALUOp::Sla, operand);
 
                 // SRA r8
-                PREFIX_INSTRUCTIONS[0x28 + i] = makeInstructionFn(ALUOp::Sra, operand);
+                instructions[0x28 + i] = makeInstructionFn(ALUOp::Sra, operand);
 
                 // SWAP r8
-                PREFIX_INSTRUCTIONS[0x30 + i] = makeInstructionFn(ALUOp::Swap, operand);
+                instructions[0x30 + i] = makeInstructionFn(ALUOp::Swap, operand);
 
                 // SRL r8
-                PREFIX_INSTRUCTIONS[0x38 + i] = makeInstructionFn(ALUOp::Srl, operand);
+                instructions[0x38 + i] = makeInstructionFn(ALUOp::Srl, operand);
 
                 
                 for (uint8_t bit = 0; bit < 8; ++bit)
@@ -1105,18 +1114,18 @@ namespace emu::SM83
                     uint8_t irOffset = bit * 8 + i;
 
                     // BIT u3, r8
-                    PREFIX_INSTRUCTIONS[0x40 + irOffset] = makeBitInstructionFn(ALUOp(int(ALUOp::Bit0) + bit), operand);
+                    instructions[0x40 + irOffset] = makeBitInstructionFn(ALUOp(int(ALUOp::Bit0) + bit), operand);
 
                     // RES u3, r8
-                    PREFIX_INSTRUCTIONS[0x80 + irOffset] = makeInstructionFn(ALUOp(int(ALUOp::Res0) + bit), operand);
+                    instructions[0x80 + irOffset] = makeInstructionFn(ALUOp(int(ALUOp::Res0) + bit), operand);
 
                     // SET u3, r8
-                    PREFIX_INSTRUCTIONS[0xC0 + irOffset] = makeInstructionFn(ALUOp(int(ALUOp::Set0) + bit), operand);
+                    instructions[0xC0 + irOffset] = makeInstructionFn(ALUOp(int(ALUOp::Set0) + bit), operand);
                 }
             }
         }
 
-        void PopulateInterruptInstructions()
+        constexpr void PopulateInterruptInstructions(InterruptInstructionArray& instructions)
         {
             auto MakeInterruptInstruction = [](uint8_t interrupt)
             {
@@ -1130,74 +1139,249 @@ namespace emu::SM83
                 });
             };
 
-            INTERRUPT_INSTRUCTIONS[INT_VBLANK] = MakeInterruptInstruction(INT_VBLANK);
-            INTERRUPT_INSTRUCTIONS[INT_STAT] = MakeInterruptInstruction(INT_STAT);
-            INTERRUPT_INSTRUCTIONS[INT_TIMER] = MakeInterruptInstruction(INT_TIMER);
-            INTERRUPT_INSTRUCTIONS[INT_SERIAL] = MakeInterruptInstruction(INT_SERIAL);
-            INTERRUPT_INSTRUCTIONS[INT_JOYPAD] = MakeInterruptInstruction(INT_JOYPAD);
+            instructions[GetInterruptIndex(INT_VBLANK)] = MakeInterruptInstruction(INT_VBLANK);
+            instructions[GetInterruptIndex(INT_STAT)] = MakeInterruptInstruction(INT_STAT);
+            instructions[GetInterruptIndex(INT_TIMER)] = MakeInterruptInstruction(INT_TIMER);
+            instructions[GetInterruptIndex(INT_SERIAL)] = MakeInterruptInstruction(INT_SERIAL);
+            instructions[GetInterruptIndex(INT_JOYPAD)] = MakeInterruptInstruction(INT_JOYPAD);
         }
 
-        void PopulateInstructions()
+        constexpr InstructionArray MakeDefaultInstructions()
         {
-            // Interrupt handling
-            PopulateInterruptInstructions();
+            InstructionArray instructions = {};
 
             // NOP
-            INSTRUCTIONS[0x00] = MakeInstruction({
+            instructions[0x00] = MakeInstruction({
                     MakeCycle(NoALU(), NoIDU(), NoMem())
                 });
 
-            PopulateQuadrant00BasicIncDecInstructions();
-            PopulateQuadrant00ImmediateLDInstructions();
-            PopulateQuadrant0016BitIncDecInstructions();
-            PopulateQuadrant0016BitImmediateLDInstructions();
-            PopulateQuadrant0016BitALUInstructions();
-            PopulateQuadrant00IndirectStoreLDInstructions();
-            PopulateQuadrant00IndirectLDInstructions();
-            PopulateQuadrant00IndirectIncDecInstructions();
-            PopulateQuadrant00BitwiseInstructions();
-            PopulateQuadrant00MiscInstructions();
-
-            PopulateQuadrant01BasicLDInstructions();
-            PopulateQuadrant01IndirectLDInstructions();
-            PopulateQuadrant01IndirectStoreLDInstructions();
-            PopulateQuadrant01MiscInstructions();
-
-            PopulateQuadrant10BasicALUInstructions();
-            PopulateQuadrant10IndirectALUInstructions();
-
-            PopulateQuadrant11ImmALUInstructions();
-            PopulateQuadrant11PushPopInstructions();
-            PopulateQuadrant11MiscInstructions();
-
-            PopulatePrefixCBInstructions();
+            PopulateQuadrant00BasicIncDecInstructions(instructions);
+            PopulateQuadrant00ImmediateLDInstructions(instructions);
+            PopulateQuadrant0016BitIncDecInstructions(instructions);
+            PopulateQuadrant0016BitImmediateLDInstructions(instructions);
+            PopulateQuadrant0016BitALUInstructions(instructions);
+            PopulateQuadrant00IndirectStoreLDInstructions(instructions);
+            PopulateQuadrant00IndirectLDInstructions(instructions);
+            PopulateQuadrant00IndirectIncDecInstructions(instructions);
+            PopulateQuadrant00BitwiseInstructions(instructions);
+            PopulateQuadrant00MiscInstructions(instructions);
+
+            PopulateQuadrant01BasicLDInstructions(instructions);
+            PopulateQuadrant01IndirectLDInstructions(instructions);
+            PopulateQuadrant01IndirectStoreLDInstructions(instructions);
+            PopulateQuadrant01MiscInstructions(instructions);
+
+            PopulateQuadrant10BasicALUInstructions(instructions);
+            PopulateQuadrant10IndirectALUInstructions(instructions);
+
+            PopulateQuadrant11ImmALUInstructions(instructions);
+            PopulateQuadrant11PushPopInstructions(instructions);
+            PopulateQuadrant11MiscInstructions(instructions);
+
+            return instructions;
+        }
+
+        constexpr InstructionArray MakePrefixCBInstructions()
+        {
+            InstructionArray instructions = {};
+            PopulatePrefixCBInstructions(instructions);
+            return instructions;
         }
 
-        struct OpCodeStaticInit
+        constexpr InterruptInstructionArray MakeInterruptInstructions()
+        {
+            InterruptInstructionArray instructions = {};
+            PopulateInterruptInstructions(instructions);
+            return instructions;
+        }
+
+        // Only used at compile time to build the packed tables below
+        constexpr const InstructionArray INSTRUCTIONS = MakeDefaultInstructions();
+        constexpr const InstructionArray PREFIX_INSTRUCTIONS = MakePrefixCBInstructions();
+        constexpr const InterruptInstructionArray INTERRUPT_INSTRUCTIONS = MakeInterruptInstructions();
+
+        constexpr MicroOp PredecodeMCycle(const MCycle& cycle, bool isLastCycle)
         {
-            OpCodeStaticInit()
+            MCycle merged = cycle;
+            if (isLastCycle)
+            {
+                // Allow fetch cycle IDU op to be overwritten by instruction IDU op
+                if (merged._idu._op == IDUOp::Nop &&
+                    merged._idu._operand == RegisterOperand::None &&
+                    merged._idu._dest == RegisterOperand::None)
+                {
+                    merged._idu = FETCH_MCYCLE._idu;
+                }
+
+                // Same for memory op
+                if ((merged._memOp._flags & MCycle::MemOp::MOF_Active) == 0)
+                {
+                    merged._memOp = FETCH_MCYCLE._memOp;
+                }
+            }
+
+            MicroOp op =
+            {
+                ._flags = MicroOp::UOF_None,
+                ._miscFlags = merged._misc._flags,
+                ._miscValue = merged._misc._optValue,
+                ._aluOp = merged._alu._op,
+                ._aluOperandA = merged._alu._operandA,
+                ._aluOperandB = merged._alu._operandB,
+                ._aluDest = merged._alu._dest,
+                ._iduOp = merged._idu._op,
+                ._iduOperand = merged._idu._operand,
+                ._iduDest = merged._idu._dest,
+                ._memReg = merged._memOp._reg,
+                ._memAddressSrc = (merged._memOp._flags & MCycle::MemOp::MOF_UseOffsetAddress) ? merged._memOp._addressSrcBeforeOffset : merged._memOp._addressSrc,
+                ._miscOperand = merged._misc._operand
+            };
+
+            uint16_t flags = isLastCycle ? MicroOp::UOF_LastCycle : MicroOp::UOF_None;
+            if (merged._memOp._flags & MCycle::MemOp::MOF_Active)
+            {
+                flags |= (merged._memOp._flags & MCycle::MemOp::MOF_IsMemWrite) ? MicroOp::UOF_MemWrite : MicroOp::UOF_MemRead;
+                flags |= (merged._memOp._flags & MCycle::MemOp::MOF_UseOffsetAddress) ? MicroOp::UOF_UseOffsetAddress : MicroOp::UOF_None;
+
+                if (!(merged._memOp._flags & MCycle::MemOp::MOF_IsMemWrite) && merged._memOp._reg == RegisterOperand::TempRegZ)
+                {
+                    flags |= MicroOp::UOF_TrackSignBit;
+                }
+            }
+
+            if (merged._alu._operandA != RegisterOperand::None && 
+                merged._alu._operandB != RegisterOperand::None &&
+                merged._alu._dest != RegisterOperand::None)
+            {
+                flags |= MicroOp::UOF_ALU;
+            }
+
+            if (merged._idu._operand != RegisterOperand::None &&
+                merged._idu._dest != RegisterOperand::None)
             {
-                PopulateInstructions();
+                flags |= MicroOp::UOF_IDU;
             }
 
-        } OPCODE_STATIC_INIT;
+            const uint16_t miscFlags =
+                MCycle::Misc::MF_WriteWZToWideRegister | MCycle::Misc::MF_WriteValueToWideRegister |
+                MCycle::Misc::MF_EnableInterrupts | MCycle::Misc::MF_DisableInterrupts |
+                MCycle::Misc::MF_ConditionCheckZ | MCycle::Misc::MF_ConditionCheckNZ |
+                MCycle::Misc::MF_ConditionCheckC | MCycle::Misc::MF_ConditionCheckNC;
 
-        
+            flags |= (merged._misc._flags & miscFlags) ? MicroOp::UOF_Misc : MicroOp::UOF_None;
+            flags |= (merged._misc._flags & MCycle::Misc::MF_PrefixCB) ? MicroOp::UOF_PrefixCB : MicroOp::UOF_None;
+            flags |= (merged._misc._flags & (MCycle::Misc::MF_StopExecution | MCycle::Misc::MF_HaltExecution)) ? MicroOp::UOF_StopOrHalt : MicroOp::UOF_None;
+
+            op._flags = flags;
+            return op;
+        }
+
+        // Packed layout used at runtime: the cycles of every instruction sit back to back in one pool, and
+        // each table entry only says where its instruction starts, so the decoder touches a few KB instead of
+        // fixed size slots that are mostly empty
+        constexpr const uint32_t PREFIX_ENTRY_OFFSET = 0x100;
+        constexpr const uint32_t INTERRUPT_ENTRY_OFFSET = 0x200;
+        constexpr const uint32_t INSTRUCTION_ENTRY_COUNT = INTERRUPT_ENTRY_OFFSET + INTERRUPT_COUNT;
+
+        struct InstructionEntry
+        {
+            uint16_t _firstCycle;
+            uint16_t _cycleCount;
+        };
+
+        constexpr uint32_t GetInstructionEntryIndex(InstructionTable table, uint8_t opCode)
+        {
+            switch (table)
+            {
+            case InstructionTable::PrefixCB:
+                return PREFIX_ENTRY_OFFSET + opCode;
+            case InstructionTable::Interrupt:
+                return INTERRUPT_ENTRY_OFFSET + GetInterruptIndex(opCode);
+            default:
+                return opCode;
+            }
+        }
+
+        constexpr const Instruction& GetSourceInstruction(uint32_t entryIdx)
+        {
+            if (entryIdx >= INTERRUPT_ENTRY_OFFSET)
+            {
+                return INTERRUPT_INSTRUCTIONS[entryIdx - INTERRUPT_ENTRY_OFFSET];
+            }
+
+            return entryIdx >= PREFIX_ENTRY_OFFSET ? PREFIX_INSTRUCTIONS[entryIdx - PREFIX_ENTRY_OFFSET] : INSTRUCTIONS[entryIdx];
+        }
+
+        constexpr uint32_t CountCycles()
+        {
+            uint32_t count = 0;
+            for (uint32_t entryIdx = 0; entryIdx < INSTRUCTION_ENTRY_COUNT; ++entryIdx)
+            {
+                count += GetSourceInstruction(entryIdx)._cycleCount;
+            }
+
+            return count;
+        }
+
+        constexpr const uint32_t CYCLE_POOL_SIZE = CountCycles();
+        static_assert(CYCLE_POOL_SIZE <= UINT16_MAX);
+
+        struct PackedInstructionTables
+        {
+            std::array<InstructionEntry, INSTRUCTION_ENTRY_COUNT> _entries;
+            std::array<MicroOp, CYCLE_POOL_SIZE> _ops;      // Hot, read by the decoder every MCycle
+            std::array<MCycle, CYCLE_POOL_SIZE> _cycles;    // Cold, only there for GetMCycle
+        };
+
+        constexpr PackedInstructionTables PackInstructionTables()
+        {
+            PackedInstructionTables tables = {};
+
+            uint16_t poolSize = 0;
+            for (uint32_t entryIdx = 0; entryIdx < INSTRUCTION_ENTRY_COUNT; ++entryIdx)
+            {
+                const Instruction& instruction = GetSourceInstruction(entryIdx);
+                tables._entries[entryIdx] = { ._firstCycle = poolSize, ._cycleCount = uint16_t(instruction._cycleCount) };
+
+                for (uint32_t i = 0; i < instruction._cycleCount; ++i)
+                {
+                    const MCycle& cycle = instruction._cycles[i];
+                    bool isLastCycle = (cycle._misc._flags & MCycle::Misc::MF_LastCycle) || (i == instruction._cycleCount - 1);
+
+                    tables._cycles[poolSize] = cycle;
+                    tables._ops[poolSize] = PredecodeMCycle(cycle, isLastCycle);
+                    poolSize++;
+                }
+            }
+
+            return tables;
+        }
+
+        // Built entirely at compile time, so the tables end up in read-only data shared by every process
+        constexpr const PackedInstructionTables PACKED_INSTRUCTIONS = PackInstructionTables();
     }
 
     const MCycle& GetFetchMCycle() { return FETCH_MCYCLE; };
 
     uint8_t GetMCycleCount(InstructionTable table, uint8_t opCode)
     {
-        return INSTRUCTION_TABLES[int(table)][opCode]._cycleCount;
+        return uint8_t(PACKED_INSTRUCTIONS._entries[GetInstructionEntryIndex(table, opCode)]._cycleCount);
     }
 
     const MCycle& GetMCycle(InstructionTable table, uint8_t opCode, uint8_t mCycleIndex)
     {
-        const Instruction& i = INSTRUCTION_TABLES[int(table)][opCode];
+        const InstructionEntry& i = PACKED_INSTRUCTIONS._entries[GetInstructionEntryIndex(table, opCode)];
+        EMU_ASSERT("MCycle index out of bounds" && mCycleIndex < i._cycleCount);
+
+        return PACKED_INSTRUCTIONS._cycles[i._firstCycle + mCycleIndex];
+    }
+
+    const MicroOp& GetMicroOp(InstructionTable table, uint8_t opCode, uint8_t mCycleIndex)
+    {
+        const InstructionEntry& i = PACKED_INSTRUCTIONS._entries[GetInstructionEntryIndex(table, opCode)];
         EMU_ASSERT("MCycle index out of bounds" && mCycleIndex < i._cycleCount);
 
-        return i._cycles[mCycleIndex];
+        return PACKED_INSTRUCTIONS._ops[i._firstCycle + mCycleIndex];
     }
 
     const char* GetOpcodeName(InstructionTable table, uint8_t opCode)
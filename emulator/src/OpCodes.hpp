@@ -19,4 +19,5 @@ namespace emu::SM83
 
     uint8_t GetMCycleCount(InstructionTable table, uint8_t opCode);
     const MCycle& GetMCycle(InstructionTable table, uint8_t opCode, uint8_t mCycleIndex);
+    const MicroOp& GetMicroOp(InstructionTable table, uint8_t opCode, uint8_t mCycleIndex);
 }
\ No newline at end of file
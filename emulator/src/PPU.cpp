@@ -1,8 +1,11 @@
 
 #include "PPU.hpp"
 #include "SM83.hpp"
-#include <intrin.h>
+#include "TileDecode.hpp"
 #include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iterator>
 
 namespace emu::SM83
 {
@@ -30,6 +33,10 @@ namespace emu::SM83
         constexpr const uint8_t SPRITE_SIZE = 8;
         constexpr const uint8_t SPRITE_SIZE_TALL = 16;
 
+        constexpr const uint16_t ADDR_STAT = 0xFF41;
+        constexpr const uint16_t ADDR_LY = 0xFF44;
+        constexpr const uint16_t ADDR_LYC = 0xFF45;
+
         constexpr const uint8_t INT_BIT_VBLANK = 1 << 0;
         constexpr const uint8_t INT_BIT_STAT = 1 << 1;
 
@@ -151,6 +158,19 @@ namespace emu::SM83
             return val;
         }
 
+        void UpdateSTAT(const PPU& ppu, PeripheralIO& pIO)
+        {
+            pIO.STAT = (pIO.STAT & 0xFC) | (uint8_t(ppu._currMode) & 0x03);
+            if (pIO.LY == pIO.LYC)
+            {
+                pIO.STAT |= 1 << 2;
+            }
+            else
+            {
+                pIO.STAT &= ~(1 << 2);
+            }
+        }
+
         uint8_t VRAMRead(const uint8_t* vram, uint16_t addr)
         {
             EMU_ASSERT(addr >= VRAM_ADDR && addr < VRAM_ADDR + VRAM_SIZE);
@@ -205,46 +225,46 @@ namespace emu::SM83
         }
 
 
-        void TickObjectFetcher(uint16_t currCycle, uint8_t LY, LCDControl lcdc, ObjectFetcher& objFetch, const uint8_t* oam)
+        // Checks the OAM entries the scan gets to over dots [beginCycle, endCycle), a new one every two dots
+        void ScanOAMEntries(uint16_t beginCycle, uint16_t endCycle, uint8_t LY, LCDControl lcdc, ObjectFetcher& objFetch, const uint8_t* oam)
         {
-            if (currCycle % 2 == 0)
+            uint8_t spriteHeight = (lcdc._bits._spriteSize > 0) ? SPRITE_SIZE_TALL : SPRITE_SIZE;
+            for (uint16_t entryIdx = (beginCycle + 1) / 2; entryIdx * 2 < endCycle; ++entryIdx)
             {
-                // Check a new OAM entry every two cycles
-                uint16_t addr = OAM_ADDR + (currCycle / 2) * sizeof(OAMEntry);
-                OAMEntry oamEntry = 
+                if (objFetch._spriteCount >= MAX_OAM_ENTRIES_PER_SCANLINE)
+                {
+                    break;
+                }
+
+                // Most entries aren't on the line, the rest of one only gets read once its Y matches
+                uint16_t addr = OAM_ADDR + entryIdx * sizeof(OAMEntry);
+                uint8_t posY = OAMRead(oam, addr + 0);
+                if (LY + 16 < posY || LY + 16 >= posY + spriteHeight)
                 {
-                    ._posY = OAMRead(oam, addr + 0),
+                    continue;
+                }
+
+                objFetch._spriteList[objFetch._spriteCount++] =
+                {
+                    ._posY = posY,
                     ._posX = OAMRead(oam, addr + 1),
                     ._tileIdx = OAMRead(oam, addr + 2),
                     ._attribsu8 = OAMRead(oam, addr + 3),
                 };
-
-                uint8_t spriteHeight = (lcdc._bits._spriteSize > 0) ? SPRITE_SIZE_TALL : SPRITE_SIZE;
-
-                if (objFetch._spriteCount < MAX_OAM_ENTRIES_PER_SCANLINE &&
-                    LY + 16 >= oamEntry._posY &&
-                    LY + 16 < oamEntry._posY + spriteHeight)
-                {
-                    objFetch._spriteList[objFetch._spriteCount++] = oamEntry;
-                }
-            }          
+            }
         }
 
-        bool TickPixelFIFOs(uint16_t currCycle, uint8_t SCX, uint8_t BGP, uint8_t OBP0, uint8_t OBP1, PixelFIFO& bgFifo, PixelFIFO& spriteFifo, LCDControl lcdc, void* userData, FnDisplayPixelWrite displayFn)
+        // Returns true if a pixel made it onto the scanline, with its shade in color
+        bool TickPixelFIFOs(uint16_t currCycle, uint8_t SCX, uint8_t BGP, uint8_t OBP0, uint8_t OBP1, PixelFIFO& bgFifo, PixelFIFO& spriteFifo, uint8_t& color)
         {
             EMU_ASSERT(currCycle >= CYCLES_PER_OAM_SCAN && "Pixel fetch stage should not be running during OAM scan");
             if (!PixelFIFOEmpty(bgFifo))
             {
-                uint8_t color = PixelFIFOPop(bgFifo, spriteFifo, BGP, OBP0, OBP1);
+                color = PixelFIFOPop(bgFifo, spriteFifo, BGP, OBP0, OBP1);
 
                 // Handle horizontal scroll by discarding pixels at the start of the scanline
                 if ((currCycle - CYCLES_PER_OAM_SCAN) > (SCX % 8))
                 {
-                    if (displayFn)
-                    {
-                        displayFn(userData, color);
-                    }
-
                     return true;
                 }
             }
@@ -485,9 +505,518 @@ namespace emu::SM83
             
             return fifoPopulated;
         }
+
+        PPULineRegisters ReadLineRegisters(const PeripheralIO& pIO)
+        {
+            PPULineRegisters regs;
+            regs._LCDC = pIO.LCDC;
+            regs._LY = pIO.LY;
+            regs._SCY = pIO.SCY;
+            regs._SCX = pIO.SCX;
+            regs._WY = pIO.WY;
+            regs._WX = pIO.WX;
+            regs._BGP = pIO.BGP;
+            regs._OBP0 = pIO.OBP0;
+            regs._OBP1 = pIO.OBP1;
+            return regs;
+        }
+
+        // One dot of pixel fetch, returns true once the last pixel of the scanline has been pushed out
+        bool TickPixelFetch(PPU& ppu, const PPULineRegisters& regs)
+        {
+            const LCDControl lcdc =
+            {
+                ._u8 = regs._LCDC
+            };
+
+            if (!ppu._pixelFetch._visibleSpriteBits)
+            {
+                uint16_t visibleSpriteBits = FindVisibleSprites(ppu._currPixelXPos, ppu._objFetch);
+                if (visibleSpriteBits)
+                {
+                    ppu._pixelFetch._visibleSpriteBits = visibleSpriteBits;
+
+                    // Potential penalty up to 6 cycles due to resetting of background FIFO when entering sprite rendering mode
+                    ppu._pixelFetch._currStage = PixelFetchStage::FetchTileNumber;
+                }
+            }
+
+            // Switch into window fetching mode if needed
+            if (lcdc._bits._windowDisplayEnable &&
+                regs._LY >= regs._WY &&
+                ppu._currPixelXPos >= regs._WX - 7 &&
+                ppu._pixelFetch._currMode != PixelFetcher::Mode::Window)
+            {
+                ppu._pixelFetch._currMode = PixelFetcher::Mode::Window;
+                ppu._pixelFetch._currStage = PixelFetchStage::FetchTileNumber;
+                ppu._pixelFetch._currTileXPos = 0;
+
+                // Potential 6 cycle penalty when entering Window mode due to FIFO clear
+                PixelFIFOClear(ppu._pixelFetch._bgFifo);
+            }
+       
+            if (!ppu._pixelFetch._visibleSpriteBits || PixelFIFOEmpty(ppu._pixelFetch._bgFifo))
+            {   
+                TickPixelFetcherBackground(
+                    ppu._pixelFetch._currMode == PixelFetcher::Mode::Window,
+                    ppu._currCycle,
+                    regs._LY,
+                    regs._SCX,
+                    regs._SCY,
+                    lcdc,
+                    ppu._pixelFetch,
+                    ppu._vram);
+            }
+        
+            if (ppu._pixelFetch._visibleSpriteBits && !PixelFIFOEmpty(ppu._pixelFetch._bgFifo))
+            {
+                int index = std::countr_zero(ppu._pixelFetch._visibleSpriteBits);
+                TickPixelFetcherSprite(
+                    ppu._currCycle,
+                    ppu._currPixelXPos,
+                    regs._LY,
+                    lcdc,
+                    ppu._pixelFetch,
+                    ppu._objFetch,
+                    uint8_t(index),
+                    ppu._vram);
+            }
+
+            // Push pixels while we're not fetching sprites
+            if (!ppu._pixelFetch._visibleSpriteBits)
+            {
+                uint8_t color = 0;
+                if (TickPixelFIFOs(ppu._currCycle, regs._SCX, regs._BGP, regs._OBP0, regs._OBP1, ppu._pixelFetch._bgFifo, ppu._pixelFetch._spriteFifo, color))
+                {
+                    EMU_ASSERT(ppu._currPixelXPos < SCREEN_WIDTH);
+                    ppu._lineShades[ppu._currPixelXPos++] = color;
+                }
+            }
+
+            return ppu._currPixelXPos >= SCREEN_WIDTH;
+        }
+
+        // First dot the fetcher can push a tile on, starting over from the tile number on the given dot
+        // Each of the 3 fetch steps finishes on an odd dot, pushing takes one more
+        uint16_t GetTilePushCycle(uint16_t restartCycle)
+        {
+            return restartCycle + ((restartCycle % 2) ? 5 : 6);
+        }
+
+        // Dot the last of a number of sprites starting on the same pixel gets pushed on, the first one starting on the given dot
+        // Fetching the tile number takes a dot, both halves of the tile data finish on an odd dot and pushing takes one more
+        uint16_t GetSpritePushCycle(uint16_t startCycle, uint8_t spriteCount)
+        {
+            uint16_t pushCycle = startCycle;
+            for (uint8_t i = 0; i < spriteCount; ++i)
+            {
+                pushCycle = startCycle + ((startCycle % 2) ? 5 : 4);
+                startCycle = pushCycle + 1;
+            }
+
+            return pushCycle;
+        }
+
+        // Pixels go out one per dot for as long as the fetcher keeps up, which it always does unless it had to start over
+        struct PixelFetchTiming
+        {
+            uint8_t _pixel = 0;             // Next pixel to go out, on _cycle unless it has to wait for its tile
+            uint16_t _cycle = CYCLES_PER_OAM_SCAN;
+            uint8_t _tileStart = 0;         // Tiles get pushed on pixels _tileStart + 8n...
+            uint16_t _pushCycle = 0;        // ...the next one no sooner than this
+        };
+
+        uint16_t GetPixelCycle(const PixelFetchTiming& timing, uint8_t pixel)
+        {
+            EMU_ASSERT(pixel >= timing._pixel);
+
+            uint8_t nextTile = uint8_t(timing._pixel + ((timing._tileStart - timing._pixel) & 0x07));
+            if (pixel < nextTile)
+            {
+                return timing._cycle + (pixel - timing._pixel);
+            }
+
+            uint16_t tileCycle = std::max<uint16_t>(timing._cycle + (nextTile - timing._pixel), timing._pushCycle);
+            return tileCycle + (pixel - nextTile);
+        }
+
+        // Dot the scanline enters HBlank on, worked out from where sprites and the window start instead of fetching pixels
+        // Only holds for scanlines starting out with empty FIFOs, same as RenderScanline
+        // Both make the fetcher throw away the tile it's on, sprites also hold pixels back until they're fetched and the window empties the FIFO
+        // SCX makes no difference, the pixels it has discarded would have to go out before the first tile is in
+        uint16_t ComputePixelFetchEnd(const PPU& ppu)
+        {
+            const PPULineRegisters& regs = ppu._lineRegs;
+            const LCDControl lcdc =
+            {
+                ._u8 = regs._LCDC
+            };
+
+            const bool windowOnLine = lcdc._bits._windowDisplayEnable && regs._LY >= regs._WY && regs._WX - 7 < SCREEN_WIDTH;
+            const uint8_t windowStart = windowOnLine ? uint8_t(std::max(regs._WX - 7, 0)) : SCREEN_WIDTH;
+
+            // Pixels sprites start on, sprites hanging off the left edge never get fetched
+            uint8_t spritePixels[MAX_OAM_ENTRIES_PER_SCANLINE];
+            uint8_t spritePixelCount = 0;
+            for (uint8_t i = 0; i < ppu._objFetch._spriteCount; ++i)
+            {
+                uint8_t posX = ppu._objFetch._spriteList[i]._posX;
+                if (posX >= 8 && posX < SCREEN_WIDTH + 8)
+                {
+                    spritePixels[spritePixelCount++] = posX - 8;
+                }
+            }
+            std::sort(spritePixels, spritePixels + spritePixelCount);
+
+            // The first tile of a scanline gets fetched twice
+            PixelFetchTiming timing;
+            timing._pushCycle = GetTilePushCycle(GetTilePushCycle(CYCLES_PER_OAM_SCAN));
+
+            uint8_t spriteIdx = 0;
+            bool windowPending = windowStart < SCREEN_WIDTH;
+            while (spriteIdx < spritePixelCount || windowPending)
+            {
+                uint8_t pixel = std::min(
+                    spriteIdx < spritePixelCount ? spritePixels[spriteIdx] : SCREEN_WIDTH,
+                    windowPending ? windowStart : SCREEN_WIDTH);
+
+                uint8_t spriteCount = 0;
+                while (spriteIdx < spritePixelCount && spritePixels[spriteIdx] == pixel)
+                {
+                    spriteIdx++;
+                    spriteCount++;
+                }
+
+                // The fetcher starts over on the dot the pixel comes up, right away if the FIFO is empty
+                uint16_t eventCycle = (pixel == timing._pixel) ? timing._cycle : GetPixelCycle(timing, pixel - 1) + 1;
+
+                bool fifoEmpty = ((pixel - timing._tileStart) & 0x07) == 0;
+                if (windowPending && pixel == windowStart)
+                {
+                    windowPending = false;
+                    timing._tileStart = pixel;
+                    fifoEmpty = true;
+                }
+
+                uint16_t pushCycle = (eventCycle == CYCLES_PER_OAM_SCAN) ? timing._pushCycle : GetTilePushCycle(eventCycle);
+
+                // Sprites wait for the FIFO to have pixels in it before they get fetched
+                uint16_t pixelCycle = spriteCount ?
+                    GetSpritePushCycle(fifoEmpty ? pushCycle : eventCycle, spriteCount) :
+                    pushCycle;
+
+                // The background tile being fetched starts over after the sprites, the dot after the pixel goes out
+                timing._pixel = pixel + 1;
+                timing._cycle = pixelCycle + 1;
+                timing._pushCycle = GetTilePushCycle(pixelCycle + 1);
+            }
+
+            // Sprites or the window on the last pixel leave nothing else to go out
+            return (timing._pixel < SCREEN_WIDTH) ? GetPixelCycle(timing, SCREEN_WIDTH - 1) + 1 : timing._cycle;
+        }
+
+        // Writes to tile data keep the tile cache up to date, the rest of VRAM is mapped as plain memory
+        void WriteTileData(void* context, MMU&, uint16_t address, uint8_t val)
+        {
+            PPU& ppu = *static_cast<PPU*>(context);
+            VRAMWrite(ppu._vram, address, val);
+
+            if (ppu._tileCache)
+            {
+                InvalidateTileCache(*ppu._tileCache, address, 1);
+            }
+        }
+
+        void MapVRAM(PPU& ppu, MMU& mmu)
+        {
+            if (!ppu._tileCache)
+            {
+                MapMemoryRegion(mmu, VRAM_ADDR, VRAM_SIZE, ppu._vram, 0);
+                return;
+            }
+
+            const MMIOHandler handler =
+            {
+                ._read = nullptr,
+                ._write = WriteTileData,
+                ._context = &ppu
+            };
+
+            MapMemoryRegion(mmu, TILE_DATA_BEGIN, TILE_DATA_END - TILE_DATA_BEGIN, ppu._vram, 0, &handler);
+            MapMemoryRegion(mmu, TILE_DATA_END, VRAM_ADDR + VRAM_SIZE - TILE_DATA_END, ppu._vram + (TILE_DATA_END - VRAM_ADDR), 0);
+        }
+
+        // Same tile FetchBGTileData reads from, counted in tiles from the start of VRAM
+        uint16_t GetBGTileNumber(LCDControl lcdc, uint8_t tileIdx)
+        {
+            return lcdc._bits._tileDataSelect ?
+                tileIdx :                           // $8000 mode
+                uint16_t(256 + int8_t(tileIdx));    // $8800 mode
+        }
+
+        // Row of colour indices, leftmost pixel in the lowest byte
+        uint64_t FetchTileRow(PPU& ppu, uint16_t tileNumber, uint8_t row, bool xFlip)
+        {
+            EMU_ASSERT(tileNumber < TILE_CACHE_TILE_COUNT && row < 8);
+
+            uint64_t indices = 0;
+            TileCache* cache = ppu._tileCache;
+            if (!cache)
+            {
+                DecodeTileRows(ppu._tileDecodeKernel, ppu._vram + tileNumber * 16 + row * 2, 1, xFlip, reinterpret_cast<uint8_t*>(&indices));
+                return indices;
+            }
+
+            uint64_t& dirtyBits = cache->_dirtyTiles[tileNumber / 64];
+            uint64_t tileBit = uint64_t(1) << (tileNumber % 64);
+            if (dirtyBits & tileBit)
+            {
+                // Whole tile at once, the other rows are likely to be needed by the next scanlines
+                const uint8_t* tileData = ppu._vram + tileNumber * 16;
+                DecodeTileRows(ppu._tileDecodeKernel, tileData, 8, false, reinterpret_cast<uint8_t*>(cache->_rows[tileNumber][0]));
+                DecodeTileRows(ppu._tileDecodeKernel, tileData, 8, true, reinterpret_cast<uint8_t*>(cache->_rows[tileNumber][1]));
+                dirtyBits &= ~tileBit;
+            }
+
+            return cache->_rows[tileNumber][xFlip ? 1 : 0][row];
+        }
+
+        // Same pixels as fetching them dot by dot, and leaves the FIFOs the way the last dot would have as well
+        // Only holds for scanlines starting out with empty FIFOs, leftovers get discarded or not depending on timing otherwise
+        void RenderScanline(PPU& ppu)
+        {
+            const PPULineRegisters& regs = ppu._lineRegs;
+            const LCDControl lcdc =
+            {
+                ._u8 = regs._LCDC
+            };
+
+            PixelFetcher& pixelFetch = ppu._pixelFetch;
+            EMU_ASSERT(PixelFIFOEmpty(pixelFetch._bgFifo) && PixelFIFOEmpty(pixelFetch._spriteFifo));
+
+            // The window takes over from the first pixel at or past WX - 7 until the end of the scanline
+            const bool windowOnLine = lcdc._bits._windowDisplayEnable && regs._LY >= regs._WY && regs._WX - 7 < SCREEN_WIDTH;
+            const uint8_t windowStart = windowOnLine ? uint8_t(std::max(regs._WX - 7, 0)) : SCREEN_WIDTH;
+
+            // Skipped frames only need to know what ends up in the FIFOs
+            const bool render = ppu._renderFrame;
+
+            // Colour indices of the background and window, the last window tile can hang off the end
+            uint8_t bgIndices[SCREEN_WIDTH + 8];
+
+            const uint8_t bgTileCount = (windowStart + 7) / 8;
+            const uint16_t bgTileMap = lcdc._bits._bgTileMapSelect ? TILE_MAP_1_BEGIN : TILE_MAP_0_BEGIN;
+            const uint16_t bgMapRow = 32 * (((regs._LY + regs._SCY) & 0xFF) / 8);
+            const uint8_t bgTileRow = (regs._LY + regs._SCY) % 8;
+            for (uint8_t tileXPos = 0; render && tileXPos < bgTileCount; ++tileXPos)
+            {
+                uint16_t mapOffset = ((tileXPos + (regs._SCX / 8)) & 0x1F) + bgMapRow;
+                uint8_t tileIdx = VRAMRead(ppu._vram, bgTileMap + (mapOffset & 0x3FF));
+                uint64_t indices = lcdc._bits._bgWindowEnabled ? FetchTileRow(ppu, GetBGTileNumber(lcdc, tileIdx), bgTileRow, false) : 0;
+                std::memcpy(bgIndices + tileXPos * 8, &indices, sizeof(indices));
+            }
+
+            // The last tile pushed keeps whatever the last pixel didn't use up in the FIFO
+            uint8_t lastTileLow = 0;
+            uint8_t lastTileHigh = 0;
+            uint8_t lastTileConsumed = 8;
+
+            if (windowOnLine)
+            {
+                const uint8_t windowTileCount = (SCREEN_WIDTH - windowStart + 7) / 8;
+                const uint16_t windowTileMap = lcdc._bits._windowTileMapSelect ? TILE_MAP_1_BEGIN : TILE_MAP_0_BEGIN;
+                const uint16_t windowMapRow = 32 * (pixelFetch._windowLineCounter / 8);
+                const uint8_t windowTileRow = pixelFetch._windowLineCounter % 8;
+
+                for (uint8_t tileXPos = 0; render && tileXPos < windowTileCount; ++tileXPos)
+                {
+                    uint8_t tileIdx = VRAMRead(ppu._vram, windowTileMap + ((tileXPos + windowMapRow) & 0x3FF));
+                    uint64_t indices = lcdc._bits._bgWindowEnabled ? FetchTileRow(ppu, GetBGTileNumber(lcdc, tileIdx), windowTileRow, false) : 0;
+                    std::memcpy(bgIndices + windowStart + tileXPos * 8, &indices, sizeof(indices));
+                }
+
+                uint8_t tileIdx = VRAMRead(ppu._vram, windowTileMap + ((windowTileCount - 1 + windowMapRow) & 0x3FF));
+                lastTileLow = lcdc._bits._bgWindowEnabled ? FetchBGTileData(ppu._vram, lcdc, tileIdx, 2 * windowTileRow + 0) : 0;
+                lastTileHigh = lcdc._bits._bgWindowEnabled ? FetchBGTileData(ppu._vram, lcdc, tileIdx, 2 * windowTileRow + 1) : 0;
+                lastTileConsumed = ((SCREEN_WIDTH - windowStart - 1) % 8) + 1;
+
+                pixelFetch._currMode = PixelFetcher::Mode::Window;
+                pixelFetch._currTileXPos = windowTileCount;
+            }
+            else
+            {
+                pixelFetch._currTileXPos = bgTileCount;
+            }
+
+            uint8_t* colors = ppu._lineShades;
+            if (render)
+            {
+                ApplyPalette(ppu._tileDecodeKernel, bgIndices, SCREEN_WIDTH, regs._BGP, colors);
+            }
+
+            // Sprite pixels go where the sprite FIFO would have put them, including its priority bits not shifting along with the pixels
+            // The FIFO only ever holds the 8 pixels from the current one on, so pixels past its count are always transparent
+            PixelFIFO& spriteFifo = pixelFetch._spriteFifo;
+            uint8_t spriteIndices[SCREEN_WIDTH + 8] = {};
+            uint8_t spritePaletteIDs[SCREEN_WIDTH + 8] = {};
+
+            if (ppu._objFetch._spriteCount > 0)
+            {
+                const uint8_t spriteHeight = lcdc._bits._spriteSize ? SPRITE_SIZE_TALL : SPRITE_SIZE;
+
+                for (uint8_t x = 0; x < SCREEN_WIDTH; ++x)
+                {
+                    // Sprites starting on this pixel, in OAM order
+                    uint16_t visibleSpriteBits = FindVisibleSprites(x, ppu._objFetch);
+                    while (visibleSpriteBits)
+                    {
+                        int index = std::countr_zero(visibleSpriteBits);
+                        visibleSpriteBits &= visibleSpriteBits - 1;
+
+                        const OAMEntry& sprite = ppu._objFetch._spriteList[index];
+                        uint8_t tileIdx = lcdc._bits._spriteSize ? (sprite._tileIdx & 0xFE) : sprite._tileIdx;
+                        uint8_t rowIdx = ((regs._LY + 16) - sprite._posY) % spriteHeight;
+                        if (sprite._attribs._yFlip)
+                        {
+                            rowIdx = (spriteHeight - 1) - rowIdx;
+                        }
+
+                        // Tall sprites carry on into the next tile
+                        uint64_t rowIndices = lcdc._bits._spriteEnabled ? FetchTileRow(ppu, tileIdx + rowIdx / 8, rowIdx % 8, sprite._attribs._xFlip) : 0;
+
+                        uint8_t paletteID = sprite._attribs._dmgPalette ? PALETTE_ID_OBP1 : PALETTE_ID_OBP0;
+                        uint8_t priorityBits = sprite._attribs._priority ? 0xFF : 0x00;
+                        for (uint8_t i = 0; i < 8; ++i)
+                        {
+                            uint8_t fifoBit = 0x80 >> i;
+                            if (!spriteIndices[x + i] || (spriteFifo._priorities & ~priorityBits & fifoBit))
+                            {
+                                spriteIndices[x + i] = uint8_t(rowIndices >> (i * 8));
+                                spritePaletteIDs[x + i] = paletteID;
+                                spriteFifo._priorities = (spriteFifo._priorities & ~fifoBit) | (priorityBits & fifoBit);
+                            }
+                        }
+
+                        spriteFifo._count = 8;
+                    }
+
+                    if (!PixelFIFOEmpty(spriteFifo))
+                    {
+                        bool hasPriority = render && (!(spriteFifo._priorities & 0x80) || bgIndices[x] == 0);
+                        if (spriteIndices[x] && hasPriority)
+                        {
+                            uint8_t palette = (spritePaletteIDs[x] == PALETTE_ID_OBP1) ? regs._OBP1 : regs._OBP0;
+                            colors[x] = (palette >> (spriteIndices[x] * 2)) & 0x03;
+                        }
+
+                        spriteFifo._count--;
+                    }
+                }
+            }
+
+            // Whatever is left for the next scanline, same as what shifting out the pixels so far would have left
+            spriteFifo._indicesLow = 0;
+            spriteFifo._indicesHigh = 0;
+            spriteFifo._paletteIDsLow = 0;
+            spriteFifo._paletteIDsHigh = 0;
+            for (uint8_t i = 0; i < spriteFifo._count; ++i)
+            {
+                uint8_t fifoBit = 0x80 >> i;
+                spriteFifo._indicesLow |= (spriteIndices[SCREEN_WIDTH + i] & 0x01) ? fifoBit : 0;
+                spriteFifo._indicesHigh |= (spriteIndices[SCREEN_WIDTH + i] & 0x02) ? fifoBit : 0;
+                spriteFifo._paletteIDsLow |= (spritePaletteIDs[SCREEN_WIDTH + i] & 0x01) ? fifoBit : 0;
+                spriteFifo._paletteIDsHigh |= (spritePaletteIDs[SCREEN_WIDTH + i] & 0x02) ? fifoBit : 0;
+            }
+
+            pixelFetch._bgFifo._indicesLow = uint8_t(lastTileLow << lastTileConsumed);
+            pixelFetch._bgFifo._indicesHigh = uint8_t(lastTileHigh << lastTileConsumed);
+            pixelFetch._bgFifo._paletteIDsLow = 0;
+            pixelFetch._bgFifo._paletteIDsHigh = 0;
+            pixelFetch._bgFifo._priorities = 0;
+            pixelFetch._bgFifo._count = 8 - lastTileConsumed;
+
+            ppu._currPixelXPos = SCREEN_WIDTH;
+        }
+
+        // Decides whether the frame starting now gets rendered
+        void BeginFrame(PPU& ppu)
+        {
+            ppu._renderFrame = ppu._framesUntilRender == 0;
+            if (ppu._renderFrame)
+            {
+                ppu._framesUntilRender = ppu._frameSkip;
+            }
+            else if (ppu._framesUntilRender != PPU_FRAME_SKIP_ALL)
+            {
+                ppu._framesUntilRender--;
+            }
+        }
+
+        // 0xAARRGGBB to what a pixel looks like in the framebuffer, read back as a little endian integer of the pixel's size
+        uint32_t ConvertShade(FramebufferFormat format, uint32_t argb)
+        {
+            uint32_t a = (argb >> 24) & 0xFF;
+            uint32_t r = (argb >> 16) & 0xFF;
+            uint32_t g = (argb >> 8) & 0xFF;
+            uint32_t b = argb & 0xFF;
+
+            switch (format)
+            {
+            case FramebufferFormat::RGBA8888:
+                return a << 24 | b << 16 | g << 8 | r;
+            case FramebufferFormat::RGB565:
+                return (r >> 3) << 11 | (g >> 2) << 5 | (b >> 3);
+            case FramebufferFormat::BGRA8888:
+                return argb;
+            default:
+                return 0;
+            }
+        }
+
+        template <typename T>
+        void WriteScanlinePixels(const uint32_t* shadePixels, const uint8_t* shades, uint8_t* row)
+        {
+            for (uint16_t x = 0; x < SCREEN_WIDTH; ++x)
+            {
+                T pixel = T(shadePixels[shades[x]]);
+                std::memcpy(row + x * sizeof(T), &pixel, sizeof(T));
+            }
+        }
+
+        // Copies the finished scanline into the framebuffer and lets the frontend know
+        void OutputScanline(PPU& ppu, uint8_t LY)
+        {
+            const PPUFramebuffer& framebuffer = ppu._framebuffer;
+            if (framebuffer._pixels)
+            {
+                EMU_ASSERT(LY < SCREEN_HEIGHT);
+                uint8_t* row = static_cast<uint8_t*>(framebuffer._pixels) + size_t(framebuffer._pitch) * LY;
+
+                switch (framebuffer._format)
+                {
+                case FramebufferFormat::Indexed2bpp:
+                    std::memcpy(row, ppu._lineShades, SCREEN_WIDTH);
+                    break;
+                case FramebufferFormat::RGB565:
+                    WriteScanlinePixels<uint16_t>(ppu._shadePixels, ppu._lineShades, row);
+                    break;
+                case FramebufferFormat::RGBA8888:
+                case FramebufferFormat::BGRA8888:
+                    WriteScanlinePixels<uint32_t>(ppu._shadePixels, ppu._lineShades, row);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            if (ppu._scanlineFn)
+            {
+                ppu._scanlineFn(ppu._outputUserData, LY);
+            }
+        }
     }
 
-    void BootPPU(PPU& ppu, uint8_t* vram, uint8_t* oam, FnDisplayPixelWrite pixelWriteFn, void* userData)
+    void BootPPU(PPU& ppu, uint8_t* vram, uint8_t* oam)
     {
         ppu._currMode = PPU::Mode::ObjectFetch;
         ppu._currCycle = 0;
@@ -501,8 +1030,79 @@ namespace emu::SM83
         ppu._vram = vram;
         ppu._oam = oam;
 
-        ppu._pixelWriteFn = pixelWriteFn;
-        ppu._pixelWriteUserData = userData;
+        std::fill(std::begin(ppu._lineShades), std::end(ppu._lineShades), uint8_t(0));
+        ppu._framebuffer = {};
+        std::fill(std::begin(ppu._shadePixels), std::end(ppu._shadePixels), 0u);
+        ppu._frameSkip = 0;
+        ppu._framesUntilRender = 0;
+        ppu._renderFrame = true;
+        ppu._scanlineFn = nullptr;
+        ppu._frameFn = nullptr;
+        ppu._outputUserData = nullptr;
+
+        ppu._hblankFn = nullptr;
+        ppu._hblankUserData = nullptr;
+
+        ppu._batchScanlines = true;
+        ppu._lineBatched = false;
+        ppu._hblankCycle = 0;
+        ppu._lineRegs = {};
+        ppu._tileDecodeKernel = GetTileDecodeKernel();
+        ppu._tileCache = nullptr;
+    }
+
+    void InvalidateTileCache(TileCache& cache, uint16_t address, uint32_t size)
+    {
+        uint32_t begin = std::max<uint32_t>(address, TILE_DATA_BEGIN);
+        uint32_t end = std::min<uint32_t>(address + size, TILE_DATA_END);
+        for (uint32_t tileAddress = begin & ~0x0Fu; tileAddress < end; tileAddress += 16)
+        {
+            uint32_t tileNumber = (tileAddress - TILE_DATA_BEGIN) / 16;
+            cache._dirtyTiles[tileNumber / 64] |= uint64_t(1) << (tileNumber % 64);
+        }
+    }
+
+    void SetPPUTileCache(PPU& ppu, MMU& mmu, TileCache* cache)
+    {
+        ppu._tileCache = cache;
+        if (cache)
+        {
+            InvalidateTileCache(*cache, TILE_DATA_BEGIN, TILE_DATA_END - TILE_DATA_BEGIN);
+        }
+
+        MapVRAM(ppu, mmu);
+    }
+
+    void SetPPUFramebuffer(PPU& ppu, const PPUFramebuffer& framebuffer)
+    {
+        EMU_ASSERT(!framebuffer._pixels || framebuffer._pitch >= SCREEN_WIDTH * (
+            framebuffer._format == FramebufferFormat::Indexed2bpp ? 1 :
+            framebuffer._format == FramebufferFormat::RGB565 ? 2 : 4));
+
+        ppu._framebuffer = framebuffer;
+        for (uint8_t i = 0; i < 4; ++i)
+        {
+            ppu._shadePixels[i] = ConvertShade(framebuffer._format, framebuffer._shades[i]);
+        }
+    }
+
+    void SetPPUOutputHooks(PPU& ppu, FnScanlineHook scanlineFn, FnFrameHook frameFn, void* userData)
+    {
+        ppu._scanlineFn = scanlineFn;
+        ppu._frameFn = frameFn;
+        ppu._outputUserData = userData;
+    }
+
+    void SetPPUFrameSkip(PPU& ppu, uint32_t skippedFrames)
+    {
+        ppu._frameSkip = skippedFrames;
+        ppu._framesUntilRender = skippedFrames;
+    }
+
+    void SetPPUHBlankHook(PPU& ppu, FnHBlankHook hblankFn, void* userData)
+    {
+        ppu._hblankFn = hblankFn;
+        ppu._hblankUserData = userData;
     }
 
     void TickPPU(PPU& ppu, MMU& mmu, PeripheralIO& pIO)
@@ -514,13 +1114,9 @@ namespace emu::SM83
 
         if (!lcdc._bits._displayEnable)
         {
-            if (ppu._currMode == PPU::Mode::ObjectFetch)
-            {
-                MapMemoryRegion(mmu, OAM_ADDR, OAM_SIZE, ppu._oam, 0);
-            }
-            else if (ppu._currMode == PPU::Mode::PixelFetch)
+            if (mmu._videoLock != MMUVideoLock::None)
             {
-                MapMemoryRegion(mmu, VRAM_ADDR, VRAM_SIZE, ppu._vram, 0);
+                SetVideoLock(mmu, MMUVideoLock::None);
             }
             return;
         }
@@ -529,9 +1125,12 @@ namespace emu::SM83
         {
         case PPU::Mode::ObjectFetch:
         {
-            // Make OAM inaccessible until next stage
-            UnmapMemoryRegion(mmu, OAM_ADDR, OAM_SIZE);
-            TickObjectFetcher(ppu._currCycle, pIO.LY, lcdc, ppu._objFetch, ppu._oam);
+            // Make OAM inaccessible until next stage, the display may have just been turned back on in the middle of it
+            if (mmu._videoLock != MMUVideoLock::OAM)
+            {
+                SetVideoLock(mmu, MMUVideoLock::OAM);
+            }
+            ScanOAMEntries(ppu._currCycle, ppu._currCycle + 1, pIO.LY, lcdc, ppu._objFetch, ppu._oam);
 
             if (ppu._currCycle + 1 >= CYCLES_PER_OAM_SCAN)
             {
@@ -543,82 +1142,46 @@ namespace emu::SM83
                 ppu._pixelFetch._numBGTilesFetchedInCurrScanline = 0;
                 ppu._pixelFetch._visibleSpriteBits = 0;
 
-                // Make OAM memory accessible again
-                MapMemoryRegion(mmu, OAM_ADDR, OAM_SIZE, ppu._oam, 0);
+                // Scanlines get drawn in one go at the end of pixel fetch, unless a register write gets in the way
+                // Pixels left over in the FIFOs get discarded or not depending on timing, those scanlines go dot by dot
+                ppu._lineRegs = ReadLineRegisters(pIO);
+                ppu._lineBatched =
+                    ppu._batchScanlines &&
+                    PixelFIFOEmpty(ppu._pixelFetch._bgFifo) &&
+                    PixelFIFOEmpty(ppu._pixelFetch._spriteFifo);
+
+                if (ppu._lineBatched)
+                {
+                    ppu._hblankCycle = ComputePixelFetchEnd(ppu);
+                }
+
+                // Make OAM memory accessible again and VRAM inaccessible until HBlank, batched scanlines skip the dots in between
+                SetVideoLock(mmu, MMUVideoLock::VRAM);
             }
         }
             break;
 
         case PPU::Mode::PixelFetch:
         {
-            // Make VRAM inaccessible until next stage
-            UnmapMemoryRegion(mmu, VRAM_ADDR, VRAM_SIZE);
-
-            if (!ppu._pixelFetch._visibleSpriteBits)
+            // Only ever not locked here when the display has just been turned back on
+            if (mmu._videoLock != MMUVideoLock::VRAM)
             {
-                uint16_t visibleSpriteBits = FindVisibleSprites(ppu._currPixelXPos, ppu._objFetch);
-                if (visibleSpriteBits)
-                {
-                    ppu._pixelFetch._visibleSpriteBits = visibleSpriteBits;
-
-                    // Potential penalty up to 6 cycles due to resetting of background FIFO when entering sprite rendering mode
-                    ppu._pixelFetch._currStage = PixelFetchStage::FetchTileNumber;
-                }
+                SetVideoLock(mmu, MMUVideoLock::VRAM);
             }
 
-            // Switch into window fetching mode if needed
-            if (lcdc._bits._windowDisplayEnable &&
-                pIO.LY >= pIO.WY &&
-                ppu._currPixelXPos >= pIO.WX - 7 &&
-                ppu._pixelFetch._currMode != PixelFetcher::Mode::Window)
-            {
-                ppu._pixelFetch._currMode = PixelFetcher::Mode::Window;
-                ppu._pixelFetch._currStage = PixelFetchStage::FetchTileNumber;
-                ppu._pixelFetch._currTileXPos = 0;
-
-                // Potential 6 cycle penalty when entering Window mode due to FIFO clear
-                PixelFIFOClear(ppu._pixelFetch._bgFifo);
-            }
-           
-            if (!ppu._pixelFetch._visibleSpriteBits || PixelFIFOEmpty(ppu._pixelFetch._bgFifo))
-            {   
-                TickPixelFetcherBackground(
-                    ppu._pixelFetch._currMode == PixelFetcher::Mode::Window,
-                    ppu._currCycle,
-                    pIO.LY,
-                    pIO.SCX,
-                    pIO.SCY,
-                    lcdc,
-                    ppu._pixelFetch,
-                    ppu._vram);
-            }
-            
-            if (ppu._pixelFetch._visibleSpriteBits && !PixelFIFOEmpty(ppu._pixelFetch._bgFifo))
-            {
-                unsigned long index = 0;
-                _BitScanForward(&index, ppu._pixelFetch._visibleSpriteBits);
-                TickPixelFetcherSprite(
-                    ppu._currCycle,
-                    ppu._currPixelXPos,
-                    pIO.LY,
-                    lcdc,
-                    ppu._pixelFetch,
-                    ppu._objFetch,
-                    uint8_t(index),
-                    ppu._vram);
-            }
+            // Batched scanlines have nothing to do until the dot pixel fetch ends on
+            bool scanlineDone = ppu._lineBatched ?
+                ppu._currCycle + 1 >= ppu._hblankCycle :
+                TickPixelFetch(ppu, ReadLineRegisters(pIO));
 
-            // Push pixels while we're not fetching sprites
-            if (!ppu._pixelFetch._visibleSpriteBits)
+            if (scanlineDone)
             {
-                if (TickPixelFIFOs(ppu._currCycle, pIO.SCX, pIO.BGP, pIO.OBP0, pIO.OBP1, ppu._pixelFetch._bgFifo, ppu._pixelFetch._spriteFifo, lcdc, ppu._pixelWriteUserData, ppu._pixelWriteFn))
+                if (ppu._lineBatched)
                 {
-                    ppu._currPixelXPos++;
+                    RenderScanline(ppu);
+                    ppu._lineBatched = false;
                 }
-            }
 
-            if (ppu._currPixelXPos >= SCREEN_WIDTH)
-            {
                 // Move to HBLANK stage
                 EMU_ASSERT(ppu._currCycle + 1 >= 80 + 172 && ppu._currCycle + 1 <= 80 + 289);
                 ppu._currMode = PPU::Mode::HBlank;
@@ -629,8 +1192,18 @@ namespace emu::SM83
                     pIO.IF |= INT_BIT_STAT;
                 }
 
+                if (ppu._renderFrame)
+                {
+                    OutputScanline(ppu, ppu._lineRegs._LY);
+                }
+
                 // Make VRAM accessible again
-                MapMemoryRegion(mmu, VRAM_ADDR, VRAM_SIZE, ppu._vram, 0);
+                SetVideoLock(mmu, MMUVideoLock::None);
+
+                if (ppu._hblankFn)
+                {
+                    ppu._hblankFn(ppu._hblankUserData, mmu);
+                }
             }
         }
             break;
@@ -672,12 +1245,22 @@ namespace emu::SM83
 
                     ppu._pixelFetch._windowLineCounter = 0;
                     ppu._windowScanlineHitThisFrame = false;
+
+                    if (ppu._frameFn)
+                    {
+                        ppu._frameFn(ppu._outputUserData);
+                    }
                 }
                 else if (ppu._currMode == PPU::Mode::HBlank || 
                         (ppu._currMode == PPU::Mode::VBlank && pIO.LY == 0))
                 {
                     ppu._currMode = PPU::Mode::ObjectFetch;
                     ppu._objFetch._spriteCount = 0;
+
+                    if (pIO.LY == 0)
+                    {
+                        BeginFrame(ppu);
+                    }
                     
                     if ((pIO.STAT & (1 << 5)))
                     {
@@ -694,17 +1277,104 @@ namespace emu::SM83
         }
 
         ppu._currCycle = (ppu._currCycle + 1) % CYCLES_PER_SCANLINE;
+        UpdateSTAT(ppu, pIO);
+    }
+
+    uint32_t AdvancePPU(PPU& ppu, MMU& mmu, PeripheralIO& pIO, uint32_t cycles)
+    {
+        const LCDControl lcdc =
+        {
+            ._u8 = pIO.LCDC
+        };
+
+        if (!lcdc._bits._displayEnable)
+        {
+            // Nothing advances while the display is off, a single tick is enough to restore memory access
+            if (cycles > 0)
+            {
+                TickPPU(ppu, mmu, pIO);
+            }
+            return 0;
+        }
+
+        // OAM DMA writes to OAM as it goes, scans only keep up with it dot by dot
+        const bool batchOAMScan = mmu._lockedBus == MMUBus::None;
+
+        while (cycles > 0)
+        {
+            // Everything up to the last dot of an OAM scan only reads OAM and is caught up on in one go, as far as the PPU gets
+            // Registers are synced before they're written, so the entries scanned so far saw them as they were
+            if (batchOAMScan && ppu._currMode == PPU::Mode::ObjectFetch && ppu._currCycle < CYCLES_PER_OAM_SCAN - 1)
+            {
+                // The display may have just been turned back on in the middle of it
+                if (mmu._videoLock != MMUVideoLock::OAM)
+                {
+                    SetVideoLock(mmu, MMUVideoLock::OAM);
+                }
+
+                uint32_t scanCycles = std::min<uint32_t>(cycles, CYCLES_PER_OAM_SCAN - 1 - ppu._currCycle);
+                ScanOAMEntries(ppu._currCycle, uint16_t(ppu._currCycle + scanCycles), pIO.LY, lcdc, ppu._objFetch, ppu._oam);
+                ppu._currCycle += uint16_t(scanCycles);
+                UpdateSTAT(ppu, pIO);
 
-        // Update STAT
-        pIO.STAT = (pIO.STAT & 0xFC) | (uint8_t(ppu._currMode) & 0x03);
-        if (pIO.LY == pIO.LYC)
+                cycles -= scanCycles;
+                continue;
+            }
+
+            // Only the last dot of a blanking scanline or a batched pixel fetch does any work, skip ahead to it in one go
+            bool isBlanking = ppu._currMode == PPU::Mode::HBlank || ppu._currMode == PPU::Mode::VBlank;
+            bool isBatched = ppu._currMode == PPU::Mode::PixelFetch && ppu._lineBatched;
+            uint16_t workCycle = isBatched ? ppu._hblankCycle - 1 : CYCLES_PER_SCANLINE - 1;
+            if ((isBlanking || isBatched) && ppu._currCycle < workCycle)
+            {
+                uint32_t idleCycles = std::min<uint32_t>(cycles, workCycle - ppu._currCycle);
+                ppu._currCycle += uint16_t(idleCycles);
+                UpdateSTAT(ppu, pIO);
+
+                cycles -= idleCycles;
+                continue;
+            }
+
+            TickPPU(ppu, mmu, pIO);
+            cycles--;
+        }
+
+        if (ppu._currMode == PPU::Mode::HBlank || ppu._currMode == PPU::Mode::VBlank)
+        {
+            return CYCLES_PER_SCANLINE - ppu._currCycle;
+        }
+
+        if (ppu._currMode == PPU::Mode::PixelFetch && ppu._lineBatched)
+        {
+            return ppu._hblankCycle - ppu._currCycle;
+        }
+
+        if (ppu._currMode == PPU::Mode::ObjectFetch && batchOAMScan)
+        {
+            return CYCLES_PER_OAM_SCAN - ppu._currCycle;
+        }
+
+        return 1;
+    }
+
+    void NotifyPPURegisterWrite(PPU& ppu, uint16_t address)
+    {
+        // STAT, LY and LYC have no say in what ends up on screen
+        if (!ppu._lineBatched || address == ADDR_STAT || address == ADDR_LY || address == ADDR_LYC)
         {
-            pIO.STAT |= 1 << 2;
+            return;
         }
-        else
+
+        // Catch up on the dots so far with the registers as they were, the rest of the scanline goes dot by dot
+        uint16_t currCycle = ppu._currCycle;
+        ppu._lineBatched = false;
+
+        for (ppu._currCycle = CYCLES_PER_OAM_SCAN; ppu._currCycle < currCycle; ++ppu._currCycle)
         {
-            pIO.STAT &= ~(1 << 2);
+            TickPixelFetch(ppu, ppu._lineRegs);
         }
+
+        ppu._currCycle = currCycle;
     }
 
 };
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include "OpCodes.hpp"
 #include "MMU.hpp"
 #include "DMGBoot.hpp"
+#include "Interpreter.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <initializer_list>
 
@@ -52,12 +54,8 @@ namespace emu::SM83
 
         TCycleState NextTCycle(TCycleState state)
         {
-            return state == T4_1 ? T1_0 : TCycleState(uint8_t(state) + 1);
-        }
-
-        bool IsLastMCycle(InstructionTable table, const MCycle& cycle, uint8_t indexInOpcode, uint8_t opcode)
-        {
-            return (cycle._misc._flags & MCycle::Misc::MF_LastCycle) || (indexInOpcode == GetMCycleCount(table, opcode) - 1);
+            // Every T-cycle covers two half T-cycle states
+            return TCycleState((uint8_t(state) + 2) & 0x7);
         }
 
         void FixupFlagRegister(Registers& regs)
@@ -70,7 +68,46 @@ namespace emu::SM83
         constexpr const uint16_t IO_REG_IF = 0xFF0F;
 
 
-        void ProcessCurrentMCycle(
+        // Runs at the end of every instruction, pending interrupts get dispatched through the interrupt instruction table
+        void CheckInterrupts(Registers& regs, Decoder& decoder, PeripheralIO& pIO)
+        {
+            uint8_t IE_IF = (pIO.IE & pIO.IF) & 0x1F;
+            if (IE_IF != 0)
+            {
+                if (regs._reg8.IME)
+                {
+                    // Kind of a hack to hijack the instruction register, but should be harmless?
+                    if (IE_IF & INT_BIT_VBLANK)
+                    {
+                        regs._reg8.IR = INT_VBLANK;
+                    }
+                    else if (IE_IF & INT_BIT_STAT)
+                    {
+                        regs._reg8.IR = INT_STAT;
+                    }
+                    else if (IE_IF & INT_BIT_TIMER)
+                    {
+                        regs._reg8.IR = INT_TIMER;
+                    }
+                    else if (IE_IF & INT_BIT_SERIAL)
+                    {
+                        regs._reg8.IR = INT_SERIAL;
+                    }
+                    else if (IE_IF & INT_BIT_JOYPAD)
+                    {
+                        regs._reg8.IR = INT_JOYPAD;
+                    }
+
+                    decoder._table = InstructionTable::Interrupt;
+                    pIO.IF = 0;
+                }
+
+                // Always resume when an interrupt could get triggered, even if interrupts aren't enabled
+                decoder._flags &= ~Decoder::DF_ExecutionHalted;
+            }
+        }
+
+        void ProcessCurrentTCycle(
             IO& io, 
             Registers& regs,
             Decoder& decoder,
@@ -86,26 +123,13 @@ namespace emu::SM83
             {
                 case T1_0:
                 {
-                    decoder._currMCycle = GetMCycle(decoder._table, regs._reg8.IR, decoder._nextMCycleIndex);
+                    // T1_0: Pick up the next predecoded MCycle, fetch overlap has already been merged in for the last MCycle of an instruction
+                    const MicroOp& op = GetMicroOp(decoder._table, regs._reg8.IR, decoder._nextMCycleIndex);
+                    decoder._currOp = &op;
 
-                    // Set M1 pin if we're in a fetch cycle and overlap MCycle with fetch cycle if required
-                    if (IsLastMCycle(decoder._table, decoder._currMCycle, decoder._nextMCycleIndex, regs._reg8.IR))
+                    // Set M1 pin if we're in a fetch cycle
+                    if (op._flags & MicroOp::UOF_LastCycle)
                     {
-                        const MCycle& fetchCyle = GetFetchMCycle();
-
-                        // Allow fetch cycle IDU op to be overwritten by instruction IDU op
-                        if (decoder._currMCycle._idu._op == IDUOp::Nop &&
-                            decoder._currMCycle._idu._operand == RegisterOperand::None &&
-                            decoder._currMCycle._idu._dest == RegisterOperand::None)
-                        {
-                            decoder._currMCycle._idu = fetchCyle._idu;
-                        }
-
-                        // Same for memory op
-                        if ((decoder._currMCycle._memOp._flags & MCycle::MemOp::MOF_Active) == 0)
-                        {
-                            decoder._currMCycle._memOp = fetchCyle._memOp;
-                        }
                         io._outPins.M1 = 1;
 
                         // Revert to using default instruction table
@@ -118,60 +142,35 @@ namespace emu::SM83
                     }
 
                     // Switch instruction tables here if needed
-                    if (decoder._currMCycle._misc._flags & MCycle::Misc::MF_PrefixCB)
+                    if (op._flags & MicroOp::UOF_PrefixCB)
                     {
                         decoder._table = InstructionTable::PrefixCB;
                     }
 
                     // Pull address for memory operation (if any) onto address bus
-                    if (decoder._currMCycle._memOp._flags & MCycle::MemOp::MOF_Active)
+                    // T1_1: Set MRQ and read or write pin based on the memory operation type
+                    if (op._flags & (MicroOp::UOF_MemRead | MicroOp::UOF_MemWrite))
                     {
-                        if (decoder._currMCycle._memOp._flags & MCycle::MemOp::MOF_UseOffsetAddress)
-                        {
-                            io._address = 0xFF00 + LoadReg8(regs, decoder._currMCycle._memOp._addressSrcBeforeOffset);
-                        }
-                        else
-                        {
-                            io._address = LoadReg16(regs, decoder._currMCycle._memOp._addressSrc);
-                        }
-                    }
-                }
-                    break;
+                        io._address = (op._flags & MicroOp::UOF_UseOffsetAddress) ?
+                            0xFF00 + LoadReg8(regs, op._memAddressSrc) :
+                            LoadReg16(regs, op._memAddressSrc);
 
-                case T1_1:
-                {
-                    // Set MRQ and read or write pin based on the memory operation type
-                    if (decoder._currMCycle._memOp._flags & MCycle::MemOp::MOF_Active)
-                    {
-                        if (decoder._currMCycle._memOp._flags & MCycle::MemOp::MOF_IsMemWrite)
-                        {
-                            io._outPins.MRQ = 1;
-                        }
-                        else
-                        {
-                            io._outPins.MRQ = 1;
-                            io._outPins.RD = 1;
-                        }
+                        io._outPins.MRQ = 1;
+                        io._outPins.RD = (op._flags & MicroOp::UOF_MemRead) ? 1 : 0;
                     }
-                    
                 }
                     break;
 
                 case T2_0:
                 {
-                    // T-Cycle waiting for memory controller to write to data bus if mem read was requested
-                }
-                    break;
-
-                case T2_1:
-                {
-                    // If memory was requested it is now on the data bus. Put it in destination register
+                    // T2_0: T-Cycle waiting for memory controller to write to data bus if mem read was requested
+                    // T2_1: If memory was requested it is now on the data bus. Put it in destination register
                     // This handles setting the instruction register in a fetch cycle!!
-                    if ((decoder._currMCycle._memOp._flags & MCycle::MemOp::MOF_Active) &&
-                        !(decoder._currMCycle._memOp._flags & MCycle::MemOp::MOF_IsMemWrite))
+                    const MicroOp& op = *decoder._currOp;
+                    if (op._flags & MicroOp::UOF_MemRead)
                     {
-                        StoreReg8(regs, decoder._currMCycle._memOp._reg, io._data);
-                        if (decoder._currMCycle._memOp._reg == RegisterOperand::TempRegZ)
+                        StoreReg8(regs, op._memReg, io._data);
+                        if (op._flags & MicroOp::UOF_TrackSignBit)
                         {
                             // This feels like a hack :(
                             if (io._data & 0x80)
@@ -189,57 +188,52 @@ namespace emu::SM83
                     uint8_t aluFlags = 0;
 
                     // Handle ALU operation 
-                    if (decoder._currMCycle._alu._operandA != RegisterOperand::None && 
-                        decoder._currMCycle._alu._operandB != RegisterOperand::None &&
-                        decoder._currMCycle._alu._dest != RegisterOperand::None)
+                    if (op._flags & MicroOp::UOF_ALU)
                     {
-                        uint8_t aluOperandA = LoadReg8(regs, decoder._currMCycle._alu._operandA);
-                        uint8_t aluOperandB = LoadReg8(regs, decoder._currMCycle._alu._operandB);
+                        uint8_t aluOperandA = LoadReg8(regs, op._aluOperandA);
+                        uint8_t aluOperandB = LoadReg8(regs, op._aluOperandB);
            
                         ALUOutput aluResult = ProcessALUOp(
-                            decoder._currMCycle._alu._op,
+                            op._aluOp,
                             regs._reg8.F,
                             aluOperandA,
                             aluOperandB,
                             aluOpFlags);
 
-                        if (decoder._currMCycle._misc._flags & MCycle::Misc::MF_ALUClearZero)
+                        if (op._miscFlags & MCycle::Misc::MF_ALUClearZero)
                         {
                             aluResult._flags &= ~SF_Zero;
                         }
 
-                        if ((decoder._currMCycle._misc._flags & MCycle::Misc::MF_ALUKeepFlags) == 0)
+                        if ((op._miscFlags & MCycle::Misc::MF_ALUKeepFlags) == 0)
                         {
                             regs._reg8.F = aluResult._flags;
                         }
 
-
-                        StoreReg8(regs, decoder._currMCycle._alu._dest, aluResult._result);
+                        StoreReg8(regs, op._aluDest, aluResult._result);
 
                         aluFlags = aluResult._flags;
                     }
 
                     // Handle IDU operation
-                    if (decoder._currMCycle._idu._operand != RegisterOperand::None &&
-                        decoder._currMCycle._idu._dest != RegisterOperand::None)
+                    if (op._flags & MicroOp::UOF_IDU)
                     {
                         int iduOpFlags = aluOpFlags;
                         iduOpFlags |= (aluFlags & SF_Carry) ? PAOF_ALUHasCarry : 0;
 
-                        uint16_t iduOperand = LoadReg16(regs, decoder._currMCycle._idu._operand);
+                        uint16_t iduOperand = LoadReg16(regs, op._iduOperand);
                         IDUOutput iduResult = ProcessIDUOp(
-                            decoder._currMCycle._idu._op, 
+                            op._iduOp, 
                             iduOperand,
                             iduOpFlags);
                             
-                        StoreReg16(regs, decoder._currMCycle._idu._dest, iduResult._result);
+                        StoreReg16(regs, op._iduDest, iduResult._result);
                     }
                     
                     // If memory write was requested notify memory controller
-                    if ((decoder._currMCycle._memOp._flags & MCycle::MemOp::MOF_Active) &&
-                        (decoder._currMCycle._memOp._flags & MCycle::MemOp::MOF_IsMemWrite))
+                    if (op._flags & MicroOp::UOF_MemWrite)
                     {
-                        io._data = LoadReg8(regs, decoder._currMCycle._memOp._reg);
+                        io._data = LoadReg8(regs, op._memReg);
                         io._outPins.WR = 1;
                     }
                 }
@@ -247,101 +241,69 @@ namespace emu::SM83
 
                 case T3_0:
                 {
-                    // Clear M1 pin
+                    // T3_0: Clear M1 pin and handle misc operations
+                    const MicroOp& op = *decoder._currOp;
                     io._outPins.M1 = 0; 
 
-                    // Handle Misc operations
-                    if (decoder._currMCycle._misc._flags & MCycle::Misc::MF_WriteWZToWideRegister)
+                    if (op._flags & MicroOp::UOF_Misc)
                     {
-                        StoreReg16(regs, decoder._currMCycle._misc._operand, regs._reg16.TempWZ);
-                        FixupFlagRegister(regs);    // In case we wrote to F
-                    }
-                    else if (decoder._currMCycle._misc._flags & MCycle::Misc::MF_WriteValueToWideRegister)
-                    {
-                        StoreReg16(regs, decoder._currMCycle._misc._operand, decoder._currMCycle._misc._optValue);
-                    }
+                        if (op._miscFlags & MCycle::Misc::MF_WriteWZToWideRegister)
+                        {
+                            StoreReg16(regs, op._miscOperand, regs._reg16.TempWZ);
+                            FixupFlagRegister(regs);    // In case we wrote to F
+                        }
+                        else if (op._miscFlags & MCycle::Misc::MF_WriteValueToWideRegister)
+                        {
+                            StoreReg16(regs, op._miscOperand, op._miscValue);
+                        }
 
-                    if (decoder._currMCycle._misc._flags & MCycle::Misc::MF_EnableInterrupts)
-                    {
-                        regs._reg8.IME = 1;
-                    }
-                    else if (decoder._currMCycle._misc._flags & MCycle::Misc::MF_DisableInterrupts)
-                    {
-                        regs._reg8.IME = 0;
-                    }
+                        if (op._miscFlags & MCycle::Misc::MF_EnableInterrupts)
+                        {
+                            regs._reg8.IME = 1;
+                        }
+                        else if (op._miscFlags & MCycle::Misc::MF_DisableInterrupts)
+                        {
+                            regs._reg8.IME = 0;
+                        }
 
-                    // Conditional checks
-                    if ((decoder._currMCycle._misc._flags & MCycle::Misc::MF_ConditionCheckC) && (regs._reg8.F & SF_Carry) ||
-                        (decoder._currMCycle._misc._flags & MCycle::Misc::MF_ConditionCheckZ) && (regs._reg8.F & SF_Zero) ||
-                        (decoder._currMCycle._misc._flags & MCycle::Misc::MF_ConditionCheckNC) && !(regs._reg8.F & SF_Carry) ||
-                        (decoder._currMCycle._misc._flags & MCycle::Misc::MF_ConditionCheckNZ) && !(regs._reg8.F & SF_Zero))
-                    {
-                        decoder._nextMCycleIndex = uint8_t(decoder._currMCycle._misc._optValue);
+                        // Conditional checks
+                        if ((op._miscFlags & MCycle::Misc::MF_ConditionCheckC) && (regs._reg8.F & SF_Carry) ||
+                            (op._miscFlags & MCycle::Misc::MF_ConditionCheckZ) && (regs._reg8.F & SF_Zero) ||
+                            (op._miscFlags & MCycle::Misc::MF_ConditionCheckNC) && !(regs._reg8.F & SF_Carry) ||
+                            (op._miscFlags & MCycle::Misc::MF_ConditionCheckNZ) && !(regs._reg8.F & SF_Zero))
+                        {
+                            decoder._nextMCycleIndex = uint8_t(op._miscValue);
+                        }
                     }
-                }
-                    break;
-                case T3_1:
-                {
-                    // Clear memory pins
+
+                    // T3_1: Clear memory pins
                     io._outPins.MRQ = 0;
                     io._outPins.RD = 0;
                     io._outPins.WR = 0;
                 }
                     break;
+
                 case T4_0:
                 {
-                    
-                }
-                    break;
-                case T4_1:
-                {
-                    if (decoder._currMCycle._misc._flags & MCycle::Misc::MF_StopExecution)
+                    // T4_0 is idle, all work happens in T4_1
+                    const MicroOp& op = *decoder._currOp;
+                    if (op._flags & MicroOp::UOF_StopOrHalt)
                     {
-                        decoder._flags |= Decoder::DF_ExecutionStopped;
-                    }
+                        if (op._miscFlags & MCycle::Misc::MF_StopExecution)
+                        {
+                            decoder._flags |= Decoder::DF_ExecutionStopped;
+                        }
 
-                    if (decoder._currMCycle._misc._flags & MCycle::Misc::MF_HaltExecution)
-                    {
-                        decoder._flags |= Decoder::DF_ExecutionHalted;
+                        if (op._miscFlags & MCycle::Misc::MF_HaltExecution)
+                        {
+                            decoder._flags |= Decoder::DF_ExecutionHalted;
+                        }
                     }
 
                     // HACK! Handle interrupts
                     if (decoder._nextMCycleIndex == 0)
                     {
-                        uint8_t IE_IF = (pIO.IE & pIO.IF) & 0x1F;
-                        if (IE_IF != 0)
-                        {
-                            if (regs._reg8.IME)
-                            {
-                                // Kind of a hack to hijack the instruction register, but should be harmless?
-                                if (IE_IF & INT_BIT_VBLANK)
-                                {
-                                    regs._reg8.IR = INT_VBLANK;
-                                }
-                                else if (IE_IF & INT_BIT_STAT)
-                                {
-                                    regs._reg8.IR = INT_STAT;
-                                }
-                                else if (IE_IF & INT_BIT_TIMER)
-                                {
-                                    regs._reg8.IR = INT_TIMER;
-                                }
-                                else if (IE_IF & INT_BIT_SERIAL)
-                                {
-                                    regs._reg8.IR = INT_SERIAL;
-                                }
-                                else if (IE_IF & INT_BIT_JOYPAD)
-                                {
-                                    regs._reg8.IR = INT_JOYPAD;
-                                }
-
-                                decoder._table = InstructionTable::Interrupt;
-                                pIO.IF = 0;
-                            }
-
-                            // Always resume when an interrupt could get triggered, even if interrupts aren't enabled
-                            decoder._flags &= ~Decoder::DF_ExecutionHalted;
-                        }
+                        CheckInterrupts(regs, decoder, pIO);
                     }
                 }
                     break;
@@ -355,6 +317,215 @@ namespace emu::SM83
 
             decoder._tCycleState = NextTCycle(decoder._tCycleState);
         }
+
+        constexpr const uint8_t BIT_TIMA_ENABLED = (1 << 2);
+
+        // System clock ticks per TIMA increment, indexed by the lower bits of TAC
+        constexpr const uint16_t TIMA_FREQUENCIES[] =
+        {
+            256,
+            4,
+            16,
+            64
+        };
+
+        constexpr const uint8_t IO_REG_TIMER_BEGIN = uint8_t(offsetof(PeripheralIO, DIV));
+        constexpr const uint8_t IO_REG_TIMER_END = uint8_t(offsetof(PeripheralIO, TAC));
+        constexpr const uint8_t IO_REG_DIV = uint8_t(offsetof(PeripheralIO, DIV));
+        constexpr const uint8_t IO_REG_BOOT_CTRL = uint8_t(offsetof(PeripheralIO, BOOT_CTRL));
+
+        // How the CPU sees the IO registers, only applied when it accesses them
+        struct IORegisterMasks
+        {
+            uint8_t _read[MMU_SEGMENT_SIZE];    // OR-ed into reads, for bits that always read as 1
+            uint8_t _write[MMU_SEGMENT_SIZE];   // Bits the CPU can change, the others are read-only
+        };
+
+        constexpr IORegisterMasks BuildIORegisterMasks()
+        {
+            IORegisterMasks masks = {};
+            for (uint32_t i = 0; i < MMU_SEGMENT_SIZE; ++i)
+            {
+                masks._read[i] = 0x00;
+                masks._write[i] = 0xFF;
+            }
+
+            auto setMasks = [&masks](size_t offset, uint8_t read, uint8_t write)
+            {
+                masks._read[offset] = read;
+                masks._write[offset] = write;
+            };
+
+            auto setUnused = [&masks](size_t offset, size_t count)
+            {
+                for (size_t i = offset; i < offset + count; ++i)
+                {
+                    masks._read[i] = 0xFF;
+                    masks._write[i] = 0x00;
+                }
+            };
+
+            // No joypad input yet, so buttons always read as released
+            setMasks(offsetof(PeripheralIO, JOYP), 0xCF, 0x30);
+            setMasks(offsetof(PeripheralIO, SC), 0x7E, 0x81);
+
+            // The lower byte of the system clock isn't visible
+            setUnused(offsetof(PeripheralIO, SYSCLCK), 1);
+            setMasks(offsetof(PeripheralIO, TAC), 0xF8, 0x07);
+            setUnused(offsetof(PeripheralIO, UNKNOWN0), sizeof(PeripheralIO::UNKNOWN0));
+            setMasks(offsetof(PeripheralIO, IF), 0xE0, 0x1F);
+
+            // Audio isn't emulated, but its registers still read back like the real ones
+            constexpr const uint8_t NR_READ_MASKS[32] =
+            {
+                0x80, 0x3F, 0x00, 0xFF, 0xBF,   // NR10 - NR14
+                0xFF, 0x3F, 0x00, 0xFF, 0xBF,   // Unused, NR21 - NR24
+                0x7F, 0xFF, 0x9F, 0xFF, 0xBF,   // NR30 - NR34
+                0xFF, 0xFF, 0x00, 0x00, 0xBF,   // Unused, NR41 - NR44
+                0x00, 0x00, 0x70,               // NR50 - NR52
+                0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            };
+
+            for (size_t i = 0; i < sizeof(NR_READ_MASKS); ++i)
+            {
+                masks._read[offsetof(PeripheralIO, NR) + i] = NR_READ_MASKS[i];
+            }
+
+            setUnused(offsetof(PeripheralIO, NR) + 0x05, 1);
+            setUnused(offsetof(PeripheralIO, NR) + 0x0F, 1);
+            setUnused(offsetof(PeripheralIO, NR) + 0x17, 9);
+
+            // Only the power bit of NR52 can be written, the rest is channel status
+            masks._write[offsetof(PeripheralIO, NR) + 0x16] = 0x80;
+
+            // Mode and coincidence bits of STAT are up to the PPU, as is LY
+            setMasks(offsetof(PeripheralIO, STAT), 0x80, 0x78);
+            setMasks(offsetof(PeripheralIO, LY), 0x00, 0x00);
+            setUnused(offsetof(PeripheralIO, UNKNOWN2), sizeof(PeripheralIO::UNKNOWN2));
+
+            // VRAM DMA addresses are write-only, HDMA5 reads back the transfer status set by the DMA
+            for (size_t i = offsetof(PeripheralIO, HDMA1); i <= offsetof(PeripheralIO, HDMA4); ++i)
+            {
+                setMasks(i, 0xFF, 0xFF);
+            }
+
+            setUnused(offsetof(PeripheralIO, UNKNOWN3), sizeof(PeripheralIO::UNKNOWN3));
+            setUnused(offsetof(PeripheralIO, UNKNOWN4), sizeof(PeripheralIO::UNKNOWN4));
+            setUnused(offsetof(PeripheralIO, UNKNOWN5), sizeof(PeripheralIO::UNKNOWN5));
+
+            return masks;
+        }
+
+        constexpr const IORegisterMasks IO_REGISTER_MASKS = BuildIORegisterMasks();
+
+        uint16_t& GetSystemClock(PeripheralIO& pIO)
+        {
+            return *reinterpret_cast<uint16_t*>(&pIO.SYSCLCK);
+        }
+
+        // T-cycles from the last timer sync until TIMA overflows
+        uint32_t GetCyclesUntilTimerOverflow(const CPU& cpu)
+        {
+            const PeripheralIO& pIO = cpu._peripheralIO;
+            if ((pIO.TAC & BIT_TIMA_ENABLED) == 0)
+            {
+                return UINT32_MAX;
+            }
+
+            uint32_t frequency = TIMA_FREQUENCIES[pIO.TAC & 0x03];
+            uint32_t SYSCLCK = *reinterpret_cast<const uint16_t*>(&pIO.SYSCLCK);
+
+            // Clock ticks up to the first TIMA increment, then one increment per period until it overflows
+            // The system clock moves on every 4th T-cycle
+            uint32_t clockTicks = (frequency - (SYSCLCK % frequency)) + (0xFF - pIO.TIMA) * frequency;
+            return clockTicks * 4 - (cpu._timer._syncCycle % 4);
+        }
+
+        // Nothing happens until TIMA overflows, unless the CPU accesses the timer registers
+        void TickTimer(CPU& cpu, uint32_t cycles)
+        {
+            cpu._tcycle += cycles;
+            if (cpu._tcycle - cpu._timer._syncCycle >= cpu._timer._overflowCycles)
+            {
+                SyncTimer(cpu);
+            }
+        }
+
+        uint8_t ReadPeripheralIO(void* context, uint16_t address)
+        {
+            CPU& cpu = *static_cast<CPU*>(context);
+            uint8_t reg = uint8_t(address % MMU_SEGMENT_SIZE);
+            if (reg >= IO_REG_TIMER_BEGIN && reg <= IO_REG_TIMER_END)
+            {
+                SyncTimer(cpu);
+            }
+
+            const IOSyncHandler& syncHandler = cpu._ioSyncHandlers[reg];
+            if (syncHandler._sync)
+            {
+                syncHandler._sync(syncHandler._context, address, false);
+            }
+
+            return reinterpret_cast<const uint8_t*>(&cpu._peripheralIO)[reg] | IO_REGISTER_MASKS._read[reg];
+        }
+
+        void StoreIORegister(CPU& cpu, uint8_t reg, uint8_t val)
+        {
+            uint8_t& value = reinterpret_cast<uint8_t*>(&cpu._peripheralIO)[reg];
+            uint8_t writeMask = IO_REGISTER_MASKS._write[reg];
+            value = (value & ~writeMask) | (val & writeMask);
+        }
+
+        void WriteTimerRegister(CPU& cpu, uint8_t reg, uint8_t val)
+        {
+            // Let the timer run up to the write with the old settings
+            SyncTimer(cpu);
+            StoreIORegister(cpu, reg, val);
+
+            // Any write to DIV resets the whole system clock
+            if (reg == IO_REG_DIV)
+            {
+                GetSystemClock(cpu._peripheralIO) = 0;
+            }
+
+            cpu._timer._overflowCycles = GetCyclesUntilTimerOverflow(cpu);
+        }
+
+        void WritePeripheralIO(void* context, MMU& mmu, uint16_t address, uint8_t val)
+        {
+            CPU& cpu = *static_cast<CPU*>(context);
+            uint8_t reg = uint8_t(address % MMU_SEGMENT_SIZE);
+
+            const IOSyncHandler& syncHandler = cpu._ioSyncHandlers[reg];
+            if (syncHandler._sync)
+            {
+                syncHandler._sync(syncHandler._context, address, true);
+            }
+
+            if (reg >= IO_REG_TIMER_BEGIN && reg <= IO_REG_TIMER_END)
+            {
+                WriteTimerRegister(cpu, reg, val);
+            }
+            else if (reg == IO_REG_BOOT_CTRL)
+            {
+                // Unmapping the boot ROM is one-way, the register is read-only from then on
+                if (cpu._peripheralIO.BOOT_CTRL == 0 && val != 0)
+                {
+                    cpu._peripheralIO.BOOT_CTRL = val;
+                    RemoveZeroSegmentRedirect(mmu);
+                }
+            }
+            else
+            {
+                StoreIORegister(cpu, reg, val);
+            }
+
+            const IOWriteHandler& handler = cpu._ioWriteHandlers[reg];
+            if (handler._write)
+            {
+                handler._write(handler._context, mmu, address, val);
+            }
+        }
     }
 
     void BootCPU(CPU& cpu, uint16_t initSP, uint16_t initPC, uint8_t initBootCtrl)
@@ -377,11 +548,16 @@ namespace emu::SM83
 
         // Set up decoder state
         cpu._decoder._nextMCycleIndex = 0;
+        cpu._decoder._stepMCycle = 0;
         cpu._decoder._tCycleState = T1_0;
         cpu._decoder._flags = 0;
         cpu._decoder._table = InstructionTable::Default;
+        cpu._decoder._currOp = nullptr;
 
         cpu._tcycle = 0;
+        cpu._stallCycles = 0;
+        cpu._timer._syncCycle = 0;
+        cpu._timer._overflowCycles = UINT32_MAX;
 
         // Load boot ROM
         cpu._peripheralIO.BOOT_CTRL = initBootCtrl;
@@ -391,7 +567,92 @@ namespace emu::SM83
     constexpr const uint16_t ADDR_PERIPHERAL_IO = 0xFF00; 
     void MapPeripheralIOMemory(CPU& cpu, MMU& mmu)
     {
-        MapMemoryRegion(mmu, ADDR_PERIPHERAL_IO, sizeof(PeripheralIO), reinterpret_cast<uint8_t*>(&cpu._peripheralIO), 0);
+        MMIOHandler handler;
+        handler._read = ReadPeripheralIO;
+        handler._write = WritePeripheralIO;
+        handler._context = &cpu;
+
+        MapMemoryRegion(mmu, ADDR_PERIPHERAL_IO, sizeof(PeripheralIO), reinterpret_cast<uint8_t*>(&cpu._peripheralIO), 0, &handler);
+
+        // Nothing happens on HRAM accesses, so they don't need to go through the handler
+        MapHRAM(mmu, cpu._peripheralIO.HRAM);
+
+        // The boot ROM covers $0000 - $00FF until it gets unmapped through BOOT_CTRL
+        if (!cpu._peripheralIO.BOOT_CTRL)
+        {
+            RedirectZeroSegment(mmu, cpu._bootROM);
+        }
+    }
+
+    void SetIOWriteHandler(CPU& cpu, uint16_t address, MMIOWriteFn handler, void* context)
+    {
+        EMU_ASSERT(address >= ADDR_PERIPHERAL_IO);
+
+        IOWriteHandler& ioHandler = cpu._ioWriteHandlers[address - ADDR_PERIPHERAL_IO];
+        ioHandler._write = handler;
+        ioHandler._context = context;
+    }
+
+    void SetIOSyncHandler(CPU& cpu, uint16_t address, IOSyncFn handler, void* context)
+    {
+        EMU_ASSERT(address >= ADDR_PERIPHERAL_IO);
+
+        IOSyncHandler& ioHandler = cpu._ioSyncHandlers[address - ADDR_PERIPHERAL_IO];
+        ioHandler._sync = handler;
+        ioHandler._context = context;
+    }
+
+    uint32_t GetCyclesUntilTimerInterrupt(const CPU& cpu)
+    {
+        if ((cpu._peripheralIO.IE & INT_BIT_TIMER) == 0 || cpu._timer._overflowCycles == UINT32_MAX)
+        {
+            return UINT32_MAX;
+        }
+
+        return cpu._timer._overflowCycles - (cpu._tcycle - cpu._timer._syncCycle);
+    }
+
+    void RecheckInterrupts(CPU& cpu)
+    {
+        EMU_ASSERT(IsAtInstructionBoundary(cpu));
+        if (cpu._decoder._table != InstructionTable::Interrupt)
+        {
+            CheckInterrupts(cpu._registers, cpu._decoder, cpu._peripheralIO);
+        }
+    }
+
+    void SyncTimer(CPU& cpu)
+    {
+        PeripheralIO& pIO = cpu._peripheralIO;
+        Timer& timer = cpu._timer;
+        uint16_t& SYSCLCK = GetSystemClock(pIO);
+
+        // The system clock moves on every 4th T-cycle
+        uint32_t elapsed = cpu._tcycle - timer._syncCycle;
+        uint32_t clockTicks = ((timer._syncCycle % 4) + elapsed) / 4;
+        timer._syncCycle = cpu._tcycle;
+
+        // TIMA moves on every time the system clock hits a multiple of the selected frequency
+        if ((pIO.TAC & BIT_TIMA_ENABLED) != 0)
+        {
+            uint32_t frequency = TIMA_FREQUENCIES[pIO.TAC & 0x03];
+            uint32_t increments = ((SYSCLCK % frequency) + clockTicks) / frequency;
+            uint32_t incrementsUntilOverflow = 0x100 - pIO.TIMA;
+            if (increments >= incrementsUntilOverflow)
+            {
+                // Reloaded from TMA on overflow, and counting on from there
+                increments -= incrementsUntilOverflow;
+                pIO.TIMA = uint8_t(pIO.TMA + increments % (0x100 - pIO.TMA));
+                pIO.IF |= INT_BIT_TIMER;
+            }
+            else
+            {
+                pIO.TIMA = uint8_t(pIO.TIMA + increments);
+            }
+        }
+
+        SYSCLCK = uint16_t(SYSCLCK + clockTicks);
+        timer._overflowCycles = GetCyclesUntilTimerOverflow(cpu);
     }
 
     void TickCPU(CPU& cpu, MMU& mmu, uint32_t cycles)
@@ -401,56 +662,25 @@ namespace emu::SM83
             return;
         }
 
+        // Nothing but the timer moves while DMA holds the CPU
+        if (cpu._stallCycles)
+        {
+            uint32_t stalledCycles = std::min(cpu._stallCycles, cycles);
+            cpu._stallCycles -= stalledCycles;
+            TickTimer(cpu, stalledCycles);
+            cycles -= stalledCycles;
+        }
+
         // Note: Overlapping execution! Last M-cycle of an instruction always overlaps with the fetch cycle for the next instruction
         // Documentation saying an instruction is only 1 cycle only indicates the "effective" cycles spent without overlap
         // The "execution" M-cycles (i.e. not M1) can overlap with the fetch of the next opcode
         for (uint32_t i = 0; i < cycles; ++i)
         {
-            // Redirect $0000 - $00FF to the boot rom if needed
-            uint8_t BOOT_CTRL = cpu._peripheralIO.BOOT_CTRL;
-            if (!BOOT_CTRL)
-            {
-                RedirectZeroSegment(mmu, cpu._bootROM);
-            }
-
             // Tick clock
-            uint16_t* SYSCLCK = reinterpret_cast<uint16_t*>(&cpu._peripheralIO.SYSCLCK);
-            cpu._tcycle++;
-            if ((cpu._tcycle % 4) == 0)
-            {
-                (*SYSCLCK)++;      
-
-                // Tick programmable timer
-                const uint8_t BIT_TIMA_ENABLED = (1 << 2);
-                if ((cpu._peripheralIO.TAC & BIT_TIMA_ENABLED) != 0)
-                {
-                    const uint16_t TIMA_FREQUENCIES[] =
-                    {
-                        256,
-                        4,
-                        16,
-                        64
-                    };
-
-                    uint16_t frequency = TIMA_FREQUENCIES[cpu._peripheralIO.TAC & 0x03];
-                    if (((*SYSCLCK) % frequency) == 0)
-                    {
-                        cpu._peripheralIO.TIMA++;
-                        if (cpu._peripheralIO.TIMA == 0)
-                        {
-                            cpu._peripheralIO.TIMA = cpu._peripheralIO.TMA;
-                            cpu._peripheralIO.IF |= INT_BIT_TIMER;
-                        }
-                    }
-                }
-            }
-
+            TickTimer(cpu, 1);
 
-            uint8_t DIV = cpu._peripheralIO.DIV;
-
-            // Two half ticks!
-            ProcessCurrentMCycle(cpu._io, cpu._registers, cpu._decoder, cpu._peripheralIO);
-            ProcessCurrentMCycle(cpu._io, cpu._registers, cpu._decoder, cpu._peripheralIO);
+            // Both half ticks at once
+            ProcessCurrentTCycle(cpu._io, cpu._registers, cpu._decoder, cpu._peripheralIO);
 
             // MMU interaction
             if (cpu._io._outPins.MRQ)
@@ -467,34 +697,63 @@ namespace emu::SM83
                     MMUWrite(mmu, cpu._io._address, cpu._io._data);
                 }
             }
+        }
+    }
 
-            // Handle timer reset on write
-            if (DIV != cpu._peripheralIO.DIV)
-            {
-                (*SYSCLCK) = 0;
-            }
+    uint32_t StepCPU(CPU& cpu, MMU& mmu)
+    {
+        EMU_ASSERT(IsAtInstructionBoundary(cpu));
 
-            // Handle boot control register change
-            if (BOOT_CTRL == 0 && cpu._peripheralIO.BOOT_CTRL != 0)
-            {
-                RemoveZeroSegmentRedirect(mmu);
-            }
+        // Time still passes while stopped, there just isn't anything to do
+        if (cpu._decoder._flags & Decoder::DF_ExecutionStopped)
+        {
+            return M_CYCLE_LENGTH;
+        }
 
-            // And make it read-only from this point onward
-            if (BOOT_CTRL != 0)
-            {
-                cpu._peripheralIO.BOOT_CTRL = BOOT_CTRL;
-            }
+        // Steps start at an instruction boundary, so a stall can be taken as a step of its own
+        if (cpu._stallCycles)
+        {
+            uint32_t cycles = cpu._stallCycles;
+            cpu._stallCycles = 0;
+            CompleteStep(cpu, cycles);
+            return cycles;
+        }
+
+        // A halted CPU idles one M-cycle at a time until an interrupt wakes it up
+        uint32_t cycles = (cpu._decoder._flags & Decoder::DF_ExecutionHalted) ?
+            M_CYCLE_LENGTH :
+            ExecuteInstruction(cpu._registers, cpu._decoder, mmu);
 
-            // Unused IO registers need to always be 0xFF
-            memset(cpu._peripheralIO.UNKNOWN0, 0xFF, sizeof(cpu._peripheralIO.UNKNOWN0));
-            memset(cpu._peripheralIO.UNKNOWN2, 0xFF, sizeof(cpu._peripheralIO.UNKNOWN2));
-            memset(cpu._peripheralIO.UNKNOWN3, 0xFF, sizeof(cpu._peripheralIO.UNKNOWN3));
-            memset(cpu._peripheralIO.UNKNOWN4, 0xFF, sizeof(cpu._peripheralIO.UNKNOWN4));
-            memset(cpu._peripheralIO.UNKNOWN5, 0xFF, sizeof(cpu._peripheralIO.UNKNOWN5));
+        CompleteStep(cpu, cycles);
+        return cycles;
+    }
 
-            // Joypad hack
-            cpu._peripheralIO.JOYP = 0xF;
+    uint32_t SkipHaltedCycles(CPU& cpu, uint32_t maxCycles)
+    {
+        if (!IsHalted(cpu) || !IsAtInstructionBoundary(cpu) || cpu._stallCycles || (cpu._peripheralIO.IE & cpu._peripheralIO.IF & 0x1F) != 0)
+        {
+            return 0;
         }
+
+        // Whole MCycles only, as the interrupt check happens at the end of each one
+        // The MCycle the timer overflows in still gets skipped, its interrupt check is the one at the very end
+        uint32_t timerCycles = GetCyclesUntilTimerInterrupt(cpu);
+        uint32_t timerMCycles = timerCycles / M_CYCLE_LENGTH + ((timerCycles % M_CYCLE_LENGTH) != 0);
+        uint32_t cycles = std::min(maxCycles / M_CYCLE_LENGTH, timerMCycles) * M_CYCLE_LENGTH;
+        if (cycles == 0)
+        {
+            return 0;
+        }
+
+        // Nothing but the timer moves while halted, so doing it all in one step is the same as going cycle by cycle
+        CompleteStep(cpu, cycles);
+        return cycles;
+    }
+
+    void CompleteStep(CPU& cpu, uint32_t cycles)
+    {
+        TickTimer(cpu, cycles);
+
+        CheckInterrupts(cpu._registers, cpu._decoder, cpu._peripheralIO);
     }
 }
\ No newline at end of file
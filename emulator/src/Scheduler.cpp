@@ -0,0 +1,16 @@
+#include "Scheduler.hpp"
+
+namespace emu::SM83
+{
+    void ResetScheduler(Scheduler& sched)
+    {
+        sched._currCycle = 0;
+        for (uint32_t i = 0; i < uint32_t(SchedulerEvent::Count); ++i)
+        {
+            sched._deadlines[i] = SCHEDULER_NEVER;
+            sched._syncCycles[i] = 0;
+        }
+
+        sched._nextDeadline = SCHEDULER_NEVER;
+    }
+}
@@ -0,0 +1,304 @@
+#include "TileDecode.hpp"
+
+#include <cstring>
+
+#if EMU_ARCH_X64
+    #include <immintrin.h>
+
+    #if EMU_COMPILER_MSVC
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+// MSVC lets any function use AVX2 intrinsics, Clang and GCC want them marked
+#if EMU_COMPILER_CLANG || EMU_COMPILER_GCC
+    #define EMU_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define EMU_TARGET_AVX2
+#endif
+
+namespace emu::SM83
+{
+    namespace
+    {
+        struct BitSpreadTable
+        {
+            uint64_t _bytes[256];
+        };
+
+        // Each bit of a bitplane byte moved into a byte of its own, leftmost pixel in the lowest byte unless flipped
+        constexpr BitSpreadTable BuildBitSpreadTable(bool xFlip)
+        {
+            BitSpreadTable table = {};
+            for (uint32_t value = 0; value < 256; ++value)
+            {
+                for (uint32_t i = 0; i < 8; ++i)
+                {
+                    uint32_t bit = xFlip ? i : 7 - i;
+                    table._bytes[value] |= uint64_t((value >> bit) & 0x01) << (i * 8);
+                }
+            }
+
+            return table;
+        }
+
+        constexpr const BitSpreadTable BIT_SPREAD = BuildBitSpreadTable(false);
+        constexpr const BitSpreadTable BIT_SPREAD_FLIPPED = BuildBitSpreadTable(true);
+
+        void DecodeTileRowsScalar(const uint8_t* rows, uint32_t rowCount, bool xFlip, uint8_t* indices)
+        {
+            const BitSpreadTable& spread = xFlip ? BIT_SPREAD_FLIPPED : BIT_SPREAD;
+            for (uint32_t row = 0; row < rowCount; ++row)
+            {
+                uint64_t rowIndices = spread._bytes[rows[row * 2 + 0]] | (spread._bytes[rows[row * 2 + 1]] << 1);
+                std::memcpy(indices + row * 8, &rowIndices, sizeof(rowIndices));
+            }
+        }
+
+        void ApplyPaletteScalar(const uint8_t* indices, uint32_t count, uint8_t palette, uint8_t* colors)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                colors[i] = (palette >> (indices[i] * 2)) & 0x03;
+            }
+        }
+
+#if EMU_ARCH_X64
+        // Pixel bit each byte lane tests, leftmost pixel is the top bit unless flipped
+        constexpr const int64_t PIXEL_BITS = 0x0102040810204080;
+        constexpr const int64_t PIXEL_BITS_FLIPPED = int64_t(0x8040201008040201);
+
+        // Colour indices come out as 0/1 for the low bitplane and 0/2 for the high one
+        __m128i DecodeBitplanesSSE2(__m128i low, __m128i high, __m128i pixelBits)
+        {
+            __m128i lowBits = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(low, pixelBits), pixelBits), _mm_set1_epi8(1));
+            __m128i highBits = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(high, pixelBits), pixelBits), _mm_set1_epi8(2));
+            return _mm_or_si128(lowBits, highBits);
+        }
+
+        // Two rows at a time, without byte shuffles each bitplane byte gets spread out by unpacking it with itself
+        void DecodeTileRowsSSE2(const uint8_t* rows, uint32_t rowCount, bool xFlip, uint8_t* indices)
+        {
+            const __m128i pixelBits = _mm_set1_epi64x(xFlip ? PIXEL_BITS_FLIPPED : PIXEL_BITS);
+
+            uint32_t row = 0;
+            for (; row + 2 <= rowCount; row += 2)
+            {
+                int32_t bitplanes = 0;
+                std::memcpy(&bitplanes, rows + row * 2, sizeof(bitplanes));
+
+                __m128i planes = _mm_cvtsi32_si128(bitplanes);      // L0 H0 L1 H1
+                planes = _mm_unpacklo_epi8(planes, planes);         // L0 L0 H0 H0 L1 L1 H1 H1
+                planes = _mm_unpacklo_epi16(planes, planes);        // L0 x4, H0 x4, L1 x4, H1 x4
+                __m128i row0 = _mm_unpacklo_epi32(planes, planes);  // L0 x8, H0 x8
+                __m128i row1 = _mm_unpackhi_epi32(planes, planes);  // L1 x8, H1 x8
+
+                __m128i low = _mm_unpacklo_epi64(row0, row1);
+                __m128i high = _mm_unpackhi_epi64(row0, row1);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + row * 8), DecodeBitplanesSSE2(low, high, pixelBits));
+            }
+
+            DecodeTileRowsScalar(rows + row * 2, rowCount - row, xFlip, indices + row * 8);
+        }
+
+        // No byte shuffles either, each colour gets picked by comparing against the index
+        void ApplyPaletteSSE2(const uint8_t* indices, uint32_t count, uint8_t palette, uint8_t* colors)
+        {
+            uint32_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+                __m128i color = _mm_setzero_si128();
+
+                for (uint8_t entry = 1; entry < 4; ++entry)
+                {
+                    __m128i isEntry = _mm_cmpeq_epi8(index, _mm_set1_epi8(char(entry)));
+                    color = _mm_or_si128(color, _mm_and_si128(isEntry, _mm_set1_epi8(char((palette >> (entry * 2)) & 0x03))));
+                }
+
+                __m128i isFirstEntry = _mm_cmpeq_epi8(index, _mm_setzero_si128());
+                color = _mm_or_si128(color, _mm_and_si128(isFirstEntry, _mm_set1_epi8(char(palette & 0x03))));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(colors + i), color);
+            }
+
+            ApplyPaletteScalar(indices + i, count - i, palette, colors + i);
+        }
+
+        // Four rows at a time, both halves get all four rows and pick their bitplane bytes with a shuffle
+        EMU_TARGET_AVX2 void DecodeTileRowsAVX2(const uint8_t* rows, uint32_t rowCount, bool xFlip, uint8_t* indices)
+        {
+            const __m256i pixelBits = _mm256_set1_epi64x(xFlip ? PIXEL_BITS_FLIPPED : PIXEL_BITS);
+            const __m256i lowBytes = _mm256_setr_epi64x(0x0000000000000000, 0x0202020202020202, 0x0404040404040404, 0x0606060606060606);
+            const __m256i highBytes = _mm256_add_epi8(lowBytes, _mm256_set1_epi8(1));
+
+            uint32_t row = 0;
+            for (; row + 4 <= rowCount; row += 4)
+            {
+                __m256i planes = _mm256_broadcastsi128_si256(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows + row * 2)));
+                __m256i low = _mm256_shuffle_epi8(planes, lowBytes);
+                __m256i high = _mm256_shuffle_epi8(planes, highBytes);
+
+                __m256i lowBits = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(low, pixelBits), pixelBits), _mm256_set1_epi8(1));
+                __m256i highBits = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(high, pixelBits), pixelBits), _mm256_set1_epi8(2));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + row * 8), _mm256_or_si256(lowBits, highBits));
+            }
+
+            // Clean upper halves first, the tail runs non-VEX code which would otherwise pay for the transition
+            _mm256_zeroupper();
+            DecodeTileRowsSSE2(rows + row * 2, rowCount - row, xFlip, indices + row * 8);
+        }
+
+        // The palette becomes a 4 entry lookup table for a byte shuffle
+        EMU_TARGET_AVX2 void ApplyPaletteAVX2(const uint8_t* indices, uint32_t count, uint8_t palette, uint8_t* colors)
+        {
+            int32_t table = 0;
+            for (uint32_t entry = 0; entry < 4; ++entry)
+            {
+                table |= ((palette >> (entry * 2)) & 0x03) << (entry * 8);
+            }
+
+            const __m256i lookup = _mm256_set1_epi32(table);
+
+            uint32_t i = 0;
+            for (; i + 32 <= count; i += 32)
+            {
+                __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(colors + i), _mm256_shuffle_epi8(lookup, index));
+            }
+
+            _mm256_zeroupper();
+            ApplyPaletteSSE2(indices + i, count - i, palette, colors + i);
+        }
+
+        void CPUID(int32_t info[4], int32_t leaf, int32_t subLeaf)
+        {
+#if EMU_COMPILER_MSVC
+            __cpuidex(info, leaf, subLeaf);
+#else
+            uint32_t regs[4] = {};
+            __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+            std::memcpy(info, regs, sizeof(regs));
+#endif
+        }
+
+        uint64_t ReadXCR0()
+        {
+#if EMU_COMPILER_MSVC
+            return _xgetbv(0);
+#else
+            uint32_t low = 0;
+            uint32_t high = 0;
+            __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+            return (uint64_t(high) << 32) | low;
+#endif
+        }
+
+        // The OS has to save the upper halves of the vector registers as well, or AVX can't be used
+        bool DetectAVX2()
+        {
+            int32_t info[4] = {};
+            CPUID(info, 0, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+
+            CPUID(info, 1, 0);
+            constexpr const int32_t OSXSAVE_BIT = 1 << 27;
+            constexpr const int32_t AVX_BIT = 1 << 28;
+            if ((info[2] & (OSXSAVE_BIT | AVX_BIT)) != (OSXSAVE_BIT | AVX_BIT) || (ReadXCR0() & 0x06) != 0x06)
+            {
+                return false;
+            }
+
+            CPUID(info, 7, 0);
+            constexpr const int32_t AVX2_BIT = 1 << 5;
+            return (info[1] & AVX2_BIT) != 0;
+        }
+#endif
+    }
+
+    bool IsTileDecodeKernelSupported(TileDecodeKernel kernel)
+    {
+        switch (kernel)
+        {
+        case TileDecodeKernel::Scalar:
+            return true;
+
+#if EMU_ARCH_X64
+        case TileDecodeKernel::SSE2:
+            return true;
+
+        case TileDecodeKernel::AVX2:
+        {
+            static const bool hasAVX2 = DetectAVX2();
+            return hasAVX2;
+        }
+#endif
+
+        default:
+            return false;
+        }
+    }
+
+    TileDecodeKernel GetTileDecodeKernel()
+    {
+        if (IsTileDecodeKernelSupported(TileDecodeKernel::AVX2))
+        {
+            return TileDecodeKernel::AVX2;
+        }
+
+        if (IsTileDecodeKernelSupported(TileDecodeKernel::SSE2))
+        {
+            return TileDecodeKernel::SSE2;
+        }
+
+        return TileDecodeKernel::Scalar;
+    }
+
+    void DecodeTileRows(TileDecodeKernel kernel, const uint8_t* rows, uint32_t rowCount, bool xFlip, uint8_t* indices)
+    {
+        EMU_ASSERT(IsTileDecodeKernelSupported(kernel));
+
+        switch (kernel)
+        {
+#if EMU_ARCH_X64
+        case TileDecodeKernel::SSE2:
+            DecodeTileRowsSSE2(rows, rowCount, xFlip, indices);
+            break;
+
+        case TileDecodeKernel::AVX2:
+            DecodeTileRowsAVX2(rows, rowCount, xFlip, indices);
+            break;
+#endif
+
+        default:
+            DecodeTileRowsScalar(rows, rowCount, xFlip, indices);
+            break;
+        }
+    }
+
+    void ApplyPalette(TileDecodeKernel kernel, const uint8_t* indices, uint32_t count, uint8_t palette, uint8_t* colors)
+    {
+        EMU_ASSERT(IsTileDecodeKernelSupported(kernel));
+
+        switch (kernel)
+        {
+#if EMU_ARCH_X64
+        case TileDecodeKernel::SSE2:
+            ApplyPaletteSSE2(indices, count, palette, colors);
+            break;
+
+        case TileDecodeKernel::AVX2:
+            ApplyPaletteAVX2(indices, count, palette, colors);
+            break;
+#endif
+
+        default:
+            ApplyPaletteScalar(indices, count, palette, colors);
+            break;
+        }
+    }
+}
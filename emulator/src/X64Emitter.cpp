@@ -0,0 +1,368 @@
+#include "X64Emitter.hpp"
+
+namespace emu::SM83
+{
+    namespace
+    {
+        uint8_t RegBits(X64Reg reg)
+        {
+            return uint8_t(reg) & 0x07;
+        }
+
+        bool IsExtended(X64Reg reg)
+        {
+            return uint8_t(reg) >= 8;
+        }
+
+        // REX prefix, only emitted if any of its bits are needed
+        void EmitRex(X64Emitter& e, bool w, X64Reg reg, X64Reg index, X64Reg base)
+        {
+            uint8_t rex = 0x40 |
+                (w ? 0x08 : 0) |
+                (IsExtended(reg) ? 0x04 : 0) |
+                (IsExtended(index) ? 0x02 : 0) |
+                (IsExtended(base) ? 0x01 : 0);
+
+            if (rex != 0x40)
+            {
+                X64Emit8(e, rex);
+            }
+        }
+
+        void EmitModRMReg(X64Emitter& e, uint8_t regField, X64Reg rm)
+        {
+            X64Emit8(e, 0xC0 | ((regField & 0x07) << 3) | RegBits(rm));
+        }
+
+        // [base + disp8], base can't be one that needs a SIB byte
+        void EmitModRMDisp8(X64Emitter& e, uint8_t regField, X64Reg base, int8_t disp)
+        {
+            EMU_ASSERT(RegBits(base) != RegBits(X64Reg::RSP));
+            X64Emit8(e, 0x40 | ((regField & 0x07) << 3) | RegBits(base));
+            X64Emit8(e, uint8_t(disp));
+        }
+
+        // [base + disp32], same restriction on the base
+        void EmitModRMDisp32(X64Emitter& e, uint8_t regField, X64Reg base, int32_t disp)
+        {
+            EMU_ASSERT(RegBits(base) != RegBits(X64Reg::RSP));
+            X64Emit8(e, 0x80 | ((regField & 0x07) << 3) | RegBits(base));
+            X64Emit32(e, uint32_t(disp));
+        }
+
+        // Byte registers past BL would need a REX prefix to not turn into AH - BH
+        void Check8BitReg(X64Reg reg)
+        {
+            EMU_ASSERT(uint8_t(reg) < 4);
+        }
+    }
+
+    void X64Emit8(X64Emitter& e, uint8_t value)
+    {
+        if (e._size >= e._capacity)
+        {
+            e._overflow = true;
+            return;
+        }
+
+        e._code[e._size++] = value;
+    }
+
+    void X64Emit16(X64Emitter& e, uint16_t value)
+    {
+        X64Emit8(e, uint8_t(value));
+        X64Emit8(e, uint8_t(value >> 8));
+    }
+
+    void X64Emit32(X64Emitter& e, uint32_t value)
+    {
+        X64Emit16(e, uint16_t(value));
+        X64Emit16(e, uint16_t(value >> 16));
+    }
+
+    void X64Emit64(X64Emitter& e, uint64_t value)
+    {
+        X64Emit32(e, uint32_t(value));
+        X64Emit32(e, uint32_t(value >> 32));
+    }
+
+    void X64Push(X64Emitter& e, X64Reg reg)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, reg);
+        X64Emit8(e, 0x50 + RegBits(reg));
+    }
+
+    void X64Pop(X64Emitter& e, X64Reg reg)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, reg);
+        X64Emit8(e, 0x58 + RegBits(reg));
+    }
+
+    void X64Ret(X64Emitter& e)
+    {
+        X64Emit8(e, 0xC3);
+    }
+
+    void X64CallReg(X64Emitter& e, X64Reg reg)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, reg);
+        X64Emit8(e, 0xFF);
+        EmitModRMReg(e, 2, reg);
+    }
+
+    void X64MovReg64Reg64(X64Emitter& e, X64Reg dst, X64Reg src)
+    {
+        EmitRex(e, true, src, X64Reg::RAX, dst);
+        X64Emit8(e, 0x89);
+        EmitModRMReg(e, RegBits(src), dst);
+    }
+
+    void X64MovReg64Imm64(X64Emitter& e, X64Reg dst, uint64_t imm)
+    {
+        EmitRex(e, true, X64Reg::RAX, X64Reg::RAX, dst);
+        X64Emit8(e, 0xB8 + RegBits(dst));
+        X64Emit64(e, imm);
+    }
+
+    void X64ALUReg64Imm8(X64Emitter& e, X64ALUOp op, X64Reg dst, int8_t imm)
+    {
+        EmitRex(e, true, X64Reg::RAX, X64Reg::RAX, dst);
+        X64Emit8(e, 0x83);
+        EmitModRMReg(e, uint8_t(op), dst);
+        X64Emit8(e, uint8_t(imm));
+    }
+
+    void X64TestReg64Reg64(X64Emitter& e, X64Reg a, X64Reg b)
+    {
+        EmitRex(e, true, b, X64Reg::RAX, a);
+        X64Emit8(e, 0x85);
+        EmitModRMReg(e, RegBits(b), a);
+    }
+
+    void X64Load64(X64Emitter& e, X64Reg dst, X64Reg base, int32_t disp)
+    {
+        EmitRex(e, true, dst, X64Reg::RAX, base);
+        X64Emit8(e, 0x8B);
+        EmitModRMDisp32(e, RegBits(dst), base, disp);
+    }
+
+    void X64MovReg32Reg32(X64Emitter& e, X64Reg dst, X64Reg src)
+    {
+        EmitRex(e, false, src, X64Reg::RAX, dst);
+        X64Emit8(e, 0x89);
+        EmitModRMReg(e, RegBits(src), dst);
+    }
+
+    void X64MovReg32Imm32(X64Emitter& e, X64Reg dst, uint32_t imm)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, dst);
+        X64Emit8(e, 0xB8 + RegBits(dst));
+        X64Emit32(e, imm);
+    }
+
+    void X64ALUReg32Reg32(X64Emitter& e, X64ALUOp op, X64Reg dst, X64Reg src)
+    {
+        EmitRex(e, false, src, X64Reg::RAX, dst);
+        X64Emit8(e, uint8_t(uint8_t(op) << 3) | 0x01);
+        EmitModRMReg(e, RegBits(src), dst);
+    }
+
+    void X64ALUReg32Imm32(X64Emitter& e, X64ALUOp op, X64Reg dst, uint32_t imm)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, dst);
+        X64Emit8(e, 0x81);
+        EmitModRMReg(e, uint8_t(op), dst);
+        X64Emit32(e, imm);
+    }
+
+    void X64TestReg32Reg32(X64Emitter& e, X64Reg a, X64Reg b)
+    {
+        EmitRex(e, false, b, X64Reg::RAX, a);
+        X64Emit8(e, 0x85);
+        EmitModRMReg(e, RegBits(b), a);
+    }
+
+    void X64BtReg32Imm8(X64Emitter& e, X64Reg reg, uint8_t bit)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, reg);
+        X64Emit8(e, 0x0F);
+        X64Emit8(e, 0xBA);
+        EmitModRMReg(e, 4, reg);
+        X64Emit8(e, bit);
+    }
+
+    void X64ALUReg8Reg8(X64Emitter& e, X64ALUOp op, X64Reg dst, X64Reg src)
+    {
+        Check8BitReg(dst);
+        Check8BitReg(src);
+        X64Emit8(e, uint8_t(uint8_t(op) << 3));
+        EmitModRMReg(e, RegBits(src), dst);
+    }
+
+    void X64ALUReg8Imm8(X64Emitter& e, X64ALUOp op, X64Reg dst, uint8_t imm)
+    {
+        Check8BitReg(dst);
+        X64Emit8(e, 0x80);
+        EmitModRMReg(e, uint8_t(op), dst);
+        X64Emit8(e, imm);
+    }
+
+    void X64IncReg8(X64Emitter& e, X64Reg reg)
+    {
+        Check8BitReg(reg);
+        X64Emit8(e, 0xFE);
+        EmitModRMReg(e, 0, reg);
+    }
+
+    void X64DecReg8(X64Emitter& e, X64Reg reg)
+    {
+        Check8BitReg(reg);
+        X64Emit8(e, 0xFE);
+        EmitModRMReg(e, 1, reg);
+    }
+
+    void X64Lahf(X64Emitter& e)
+    {
+        X64Emit8(e, 0x9F);
+    }
+
+    void X64MovzxReg32AH(X64Emitter& e, X64Reg dst)
+    {
+        // AH is only addressable without a REX prefix
+        EMU_ASSERT(!IsExtended(dst));
+        X64Emit8(e, 0x0F);
+        X64Emit8(e, 0xB6);
+        X64Emit8(e, 0xC0 | (RegBits(dst) << 3) | 0x04);
+    }
+
+    void X64Load8(X64Emitter& e, X64Reg dst, X64Reg base, int8_t disp)
+    {
+        Check8BitReg(dst);
+        EmitRex(e, false, dst, X64Reg::RAX, base);
+        X64Emit8(e, 0x8A);
+        EmitModRMDisp8(e, RegBits(dst), base, disp);
+    }
+
+    void X64Store8(X64Emitter& e, X64Reg base, int8_t disp, X64Reg src)
+    {
+        Check8BitReg(src);
+        EmitRex(e, false, src, X64Reg::RAX, base);
+        X64Emit8(e, 0x88);
+        EmitModRMDisp8(e, RegBits(src), base, disp);
+    }
+
+    void X64Store8Imm(X64Emitter& e, X64Reg base, int8_t disp, uint8_t imm)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, base);
+        X64Emit8(e, 0xC6);
+        EmitModRMDisp8(e, 0, base, disp);
+        X64Emit8(e, imm);
+    }
+
+    void X64Load16Zx(X64Emitter& e, X64Reg dst, X64Reg base, int8_t disp)
+    {
+        EmitRex(e, false, dst, X64Reg::RAX, base);
+        X64Emit8(e, 0x0F);
+        X64Emit8(e, 0xB7);
+        EmitModRMDisp8(e, RegBits(dst), base, disp);
+    }
+
+    void X64Store16(X64Emitter& e, X64Reg base, int8_t disp, X64Reg src)
+    {
+        X64Emit8(e, 0x66);
+        EmitRex(e, false, src, X64Reg::RAX, base);
+        X64Emit8(e, 0x89);
+        EmitModRMDisp8(e, RegBits(src), base, disp);
+    }
+
+    void X64Store16Imm(X64Emitter& e, X64Reg base, int8_t disp, uint16_t imm)
+    {
+        X64Emit8(e, 0x66);
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, base);
+        X64Emit8(e, 0xC7);
+        EmitModRMDisp8(e, 0, base, disp);
+        X64Emit16(e, imm);
+    }
+
+    void X64Inc16(X64Emitter& e, X64Reg base, int8_t disp)
+    {
+        X64Emit8(e, 0x66);
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, base);
+        X64Emit8(e, 0xFF);
+        EmitModRMDisp8(e, 0, base, disp);
+    }
+
+    void X64Dec16(X64Emitter& e, X64Reg base, int8_t disp)
+    {
+        X64Emit8(e, 0x66);
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, base);
+        X64Emit8(e, 0xFF);
+        EmitModRMDisp8(e, 1, base, disp);
+    }
+
+    void X64ALU8Imm(X64Emitter& e, X64ALUOp op, X64Reg base, int8_t disp, uint8_t imm)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, base);
+        X64Emit8(e, 0x80);
+        EmitModRMDisp8(e, uint8_t(op), base, disp);
+        X64Emit8(e, imm);
+    }
+
+    void X64Test8Imm(X64Emitter& e, X64Reg base, int8_t disp, uint8_t imm)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, base);
+        X64Emit8(e, 0xF6);
+        EmitModRMDisp8(e, 0, base, disp);
+        X64Emit8(e, imm);
+    }
+
+    void X64Not8(X64Emitter& e, X64Reg base, int8_t disp)
+    {
+        EmitRex(e, false, X64Reg::RAX, X64Reg::RAX, base);
+        X64Emit8(e, 0xF6);
+        EmitModRMDisp8(e, 2, base, disp);
+    }
+
+    void X64LoadIndexed8Zx(X64Emitter& e, X64Reg dst, X64Reg base, X64Reg index)
+    {
+        EMU_ASSERT(RegBits(index) != RegBits(X64Reg::RSP));
+        EmitRex(e, false, dst, index, base);
+        X64Emit8(e, 0x0F);
+        X64Emit8(e, 0xB6);
+
+        // RBP and R13 as a base can only be encoded with a displacement
+        bool needsDisp = RegBits(base) == RegBits(X64Reg::RBP);
+        X64Emit8(e, (needsDisp ? 0x40 : 0x00) | (RegBits(dst) << 3) | 0x04);
+        X64Emit8(e, (RegBits(index) << 3) | RegBits(base));
+        if (needsDisp)
+        {
+            X64Emit8(e, 0);
+        }
+    }
+
+    uint32_t X64JccRel8(X64Emitter& e, X64Cond cond)
+    {
+        X64Emit8(e, 0x70 | uint8_t(cond));
+        X64Emit8(e, 0);
+        return e._size - 1;
+    }
+
+    uint32_t X64JmpRel8(X64Emitter& e)
+    {
+        X64Emit8(e, 0xEB);
+        X64Emit8(e, 0);
+        return e._size - 1;
+    }
+
+    void X64PatchRel8(X64Emitter& e, uint32_t patchOffset)
+    {
+        if (e._overflow)
+        {
+            return;
+        }
+
+        int32_t rel = int32_t(e._size) - int32_t(patchOffset + 1);
+        EMU_ASSERT(rel >= -128 && rel <= 127);
+        e._code[patchOffset] = uint8_t(int8_t(rel));
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace emu::SM83
+{
+    // Minimal x86-64 encoder for the JIT, only covers the instruction forms it actually emits
+    // 8 bit operands are limited to AL, CL, DL and BL so that no REX prefix is ever needed for them
+    enum class X64Reg : uint8_t
+    {
+        RAX = 0,
+        RCX,
+        RDX,
+        RBX,
+        RSP,
+        RBP,
+        RSI,
+        RDI,
+        R8,
+        R9,
+        R10,
+        R11,
+        R12,
+        R13,
+        R14,
+        R15
+    };
+
+    // In the order of their /digit encoding
+    enum class X64ALUOp : uint8_t
+    {
+        Add = 0,
+        Or,
+        Adc,
+        Sbb,
+        And,
+        Sub,
+        Xor,
+        Cmp
+    };
+
+    enum class X64Cond : uint8_t
+    {
+        B = 0x02,       // Unsigned below
+        Z = 0x04,
+        NZ = 0x05,
+    };
+
+    struct X64Emitter
+    {
+        uint8_t* _code;
+        uint32_t _size;
+        uint32_t _capacity;
+        bool _overflow;         // Ran out of space, nothing emitted past that point is valid
+    };
+
+    void X64Emit8(X64Emitter& e, uint8_t value);
+    void X64Emit16(X64Emitter& e, uint16_t value);
+    void X64Emit32(X64Emitter& e, uint32_t value);
+    void X64Emit64(X64Emitter& e, uint64_t value);
+
+    void X64Push(X64Emitter& e, X64Reg reg);
+    void X64Pop(X64Emitter& e, X64Reg reg);
+    void X64Ret(X64Emitter& e);
+    void X64CallReg(X64Emitter& e, X64Reg reg);
+
+    // 64 bit register operations
+    void X64MovReg64Reg64(X64Emitter& e, X64Reg dst, X64Reg src);
+    void X64MovReg64Imm64(X64Emitter& e, X64Reg dst, uint64_t imm);
+    void X64ALUReg64Imm8(X64Emitter& e, X64ALUOp op, X64Reg dst, int8_t imm);
+    void X64TestReg64Reg64(X64Emitter& e, X64Reg a, X64Reg b);
+
+    // [base + disp32], for pointers further into a struct than disp8 reaches
+    void X64Load64(X64Emitter& e, X64Reg dst, X64Reg base, int32_t disp);
+
+    // 32 bit register operations
+    void X64MovReg32Reg32(X64Emitter& e, X64Reg dst, X64Reg src);
+    void X64MovReg32Imm32(X64Emitter& e, X64Reg dst, uint32_t imm);
+    void X64ALUReg32Reg32(X64Emitter& e, X64ALUOp op, X64Reg dst, X64Reg src);
+    void X64ALUReg32Imm32(X64Emitter& e, X64ALUOp op, X64Reg dst, uint32_t imm);
+    void X64TestReg32Reg32(X64Emitter& e, X64Reg a, X64Reg b);
+    void X64BtReg32Imm8(X64Emitter& e, X64Reg reg, uint8_t bit);
+
+    // 8 bit register operations
+    void X64ALUReg8Reg8(X64Emitter& e, X64ALUOp op, X64Reg dst, X64Reg src);
+    void X64ALUReg8Imm8(X64Emitter& e, X64ALUOp op, X64Reg dst, uint8_t imm);
+    void X64IncReg8(X64Emitter& e, X64Reg reg);
+    void X64DecReg8(X64Emitter& e, X64Reg reg);
+
+    // Flags into AH, and AH zero extended into a 32 bit register
+    void X64Lahf(X64Emitter& e);
+    void X64MovzxReg32AH(X64Emitter& e, X64Reg dst);
+
+    // [base + disp8] memory operands
+    void X64Load8(X64Emitter& e, X64Reg dst, X64Reg base, int8_t disp);
+    void X64Store8(X64Emitter& e, X64Reg base, int8_t disp, X64Reg src);
+    void X64Store8Imm(X64Emitter& e, X64Reg base, int8_t disp, uint8_t imm);
+    void X64Load16Zx(X64Emitter& e, X64Reg dst, X64Reg base, int8_t disp);
+    void X64Store16(X64Emitter& e, X64Reg base, int8_t disp, X64Reg src);
+    void X64Store16Imm(X64Emitter& e, X64Reg base, int8_t disp, uint16_t imm);
+    void X64Inc16(X64Emitter& e, X64Reg base, int8_t disp);
+    void X64Dec16(X64Emitter& e, X64Reg base, int8_t disp);
+    void X64ALU8Imm(X64Emitter& e, X64ALUOp op, X64Reg base, int8_t disp, uint8_t imm);
+    void X64Test8Imm(X64Emitter& e, X64Reg base, int8_t disp, uint8_t imm);
+    void X64Not8(X64Emitter& e, X64Reg base, int8_t disp);
+
+    // [base + index] byte load, zero extended into a 32 bit register
+    void X64LoadIndexed8Zx(X64Emitter& e, X64Reg dst, X64Reg base, X64Reg index);
+
+    // Short forward jumps, returns where the offset has to be patched once the target is known
+    uint32_t X64JccRel8(X64Emitter& e, X64Cond cond);
+    uint32_t X64JmpRel8(X64Emitter& e);
+    void X64PatchRel8(X64Emitter& e, uint32_t patchOffset);
+}
@@ -0,0 +1,35 @@
+project "gbrun"
+
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    flags { "FatalWarnings", "MultiProcessorCompile" }
+
+    files {
+        "src/**.h",
+        "src/**.hpp",
+        "src/**.cpp",
+        "src/**.c"
+    }
+
+    includedirs {
+        "../emulator/include"
+    }
+
+    libdirs {
+        "%{wks.location}/%{cfg.buildcfg}"
+    }
+
+    targetdir "%{wks.location}/%{cfg.buildcfg}/"
+
+    links { "emulator" }
+
+    -- Plain fopen keeps it portable
+    filter "toolset:msc*"
+        defines { "_CRT_SECURE_NO_WARNINGS" }
+    filter {}
+
+    -- The batch runner's worker threads
+    filter "system:linux"
+        links { "pthread" }
+    filter {}
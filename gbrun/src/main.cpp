@@ -0,0 +1,364 @@
+#include "BatchRunner.hpp"
+#include "GameBoy.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr const double FRAMES_PER_SECOND = 4194304.0 / emu::SM83::CYCLES_PER_FRAME;
+    constexpr const uint64_t DEFAULT_FRAME_COUNT = 600;
+
+    struct Options
+    {
+        const char* _romPath = nullptr;
+        uint64_t _cycles = DEFAULT_FRAME_COUNT * emu::SM83::CYCLES_PER_FRAME;
+        emu::SM83::ExecutionMode _mode = emu::SM83::ExecutionMode::CycleAccurate;
+        bool _jit = false;
+        uint32_t _frameSkip = 0;
+        const char* _framePrefix = nullptr;     // Every rendered frame gets written to <prefix>_<frame>.pgm
+        const char* _finalPath = nullptr;
+        bool _printHash = false;
+        uint32_t _instances = 1;
+        uint32_t _threads = 0;                  // One per hardware thread
+    };
+
+    // What the frame hook needs to dump frames
+    struct OutputContext
+    {
+        const emu::SM83::GameBoy* _gb = nullptr;
+
+        // Shade per pixel, as the PPU leaves it at the end of every rendered frame
+        uint8_t _framebuffer[emu::SM83::SCREEN_WIDTH * emu::SM83::SCREEN_HEIGHT] = {};
+        const char* _framePrefix = nullptr;
+        uint64_t _frameCount = 0;
+        bool _dumpFailed = false;
+    };
+
+    // Binary greymap, about the simplest image format there is and one most tools can open
+    bool WritePGM(const char* path, const uint8_t* shades)
+    {
+        FILE* file = std::fopen(path, "wb");
+        if (!file)
+        {
+            return false;
+        }
+
+        std::fprintf(file, "P5\n%u %u\n255\n", emu::SM83::SCREEN_WIDTH, emu::SM83::SCREEN_HEIGHT);
+
+        uint8_t row[emu::SM83::SCREEN_WIDTH] = {};
+        bool written = true;
+        for (uint32_t y = 0; y < emu::SM83::SCREEN_HEIGHT; ++y)
+        {
+            for (uint32_t x = 0; x < emu::SM83::SCREEN_WIDTH; ++x)
+            {
+                row[x] = uint8_t(255 - shades[y * emu::SM83::SCREEN_WIDTH + x] * 85);
+            }
+
+            written &= std::fwrite(row, 1, sizeof(row), file) == sizeof(row);
+        }
+
+        return (std::fclose(file) == 0) && written;
+    }
+
+    // FNV-1a, enough to tell whether two runs ended up with the same picture
+    uint64_t HashFramebuffer(const uint8_t* shades)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (uint32_t i = 0; i < emu::SM83::SCREEN_WIDTH * emu::SM83::SCREEN_HEIGHT; ++i)
+        {
+            hash = (hash ^ shades[i]) * 0x100000001B3ull;
+        }
+
+        return hash;
+    }
+
+    // Each instance of a batch run draws to its own framebuffer
+    struct InstanceOutput
+    {
+        uint8_t _framebuffer[emu::SM83::SCREEN_WIDTH * emu::SM83::SCREEN_HEIGHT] = {};
+        uint32_t _frameSkip = 0;
+        uint64_t _hash = 0;
+    };
+
+    // Runs at the start of VBlank, when a rendered frame is complete
+    void EndFrame(void* userData)
+    {
+        OutputContext& ctxt = *static_cast<OutputContext*>(userData);
+        if (ctxt._framePrefix && ctxt._gb->_ppu._renderFrame && !ctxt._dumpFailed)
+        {
+            char path[1024] = {};
+            std::snprintf(path, sizeof(path), "%s_%05llu.pgm", ctxt._framePrefix, (unsigned long long)ctxt._frameCount);
+            if (!WritePGM(path, ctxt._framebuffer))
+            {
+                std::fprintf(stderr, "Could not write %s, no more frames will be dumped\n", path);
+                ctxt._dumpFailed = true;
+            }
+        }
+
+        ctxt._frameCount++;
+    }
+
+    bool LoadFile(const char* path, std::vector<uint8_t>& contents)
+    {
+        FILE* file = std::fopen(path, "rb");
+        if (!file)
+        {
+            return false;
+        }
+
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+
+        contents.resize(size > 0 ? size_t(size) : 0);
+        bool read = std::fread(contents.data(), 1, contents.size(), file) == contents.size();
+        std::fclose(file);
+
+        return read && !contents.empty();
+    }
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "usage: gbrun <rom> [options]\n"
+            "  --frames <n>         Run for n frames worth of cycles (default %llu)\n"
+            "  --cycles <n>         Run for n cycles instead\n"
+            "  --fast               Step whole instructions instead of single cycles\n"
+            "  --jit                Same as --fast, with ROM code translated to x86-64 where possible\n"
+            "  --frame-skip <n>     Only render one frame out of every n + 1\n"
+            "  --dump-frames <p>    Write every rendered frame to <p>_<frame>.pgm\n"
+            "  --dump-final <file>  Write the last rendered frame to file as a PGM\n"
+            "  --hash               Print a hash of the last rendered frame\n"
+            "  --instances <n>      Run n copies of the ROM at once, spread over all cores\n"
+            "  --threads <n>        Worker threads for --instances, one per core by default\n",
+            (unsigned long long)DEFAULT_FRAME_COUNT);
+    }
+
+    bool ParseCount(const char* arg, uint64_t& count)
+    {
+        char* end = nullptr;
+        count = std::strtoull(arg, &end, 10);
+        return end != arg && *end == '\0';
+    }
+
+    bool ParseOptions(int argc, char* argv[], Options& options)
+    {
+        if (argc < 2)
+        {
+            return false;
+        }
+
+        options._romPath = argv[1];
+        for (int i = 2; i < argc; ++i)
+        {
+            const char* arg = argv[i];
+            const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+            uint64_t count = 0;
+
+            if (std::strcmp(arg, "--fast") == 0)
+            {
+                options._mode = emu::SM83::ExecutionMode::Instruction;
+            }
+            else if (std::strcmp(arg, "--jit") == 0)
+            {
+                options._jit = true;
+            }
+            else if (std::strcmp(arg, "--hash") == 0)
+            {
+                options._printHash = true;
+            }
+            else if (!value)
+            {
+                std::fprintf(stderr, "Unknown option or missing value: %s\n", arg);
+                return false;
+            }
+            else if (std::strcmp(arg, "--dump-frames") == 0)
+            {
+                options._framePrefix = value;
+                ++i;
+            }
+            else if (std::strcmp(arg, "--dump-final") == 0)
+            {
+                options._finalPath = value;
+                ++i;
+            }
+            else if (!ParseCount(value, count))
+            {
+                std::fprintf(stderr, "Expected a number after %s, got %s\n", arg, value);
+                return false;
+            }
+            else if (std::strcmp(arg, "--frames") == 0)
+            {
+                options._cycles = count * emu::SM83::CYCLES_PER_FRAME;
+                ++i;
+            }
+            else if (std::strcmp(arg, "--cycles") == 0)
+            {
+                options._cycles = count;
+                ++i;
+            }
+            else if (std::strcmp(arg, "--frame-skip") == 0 && count < UINT32_MAX)
+            {
+                options._frameSkip = uint32_t(count);
+                ++i;
+            }
+            else if (std::strcmp(arg, "--instances") == 0 && count > 0 && count <= UINT32_MAX)
+            {
+                options._instances = uint32_t(count);
+                ++i;
+            }
+            else if (std::strcmp(arg, "--threads") == 0 && count <= UINT32_MAX)
+            {
+                options._threads = uint32_t(count);
+                ++i;
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown option: %s\n", arg);
+                return false;
+            }
+        }
+
+        // Frames from several instances would all end up in the same files
+        if (options._instances > 1 && (options._framePrefix || options._finalPath))
+        {
+            std::fprintf(stderr, "--dump-frames and --dump-final only work with a single instance\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    void BootInstance(void* userData, emu::SM83::GameBoy& gb)
+    {
+        InstanceOutput& output = *static_cast<InstanceOutput*>(userData);
+        emu::SM83::SetPPUFramebuffer(gb._ppu, { ._pixels = output._framebuffer, ._pitch = emu::SM83::SCREEN_WIDTH });
+        emu::SM83::SetPPUFrameSkip(gb._ppu, output._frameSkip);
+    }
+
+    void FinishInstance(void* userData, emu::SM83::GameBoy&)
+    {
+        InstanceOutput& output = *static_cast<InstanceOutput*>(userData);
+        output._hash = HashFramebuffer(output._framebuffer);
+    }
+
+    // All instances run the same ROM for the same number of cycles, only the throughput over all of them matters
+    int RunInstances(const Options& options, emu::SM83::ExecutionMode mode, std::vector<uint8_t>& rom)
+    {
+        std::vector<InstanceOutput> outputs(options._instances);
+        std::vector<emu::SM83::BatchJob> jobs(options._instances);
+        for (uint32_t i = 0; i < options._instances; ++i)
+        {
+            outputs[i]._frameSkip = options._frameSkip;
+
+            emu::SM83::BatchJob& job = jobs[i];
+            job._rom = rom.data();
+            job._romSize = uint32_t(rom.size());
+            job._mode = mode;
+            job._cycles = options._cycles;
+            job._onBoot = BootInstance;
+            job._onFinish = FinishInstance;
+            job._userData = &outputs[i];
+        }
+
+        emu::SM83::BatchStats stats = emu::SM83::RunBatch(jobs.data(), uint32_t(jobs.size()), options._threads);
+        if (!jobs[0]._booted)
+        {
+            std::fprintf(stderr, "%s is not a ROM this emulator can run\n", options._romPath);
+            return 1;
+        }
+
+        double frames = double(stats._cycles) / emu::SM83::CYCLES_PER_FRAME;
+        double framesPerSecond = stats._seconds > 0.0 ? frames / stats._seconds : 0.0;
+        std::printf("%u instances on %u threads (%u steals): %.1f frames (%llu cycles) in %.3f s, %.1f frames/s, %.1fx real time\n",
+            options._instances, stats._workerCount, stats._steals, frames, (unsigned long long)stats._cycles, stats._seconds,
+            framesPerSecond, framesPerSecond / FRAMES_PER_SECOND);
+
+        if (options._printHash)
+        {
+            for (uint32_t i = 0; i < options._instances; ++i)
+            {
+                std::printf("hash %u %016llx\n", i, (unsigned long long)outputs[i]._hash);
+            }
+        }
+
+        return 0;
+    }
+}
+
+// Runs a ROM without any window or audio, as fast as it goes, and reports how fast that was
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<uint8_t> rom;
+    if (!LoadFile(options._romPath, rom))
+    {
+        std::fprintf(stderr, "Could not read %s\n", options._romPath);
+        return 1;
+    }
+
+    emu::SM83::ExecutionMode mode = options._jit ? emu::SM83::ExecutionMode::Compiled : options._mode;
+    if (options._instances > 1)
+    {
+        return RunInstances(options, mode, rom);
+    }
+
+    std::unique_ptr<emu::SM83::GameBoy> gb = std::make_unique<emu::SM83::GameBoy>();
+    if (!emu::SM83::BootGameBoy(*gb, rom.data(), uint32_t(rom.size()), mode))
+    {
+        std::fprintf(stderr, "%s is not a ROM this emulator can run\n", options._romPath);
+        return 1;
+    }
+
+    std::unique_ptr<OutputContext> output = std::make_unique<OutputContext>();
+    output->_gb = gb.get();
+    output->_framePrefix = options._framePrefix;
+
+    emu::SM83::SetPPUFramebuffer(gb->_ppu, { ._pixels = output->_framebuffer, ._pitch = emu::SM83::SCREEN_WIDTH });
+    emu::SM83::SetPPUOutputHooks(gb->_ppu, nullptr, EndFrame, output.get());
+    emu::SM83::SetPPUFrameSkip(gb->_ppu, options._frameSkip);
+
+    auto start = std::chrono::steady_clock::now();
+
+    emu::SM83::RunCycles(*gb, options._cycles);
+
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    uint64_t cycles = gb->_sched._currCycle;
+    double frames = double(cycles) / emu::SM83::CYCLES_PER_FRAME;
+    double framesPerSecond = seconds > 0.0 ? frames / seconds : 0.0;
+    std::printf("%.1f frames (%llu cycles) in %.3f s, %.1f frames/s, %.1fx real time\n",
+        frames, (unsigned long long)cycles, seconds, framesPerSecond, framesPerSecond / FRAMES_PER_SECOND);
+
+    if (options._printHash)
+    {
+        std::printf("hash %016llx\n", (unsigned long long)HashFramebuffer(output->_framebuffer));
+    }
+
+    int result = 0;
+    if (options._finalPath && !WritePGM(options._finalPath, output->_framebuffer))
+    {
+        std::fprintf(stderr, "Could not write %s\n", options._finalPath);
+        result = 1;
+    }
+
+    if (output->_dumpFailed)
+    {
+        result = 1;
+    }
+
+    emu::SM83::DestroyGameBoy(*gb);
+    return result;
+}
@@ -4,13 +4,21 @@ newoption {
     description = "Platform to generate project and solution files for",
     allowed = {
         { "win64",              "Windows x86-64" },
+        { "linux64",            "Linux x86-64" },
     },
     default = "win64"
 }
 
 PLATFORM_PROPERTIES = {
     win64 = {
+        IncludeAppInBuild = true,
         IncludeTestsInBuild = true,
+        IncludeBenchmarksInBuild = true,
+    },
+    linux64 = {
+        IncludeAppInBuild = false,     -- The windowed app is Win32 only, gbrun is the way to run ROMs here
+        IncludeTestsInBuild = true,
+        IncludeBenchmarksInBuild = true,
     }
 }
 
@@ -22,6 +30,13 @@ workspace "emulator"
         system "windows"
         architecture "x86_64"
 
+    -- Linux x64 options
+    filter { "options:platform=linux64" }
+        system "linux"
+        architecture "x86_64"
+        toolset "gcc"
+    filter {}
+
     -- Workspace build configurations
     configurations { "Debug", "Release" }
 
@@ -46,9 +61,17 @@ workspace "emulator"
 
     -- Projects
     include "emulator"
-    include "app"
+    include "gbrun"
+
+    if PLATFORM_PROPERTIES[_OPTIONS["platform"]].IncludeAppInBuild then
+        include "app"
+    end
 
     if PLATFORM_PROPERTIES[_OPTIONS["platform"]].IncludeTestsInBuild then
         include "contrib/projects/googletest.premake5"
         include "tests"
     end
+
+    if PLATFORM_PROPERTIES[_OPTIONS["platform"]].IncludeBenchmarksInBuild then
+        include "bench"
+    end
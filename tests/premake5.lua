@@ -24,4 +24,9 @@ project "emulatorTests"
 
     targetdir "%{wks.location}/%{cfg.buildcfg}/"
 
-    links { "googletest", "emulator" }
\ No newline at end of file
+    links { "googletest", "emulator" }
+
+    -- googletest uses pthreads on Linux
+    filter "system:linux"
+        links { "pthread" }
+    filter {}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "gtest/gtest.h"
+
+#include "BatchRunner.hpp"
+#include "testHelpers.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+    using testHelpers::BuildTestROM;
+    using testHelpers::TEST_ROM_SIZE;
+
+    struct JobRecord
+    {
+        uint32_t _boots = 0;
+        uint32_t _finishes = 0;
+        uint64_t _finishCycle = 0;
+        uint8_t _targetLY = 0xFF;
+    };
+
+    void CountBoot(void* userData, emu::SM83::GameBoy&)
+    {
+        static_cast<JobRecord*>(userData)->_boots++;
+    }
+
+    void CountFinish(void* userData, emu::SM83::GameBoy& gb)
+    {
+        JobRecord& record = *static_cast<JobRecord*>(userData);
+        record._finishes++;
+        record._finishCycle = gb._sched._currCycle;
+    }
+
+    // Jobs share their user data between the predicate and the hooks
+    bool ScanlineReached(void* userData, const emu::SM83::GameBoy& gb)
+    {
+        return testHelpers::ScanlineReached(&static_cast<JobRecord*>(userData)->_targetLY, gb);
+    }
+}
+
+TEST(BatchRunnerTests, RunsEveryJobToItsEnd)
+{
+    std::unique_ptr<uint8_t[]> rom = BuildTestROM();
+
+    // Lengths all over the place, including several slices' worth, so workers run out at different times
+    constexpr const uint32_t JOB_COUNT = 13;
+    std::vector<JobRecord> records(JOB_COUNT);
+    std::vector<emu::SM83::BatchJob> jobs(JOB_COUNT);
+    uint64_t totalCycles = 0;
+    for (uint32_t i = 0; i < JOB_COUNT; ++i)
+    {
+        emu::SM83::BatchJob& job = jobs[i];
+        job._rom = rom.get();
+        job._romSize = TEST_ROM_SIZE;
+        job._mode = (i % 2) ? emu::SM83::ExecutionMode::CycleAccurate : emu::SM83::ExecutionMode::Instruction;
+        job._cycles = (i % 4) * emu::SM83::BATCH_SLICE_CYCLES + i * 1001;
+        job._onBoot = CountBoot;
+        job._onFinish = CountFinish;
+        job._userData = &records[i];
+        totalCycles += job._cycles;
+    }
+
+    emu::SM83::BatchStats stats = emu::SM83::RunBatch(jobs.data(), JOB_COUNT, 3);
+    EXPECT_EQ(stats._workerCount, 3u);
+
+    uint64_t cyclesRun = 0;
+    for (uint32_t i = 0; i < JOB_COUNT; ++i)
+    {
+        const emu::SM83::BatchJob& job = jobs[i];
+        EXPECT_TRUE(job._booted);
+        EXPECT_FALSE(job._predicateMet);
+        EXPECT_EQ(records[i]._boots, 1u);
+        EXPECT_EQ(records[i]._finishes, 1u);
+        EXPECT_EQ(records[i]._finishCycle, job._cyclesRun);
+
+        // Whole instructions can overshoot, single cycles never do
+        if (job._mode == emu::SM83::ExecutionMode::CycleAccurate)
+        {
+            EXPECT_EQ(job._cyclesRun, job._cycles);
+        }
+        else
+        {
+            EXPECT_GE(job._cyclesRun, job._cycles);
+            EXPECT_LT(job._cyclesRun, job._cycles + 32);
+        }
+
+        cyclesRun += job._cyclesRun;
+    }
+
+    EXPECT_EQ(stats._cycles, cyclesRun);
+    EXPECT_GE(stats._cycles, totalCycles);
+}
+
+TEST(BatchRunnerTests, PredicateEndsJobEarly)
+{
+    std::unique_ptr<uint8_t[]> rom = BuildTestROM();
+
+    JobRecord record;
+    record._targetLY = 10;
+
+    emu::SM83::BatchJob job;
+    job._rom = rom.get();
+    job._romSize = TEST_ROM_SIZE;
+    job._cycles = 100 * emu::SM83::BATCH_SLICE_CYCLES;
+    job._predicate = ScanlineReached;
+    job._onFinish = CountFinish;
+    job._userData = &record;
+
+    emu::SM83::RunBatch(&job, 1, 2);
+    EXPECT_TRUE(job._predicateMet);
+    EXPECT_LT(job._cyclesRun, job._cycles);
+    EXPECT_EQ(record._finishes, 1u);
+}
+
+TEST(BatchRunnerTests, InvalidROMIsReportedNotRun)
+{
+    std::unique_ptr<uint8_t[]> rom = BuildTestROM();
+    std::unique_ptr<uint8_t[]> badROM = std::make_unique<uint8_t[]>(TEST_ROM_SIZE);
+
+    JobRecord records[2];
+    emu::SM83::BatchJob jobs[2];
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        jobs[i]._rom = i ? badROM.get() : rom.get();
+        jobs[i]._romSize = TEST_ROM_SIZE;
+        jobs[i]._cycles = emu::SM83::CYCLES_PER_FRAME;
+        jobs[i]._onBoot = CountBoot;
+        jobs[i]._onFinish = CountFinish;
+        jobs[i]._userData = &records[i];
+    }
+
+    emu::SM83::RunBatch(jobs, 2, 2);
+    EXPECT_TRUE(jobs[0]._booted);
+    EXPECT_EQ(jobs[0]._cyclesRun, emu::SM83::CYCLES_PER_FRAME);
+
+    EXPECT_FALSE(jobs[1]._booted);
+    EXPECT_EQ(jobs[1]._cyclesRun, 0u);
+    EXPECT_EQ(records[1]._boots, 0u);
+    EXPECT_EQ(records[1]._finishes, 0u);
+}
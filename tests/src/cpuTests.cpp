@@ -3,6 +3,7 @@
 
 #include "SM83.hpp"
 #include "MMU.hpp"
+#include "JIT.hpp"
 
 #include <vector>
 #include <fstream>
@@ -48,6 +49,9 @@ class OpCodeTest : public testing::TestWithParam<uint16_t>
             _memory = std::make_unique<uint8_t[]>(64 * 1024);
             emu::SM83::MapMemoryRegion(_mmu, 0, 64 * 1024, _memory.get(), 0);
 
+            // Same memory as it's already mapped to, but where translated code expects HRAM to be
+            emu::SM83::MapHRAM(_mmu, _memory.get() + emu::SM83::MMU_HRAM_BEGIN);
+
             if (IsTestableOpCode(uint8_t(GetParam())))
             {
                 char fileName[256]= {};
@@ -166,6 +170,94 @@ TEST_P(OpCodeTest, TestOpCode)
     }
 }
 
+void CheckFinalCPUState(const emu::SM83::CPU& cpu, const json& state, const uint8_t* memory)
+{
+    ASSERT_EQ(cpu._registers._reg8.A, uint8_t(state["a"]));
+    ASSERT_EQ(cpu._registers._reg8.B, uint8_t(state["b"]));
+    ASSERT_EQ(cpu._registers._reg8.C, uint8_t(state["c"]));
+    ASSERT_EQ(cpu._registers._reg8.D, uint8_t(state["d"]));
+    ASSERT_EQ(cpu._registers._reg8.E, uint8_t(state["e"]));
+    ASSERT_EQ(cpu._registers._reg8.F, uint8_t(state["f"]));
+    ASSERT_EQ(cpu._registers._reg8.H, uint8_t(state["h"]));
+    ASSERT_EQ(cpu._registers._reg8.L, uint8_t(state["l"]));
+
+    ASSERT_EQ(cpu._registers._reg16.PC, uint16_t(state["pc"]));
+    ASSERT_EQ(cpu._registers._reg16.SP, uint16_t(state["sp"]));
+
+    const json& ramState = state["ram"];
+    for (const json& ramEntry : ramState)
+    {
+        ASSERT_EQ(memory[size_t(ramEntry[0])], uint8_t(ramEntry[1]));
+    }
+}
+
+TEST_P(OpCodeTest, TestOpCodeInstructionMode)
+{
+    uint8_t opCode = uint8_t(GetParam());
+    if (!IsTestableOpCode(opCode))
+    {
+        return;
+    }
+
+    for (const json& test : _testData)
+    {
+        emu::SM83::BootCPU(_cpu, 0, 0, 1);
+        SetCPUState(_cpu, test["initial"], _memory.get(), opCode);
+
+        // Whole instruction at once, has to take as long as the cycle by cycle version
+        uint32_t cycles = emu::SM83::StepCPU(_cpu, _mmu);
+        ASSERT_EQ(cycles, uint32_t(test["cycles"].size() * 4)) << std::string(test["name"]);
+        ASSERT_TRUE(emu::SM83::IsAtInstructionBoundary(_cpu));
+
+        ASSERT_NO_FATAL_FAILURE(CheckFinalCPUState(_cpu, test["final"], _memory.get())) << std::string(test["name"]);
+    }
+}
+
+TEST_P(OpCodeTest, TestOpCodeCompiled)
+{
+    uint8_t opCode = uint8_t(GetParam());
+    if (!IsTestableOpCode(opCode))
+    {
+        return;
+    }
+
+    emu::SM83::JIT jit;
+    if (!emu::SM83::InitJIT(jit))
+    {
+        GTEST_SKIP() << "JIT not available on this platform";
+    }
+
+    for (const json& test : _testData)
+    {
+        emu::SM83::BootCPU(_cpu, 0, 0, 1);
+        SetCPUState(_cpu, test["initial"], _memory.get(), opCode);
+        uint16_t address = uint16_t(_cpu._registers._reg16.PC - 1);
+        _memory[address] = opCode;
+
+        // Translated on its own, falls back to the interpreter when the block has to bail
+        emu::SM83::JITBlock block = emu::SM83::CompileBlock(jit, _mmu, address, 1);
+        uint32_t cycles = block._func ? emu::SM83::RunBlock(block, _cpu, _mmu) : 0;
+
+        // Only instructions going through the interpreter can bail, native ones have to run as translated
+        if (block._func && block._nativeInstructionCount == block._instructionCount)
+        {
+            ASSERT_NE(cycles, 0u) << std::string(test["name"]);
+        }
+
+        if (cycles == 0)
+        {
+            cycles = emu::SM83::StepCPU(_cpu, _mmu);
+        }
+
+        ASSERT_EQ(cycles, uint32_t(test["cycles"].size() * 4)) << std::string(test["name"]);
+        ASSERT_TRUE(emu::SM83::IsAtInstructionBoundary(_cpu));
+
+        ASSERT_NO_FATAL_FAILURE(CheckFinalCPUState(_cpu, test["final"], _memory.get())) << std::string(test["name"]);
+    }
+
+    emu::SM83::DestroyJIT(jit);
+}
+
 INSTANTIATE_TEST_SUITE_P(
     SM83, 
     OpCodeTest, 
@@ -280,4 +372,300 @@ TEST(UseCaseTests, InterruptTests)
 
     EXPECT_EQ(cpu._registers._reg8.A, 0x2F);
     EXPECT_EQ(cpu._registers._reg8.IME, 1);
-}
\ No newline at end of file
+}
+
+TEST(UseCaseTests, InstructionModeMatchesCycleAccurate)
+{
+    // Same program as above, run through both execution modes side by side
+    constexpr const uint8_t program[] =
+    {
+        0x31, 0xFE, 0xFF, // 0x00: LD SP, $fffe
+        0x3E, 0x05,       // 0x03: LD A, 0x05
+        0xE0, 0x0F,       // 0x05: LD ($FF00+0F), A     - Request VBLANK + TIMER
+        0xE0, 0xFF,       // 0x07: LD ($FF00+FF), A
+        0xFB,             // 0x09: EI
+        0x3C,             // 0x0A: INC A
+        0xC3, 0x0A, 0x00, // 0x0B: JP $000A
+    };
+
+    std::unique_ptr<uint8_t[]> RAM[2] = { std::make_unique<uint8_t[]>(64 * 1024), std::make_unique<uint8_t[]>(64 * 1024) };
+    emu::SM83::MMU mmu[2];
+    emu::SM83::CPU cpu[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        memcpy(RAM[i].get(), program, sizeof(program));
+        RAM[i][0x40] = 0xD9;    // RETI
+        RAM[i][0x50] = 0xD9;
+
+        emu::SM83::MapMemoryRegion(mmu[i], 0, 64 * 1024, RAM[i].get(), 0);
+        emu::SM83::BootCPU(cpu[i], 0, 0, 1);
+        emu::SM83::MapPeripheralIOMemory(cpu[i], mmu[i]);
+    }
+
+    for (int i = 0; i < 100; ++i)
+    {
+        uint32_t cycles = emu::SM83::StepCPU(cpu[1], mmu[1]);
+        emu::SM83::TickCPU(cpu[0], mmu[0], cycles);
+
+        ASSERT_TRUE(emu::SM83::IsAtInstructionBoundary(cpu[0]));
+        ASSERT_EQ(cpu[0]._registers._reg16.PC, cpu[1]._registers._reg16.PC);
+        ASSERT_EQ(cpu[0]._registers._reg16.SP, cpu[1]._registers._reg16.SP);
+        ASSERT_EQ(cpu[0]._registers._reg16.AF, cpu[1]._registers._reg16.AF);
+        ASSERT_EQ(cpu[0]._registers._reg8.IR, cpu[1]._registers._reg8.IR);
+        ASSERT_EQ(cpu[0]._registers._reg8.IME, cpu[1]._registers._reg8.IME);
+    }
+
+    EXPECT_EQ(memcmp(RAM[0].get(), RAM[1].get(), 64 * 1024), 0);
+}
+TEST(UseCaseTests, CompiledBlocksMatchInterpreter)
+{
+    // Copy loop running out of ROM, with WRAM as the destination
+    constexpr const uint8_t program[] =
+    {
+        0x31, 0xFE, 0xFF, // 0x00: LD SP, $fffe
+        0x11, 0x00, 0x10, // 0x03: LD DE, 0x1000
+        0x21, 0x00, 0xC0, // 0x06: LD HL, 0xC000
+        0x06, 0x40,       // 0x09: LD B, 0x40
+        0xCD, 0x20, 0x00, // 0x0B: CALL 0x0020
+        0x3C,             // 0x0E: INC A
+        0xC3, 0x03, 0x00, // 0x0F: JP $0003
+    };
+
+    constexpr const uint8_t copyLoop[] =
+    {
+        0x1A,             // 0x20: LD A, (DE)
+        0x22,             // 0x21: LD (HL+), A
+        0x13,             // 0x22: INC DE
+        0xA8,             // 0x23: XOR B
+        0x05,             // 0x24: DEC B
+        0x20, 0xF9,       // 0x25: JR NZ, 0x0020
+        0xC9,             // 0x27: RET
+    };
+
+    std::unique_ptr<uint8_t[]> ROM = std::make_unique<uint8_t[]>(32 * 1024);
+    memcpy(ROM.get(), program, sizeof(program));
+    memcpy(ROM.get() + 0x20, copyLoop, sizeof(copyLoop));
+    for (int i = 0; i < 0x100; ++i)
+    {
+        ROM[0x1000 + i] = uint8_t(i * 7);
+    }
+
+    std::unique_ptr<uint8_t[]> RAM[2] = { std::make_unique<uint8_t[]>(32 * 1024), std::make_unique<uint8_t[]>(32 * 1024) };
+    emu::SM83::MMU mmu[2];
+    emu::SM83::CPU cpu[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        emu::SM83::MapMemoryRegion(mmu[i], 0, 32 * 1024, ROM.get(), emu::SM83::MMRF_ReadOnly);
+        emu::SM83::MapMemoryRegion(mmu[i], 0x8000, 32 * 1024, RAM[i].get(), 0);
+        emu::SM83::BootCPU(cpu[i], 0, 0, 1);
+        emu::SM83::MapPeripheralIOMemory(cpu[i], mmu[i]);
+    }
+
+    emu::SM83::JIT jit;
+    if (!emu::SM83::InitJIT(jit))
+    {
+        GTEST_SKIP() << "JIT not available on this platform";
+    }
+
+    // Blocks cover several instructions, so the interpreter catches up instruction by instruction
+    uint64_t cycles[2] = {};
+    for (int i = 0; i < 20000; ++i)
+    {
+        cycles[0] += emu::SM83::StepCPUCompiled(jit, cpu[0], mmu[0], 1024);
+        while (cycles[1] < cycles[0])
+        {
+            cycles[1] += emu::SM83::StepCPU(cpu[1], mmu[1]);
+        }
+
+        ASSERT_EQ(cycles[0], cycles[1]);
+        ASSERT_EQ(cpu[0]._registers._reg16.PC, cpu[1]._registers._reg16.PC);
+        ASSERT_EQ(cpu[0]._registers._reg16.SP, cpu[1]._registers._reg16.SP);
+        ASSERT_EQ(cpu[0]._registers._reg16.AF, cpu[1]._registers._reg16.AF);
+        ASSERT_EQ(cpu[0]._registers._reg16.BC, cpu[1]._registers._reg16.BC);
+        ASSERT_EQ(cpu[0]._registers._reg16.DE, cpu[1]._registers._reg16.DE);
+        ASSERT_EQ(cpu[0]._registers._reg16.HL, cpu[1]._registers._reg16.HL);
+        ASSERT_EQ(cpu[0]._registers._reg8.IR, cpu[1]._registers._reg8.IR);
+    }
+
+    EXPECT_GT(jit._stats._blockRuns, 0u);
+    EXPECT_EQ(memcmp(RAM[0].get(), RAM[1].get(), 32 * 1024), 0);
+
+    emu::SM83::DestroyJIT(jit);
+}
+
+TEST(UseCaseTests, TimerCatchesUpOnAccess)
+{
+    // Nothing but NOPs, the timer registers get accessed from the outside
+    std::unique_ptr<uint8_t[]> RAM = std::make_unique<uint8_t[]>(64 * 1024);
+
+    emu::SM83::MMU mmu;
+    emu::SM83::MapMemoryRegion(mmu, 0, 64 * 1024, RAM.get(), 0);
+
+    emu::SM83::CPU cpu;
+    emu::SM83::BootCPU(cpu, 0, 0, 1);
+    emu::SM83::MapPeripheralIOMemory(cpu, mmu);
+
+    // TIMA increments every 16 T-cycles, DIV every 1024
+    emu::SM83::MMUWrite(mmu, 0xFF07, 0x05);
+    emu::SM83::TickCPU(cpu, mmu, 16 * 100);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF05), 100);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF04), 1);
+
+    // Writing DIV resets it, whatever the value
+    emu::SM83::MMUWrite(mmu, 0xFF04, 0x12);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF04), 0);
+
+    // Overflow raises the timer interrupt (IF bit 2) on the exact T-cycle, without anything reading the registers
+    emu::SM83::MMUWrite(mmu, 0xFF06, 0x80);
+    emu::SM83::TickCPU(cpu, mmu, 16 * 156 - 1);
+    EXPECT_EQ(cpu._peripheralIO.IF & 0x04, 0);
+
+    emu::SM83::TickCPU(cpu, mmu, 1);
+    EXPECT_NE(cpu._peripheralIO.IF & 0x04, 0);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF05), 0x80);
+}
+
+TEST(UseCaseTests, IORegisterMasks)
+{
+    emu::SM83::MMU mmu;
+    emu::SM83::CPU cpu;
+    emu::SM83::BootCPU(cpu, 0, 0, 1);
+    emu::SM83::MapPeripheralIOMemory(cpu, mmu);
+
+    // Unused registers and bits read as 1, whatever gets written to them
+    emu::SM83::MMUWrite(mmu, 0xFF08, 0x12);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF08), 0xFF);
+    emu::SM83::MMUWrite(mmu, 0xFF0F, 0x01);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF0F), 0xE1);
+    emu::SM83::MMUWrite(mmu, 0xFF00, 0x20);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF00), 0xEF);
+
+    // Read-only bits keep their value
+    cpu._peripheralIO.STAT = 0x02;
+    emu::SM83::MMUWrite(mmu, 0xFF41, 0x47);
+    EXPECT_EQ(cpu._peripheralIO.STAT, 0x42);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF41), 0xC2);
+
+    // Plain memory past the registers
+    emu::SM83::MMUWrite(mmu, 0xFF80, 0x12);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF80), 0x12);
+}
+
+TEST(UseCaseTests, HaltSkipMatchesTicking)
+{
+    // Halts until the timer interrupt fires, over and over
+    constexpr const uint8_t program[] =
+    {
+        0x31, 0xFE, 0xFF, // 0x00: LD SP, $fffe
+        0x3E, 0xF0,       // 0x03: LD A, 0xF0
+        0xE0, 0x05,       // 0x05: LD ($FF00+05), A     - TIMA
+        0xE0, 0x06,       // 0x07: LD ($FF00+06), A     - TMA
+        0x3E, 0x04,       // 0x09: LD A, 0x04
+        0xE0, 0x07,       // 0x0B: LD ($FF00+07), A     - Enable the timer, slowest frequency
+        0xE0, 0xFF,       // 0x0D: LD ($FF00+FF), A     - Enable the timer interrupt
+        0xFB,             // 0x0F: EI
+        0x76,             // 0x10: HALT
+        0x04,             // 0x11: INC B
+        0x18, 0xFC,       // 0x12: JR 0x0010
+    };
+
+    std::unique_ptr<uint8_t[]> RAM[2] = { std::make_unique<uint8_t[]>(64 * 1024), std::make_unique<uint8_t[]>(64 * 1024) };
+    emu::SM83::MMU mmu[2];
+    emu::SM83::CPU cpu[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        memcpy(RAM[i].get(), program, sizeof(program));
+        RAM[i][0x50] = 0x0C;    // INC C
+        RAM[i][0x51] = 0xD9;    // RETI
+
+        emu::SM83::MapMemoryRegion(mmu[i], 0, 64 * 1024, RAM[i].get(), 0);
+        emu::SM83::BootCPU(cpu[i], 0, 0, 1);
+        emu::SM83::MapPeripheralIOMemory(cpu[i], mmu[i]);
+    }
+
+    // Ticking the first CPU for as long as the second one skipped has to land on the exact same state
+    uint64_t skippedCycles = 0;
+    while (cpu[1]._registers._reg8.C < 8)
+    {
+        uint32_t cycles = emu::SM83::SkipHaltedCycles(cpu[1], 64 * 1024);
+        if (cycles == 0)
+        {
+            cycles = 4;
+            emu::SM83::TickCPU(cpu[1], mmu[1], cycles);
+        }
+        else
+        {
+            skippedCycles += cycles;
+        }
+
+        emu::SM83::TickCPU(cpu[0], mmu[0], cycles);
+        emu::SM83::SyncTimer(cpu[0]);
+        emu::SM83::SyncTimer(cpu[1]);
+
+        ASSERT_EQ(cpu[0]._tcycle, cpu[1]._tcycle);
+        ASSERT_EQ(cpu[0]._decoder._flags, cpu[1]._decoder._flags);
+        ASSERT_EQ(cpu[0]._registers._reg16.PC, cpu[1]._registers._reg16.PC);
+        ASSERT_EQ(cpu[0]._registers._reg16.AF, cpu[1]._registers._reg16.AF);
+        ASSERT_EQ(cpu[0]._registers._reg16.BC, cpu[1]._registers._reg16.BC);
+        ASSERT_EQ(cpu[0]._registers._reg8.IR, cpu[1]._registers._reg8.IR);
+        ASSERT_EQ(memcmp(&cpu[0]._peripheralIO, &cpu[1]._peripheralIO, sizeof(cpu[0]._peripheralIO)), 0);
+    }
+
+    EXPECT_EQ(cpu[0]._registers._reg8.C, 8);
+    EXPECT_GT(skippedCycles, 8u * 15 * 1024);
+}
+
+TEST(UseCaseTests, CompiledBlockStopsOnceItHasTakenMaxCycles)
+{
+    emu::SM83::JIT jit;
+    if (!emu::SM83::InitJIT(jit))
+    {
+        GTEST_SKIP() << "JIT not available on this platform";
+    }
+
+    std::unique_ptr<uint8_t[]> RAM = std::make_unique<uint8_t[]>(64 * 1024);
+
+    emu::SM83::MMU mmu;
+    emu::SM83::MapMemoryRegion(mmu, 0, 64 * 1024, RAM.get(), 0);
+
+    emu::SM83::CPU cpu;
+    emu::SM83::BootCPU(cpu, 0xFFFE, 0x0001, 1);
+    emu::SM83::MapPeripheralIOMemory(cpu, mmu);
+
+    const uint8_t program[] =
+    {
+        0x3E, 0x42,       // 0x00: LD A, $42
+        0xE0, 0x90,       // 0x02: LDH ($FF00+90), A
+        0x04,             // 0x04: INC B
+        0xF0, 0x91,       // 0x05: LDH A, ($FF00+91)
+        0x04,             // 0x07: INC B
+        0x18, 0xFE,       // 0x08: JR 0x08
+    };
+    memcpy(RAM.get(), program, sizeof(program));
+    cpu._registers._reg8.IR = program[0];
+    cpu._peripheralIO.HRAM[0x11] = 0x24;
+
+    // HRAM accesses are translated as well, so the whole block is native
+    emu::SM83::JITBlock block = emu::SM83::CompileBlock(jit, mmu, 0x0000, 16);
+    ASSERT_TRUE(block._func);
+    EXPECT_EQ(block._instructionCount, 6);
+    EXPECT_EQ(block._nativeInstructionCount, 6);
+
+    // 20 cycles in, INC B still starts short of the 21, LDH A, (a8) doesn't
+    uint32_t cycles = emu::SM83::RunBlock(block, cpu, mmu, 21);
+    EXPECT_EQ(cycles, 24u);
+    EXPECT_EQ(cpu._peripheralIO.HRAM[0x10], 0x42);
+    EXPECT_EQ(cpu._registers._reg8.A, 0x42);
+    EXPECT_EQ(cpu._registers._reg8.B, 1);
+    EXPECT_EQ(cpu._registers._reg8.IR, 0xF0);
+    EXPECT_EQ(cpu._registers._reg16.PC, 0x0006);
+
+    // The first instruction runs no matter what, same as a step would
+    emu::SM83::JITBlock rest = emu::SM83::CompileBlock(jit, mmu, 0x0005, 16);
+    cycles = emu::SM83::RunBlock(rest, cpu, mmu, 0);
+    EXPECT_EQ(cycles, 12u);
+    EXPECT_EQ(cpu._registers._reg8.A, 0x24);
+    EXPECT_EQ(cpu._registers._reg8.B, 1);
+
+    emu::SM83::DestroyJIT(jit);
+}
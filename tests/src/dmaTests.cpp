@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+
+#include "DMA.hpp"
+#include "MMU.hpp"
+#include "PPU.hpp"
+#include "SM83.hpp"
+
+#include <cstring>
+#include <memory>
+
+namespace
+{
+    struct VRAMDMATestContext
+    {
+        emu::SM83::MMU _mmu;
+        emu::SM83::CPU _cpu;
+        emu::SM83::PPU _ppu;
+        emu::SM83::VRAMDMACtrl _dma;
+
+        uint8_t _rom[0x4000] = {};
+        uint8_t _vram[0x2000] = {};
+        uint8_t _oam[0x100] = {};
+    };
+
+    void BootVRAMDMATest(VRAMDMATestContext& ctxt)
+    {
+        for (uint32_t i = 0; i < sizeof(ctxt._rom); ++i)
+        {
+            ctxt._rom[i] = uint8_t(i);
+        }
+
+        emu::SM83::MapMemoryRegion(ctxt._mmu, 0x0000, sizeof(ctxt._rom), ctxt._rom, emu::SM83::MMRF_ReadOnly);
+        emu::SM83::MapMemoryRegion(ctxt._mmu, 0x8000, sizeof(ctxt._vram), ctxt._vram, 0);
+
+        emu::SM83::BootCPU(ctxt._cpu, 0xFFFE, 0x0100, 1);
+        emu::SM83::MapPeripheralIOMemory(ctxt._cpu, ctxt._mmu);
+        emu::SM83::BootPPU(ctxt._ppu, ctxt._vram, ctxt._oam);
+        emu::SM83::BootVRAMDMA(ctxt._dma, ctxt._cpu, ctxt._ppu);
+
+        // Source $1230, destination $8100
+        emu::SM83::MMUWrite(ctxt._mmu, 0xFF51, 0x12);
+        emu::SM83::MMUWrite(ctxt._mmu, 0xFF52, 0x34);
+        emu::SM83::MMUWrite(ctxt._mmu, 0xFF53, 0x81);
+        emu::SM83::MMUWrite(ctxt._mmu, 0xFF54, 0x00);
+    }
+}
+
+TEST(DMATests, GeneralPurposeTransferCopiesAtOnce)
+{
+    std::unique_ptr<VRAMDMATestContext> ctxt = std::make_unique<VRAMDMATestContext>();
+    BootVRAMDMATest(*ctxt);
+    EXPECT_EQ(emu::SM83::MMURead(ctxt->_mmu, 0xFF55), 0xFF);
+
+    // 2 blocks
+    emu::SM83::MMUWrite(ctxt->_mmu, 0xFF55, 0x01);
+    EXPECT_EQ(std::memcmp(ctxt->_vram + 0x100, ctxt->_rom + 0x1230, 32), 0);
+    EXPECT_EQ(ctxt->_vram[0x120], 0x00);
+    EXPECT_EQ(emu::SM83::MMURead(ctxt->_mmu, 0xFF55), 0xFF);
+
+    // The CPU sits the transfer out, but the timer keeps going
+    EXPECT_EQ(ctxt->_cpu._stallCycles, 64u);
+    uint16_t pc = ctxt->_cpu._registers._reg16.PC;
+    EXPECT_EQ(emu::SM83::StepCPU(ctxt->_cpu, ctxt->_mmu), 64u);
+    EXPECT_EQ(ctxt->_cpu._registers._reg16.PC, pc);
+    EXPECT_EQ(ctxt->_cpu._tcycle, 64u);
+}
+
+TEST(DMATests, HBlankTransferCopiesABlockPerHBlank)
+{
+    std::unique_ptr<VRAMDMATestContext> ctxt = std::make_unique<VRAMDMATestContext>();
+    BootVRAMDMATest(*ctxt);
+    ctxt->_cpu._peripheralIO.LCDC = 0x91;
+
+    // 3 blocks, nothing happens until the PPU gets to HBlank
+    emu::SM83::MMUWrite(ctxt->_mmu, 0xFF55, 0x82);
+    EXPECT_EQ(ctxt->_vram[0x101], 0x00);
+    EXPECT_EQ(emu::SM83::MMURead(ctxt->_mmu, 0xFF55), 0x02);
+
+    emu::SM83::AdvancePPU(ctxt->_ppu, ctxt->_mmu, ctxt->_cpu._peripheralIO, 456);
+    EXPECT_EQ(std::memcmp(ctxt->_vram + 0x100, ctxt->_rom + 0x1230, 16), 0);
+    EXPECT_EQ(ctxt->_vram[0x110], 0x00);
+    EXPECT_EQ(ctxt->_cpu._stallCycles, 32u);
+    EXPECT_EQ(emu::SM83::MMURead(ctxt->_mmu, 0xFF55), 0x01);
+
+    // Stopping keeps the remaining length around
+    emu::SM83::MMUWrite(ctxt->_mmu, 0xFF55, 0x00);
+    EXPECT_EQ(emu::SM83::MMURead(ctxt->_mmu, 0xFF55), 0x81);
+
+    emu::SM83::AdvancePPU(ctxt->_ppu, ctxt->_mmu, ctxt->_cpu._peripheralIO, 456);
+    EXPECT_EQ(ctxt->_vram[0x110], 0x00);
+}
@@ -0,0 +1,259 @@
+#include "gtest/gtest.h"
+
+#include "GameBoy.hpp"
+#include "testHelpers.hpp"
+
+#include <cstring>
+#include <iterator>
+#include <memory>
+
+namespace
+{
+    using testHelpers::ALL_MODES;
+    using testHelpers::BootROMDone;
+    using testHelpers::BuildTestROM;
+    using testHelpers::ScanlineReached;
+    using testHelpers::TEST_ROM_SIZE;
+    using testHelpers::WriteTimerTestProgram;
+
+    struct GameBoyTestContext
+    {
+        std::unique_ptr<uint8_t[]> _rom = std::make_unique<uint8_t[]>(TEST_ROM_SIZE);
+        std::unique_ptr<emu::SM83::GameBoy> _gb = std::make_unique<emu::SM83::GameBoy>();
+
+        ~GameBoyTestContext()
+        {
+            emu::SM83::DestroyGameBoy(*_gb);
+        }
+    };
+
+    bool BootTestROM(GameBoyTestContext& ctxt, emu::SM83::ExecutionMode mode)
+    {
+        BuildTestROM(ctxt._rom.get());
+        return emu::SM83::BootGameBoy(*ctxt._gb, ctxt._rom.get(), TEST_ROM_SIZE, mode);
+    }
+
+    bool Never(void*, const emu::SM83::GameBoy&)
+    {
+        return false;
+    }
+
+    constexpr const uint32_t STAT_SAMPLE_COUNT = 256;
+
+    // Past the boot ROM, turns the display off through a read-modify-write of LCDC and back on with a plain write,
+    // then records STAT from $C000 on. The PPU stands still while the display is off, so the samples tell how long that was
+    void WriteLCDCToggleProgram(uint8_t* rom)
+    {
+        constexpr const uint8_t ENTRY[] = { 0x00, 0xC3, 0x50, 0x01 };     // nop; jp $0150
+        constexpr const uint8_t MAIN[] =
+        {
+            0x21, 0x40, 0xFF,           // ld hl, LCDC
+            0x11, 0x00, 0xC0,           // ld de, $C000
+            0x7E,                       // ld a, (hl)
+            0xCB, 0xBE,                 // res 7, (hl)
+            0x77,                       // ld (hl), a
+            0xF0, 0x41,                 // loop: ldh a, (STAT)
+            0x12,                       // ld (de), a
+            0x1C,                       // inc e
+            0x20, 0xFA,                 // jr nz, loop
+            0x18, 0xFE,                 // jr @
+        };
+
+        std::memcpy(rom + 0x0100, ENTRY, sizeof(ENTRY));
+        std::memcpy(rom + 0x0150, MAIN, sizeof(MAIN));
+    }
+}
+
+TEST(GameBoyTests, BootFailsOnInvalidROM)
+{
+    GameBoyTestContext ctxt;
+    EXPECT_FALSE(emu::SM83::BootGameBoy(*ctxt._gb, ctxt._rom.get(), TEST_ROM_SIZE));
+    EXPECT_FALSE(emu::SM83::BootGameBoy(*ctxt._gb, nullptr, 0));
+}
+
+TEST(GameBoyTests, RunFrameEndsOnFrameBoundaries)
+{
+    for (emu::SM83::ExecutionMode mode : ALL_MODES)
+    {
+        GameBoyTestContext ctxt;
+        ASSERT_TRUE(BootTestROM(ctxt, mode));
+
+        // Off the frame grid first, the next frame still has to end on it
+        emu::SM83::RunCycles(*ctxt._gb, 1234);
+        for (uint64_t frame = 1; frame <= 3; ++frame)
+        {
+            emu::SM83::RunFrame(*ctxt._gb);
+
+            const uint64_t currCycle = ctxt._gb->_sched._currCycle;
+            if (mode == emu::SM83::ExecutionMode::CycleAccurate)
+            {
+                EXPECT_EQ(currCycle, frame * emu::SM83::CYCLES_PER_FRAME);
+            }
+            else
+            {
+                // Whole instructions can overshoot, but never into the next frame
+                EXPECT_GE(currCycle, frame * emu::SM83::CYCLES_PER_FRAME);
+                EXPECT_LT(currCycle, frame * emu::SM83::CYCLES_PER_FRAME + 32);
+            }
+        }
+    }
+}
+
+TEST(GameBoyTests, RunUntilStopsOncePredicateIsMet)
+{
+    for (emu::SM83::ExecutionMode mode : ALL_MODES)
+    {
+        GameBoyTestContext ctxt;
+        ASSERT_TRUE(BootTestROM(ctxt, mode));
+
+        // The boot ROM turns the display on a few frames in
+        uint8_t target = 10;
+        ASSERT_TRUE(emu::SM83::RunUntil(*ctxt._gb, ScanlineReached, &target, 8 * emu::SM83::CYCLES_PER_FRAME));
+        EXPECT_EQ(ctxt._gb->_cpu._peripheralIO.LY, target);
+
+        target = 20;
+        ASSERT_TRUE(emu::SM83::RunUntil(*ctxt._gb, ScanlineReached, &target, emu::SM83::CYCLES_PER_FRAME));
+        EXPECT_EQ(ctxt._gb->_cpu._peripheralIO.LY, target);
+
+        // Already met, nothing gets run
+        const uint64_t currCycle = ctxt._gb->_sched._currCycle;
+        EXPECT_TRUE(emu::SM83::RunUntil(*ctxt._gb, ScanlineReached, &target, emu::SM83::CYCLES_PER_FRAME));
+        EXPECT_EQ(ctxt._gb->_sched._currCycle, currCycle);
+    }
+}
+
+TEST(GameBoyTests, RunUntilGivesUpAfterMaxCycles)
+{
+    for (emu::SM83::ExecutionMode mode : ALL_MODES)
+    {
+        GameBoyTestContext ctxt;
+        ASSERT_TRUE(BootTestROM(ctxt, mode));
+
+        EXPECT_FALSE(emu::SM83::RunUntil(*ctxt._gb, Never, nullptr, 10000));
+        EXPECT_GE(ctxt._gb->_sched._currCycle, 10000u);
+        EXPECT_LT(ctxt._gb->_sched._currCycle, 10000u + 32);
+    }
+}
+
+TEST(GameBoyTests, BootROMHandsOverOnTheSameCycleInAllModes)
+{
+    // The boot ROM polls LY while scrolling the logo, so this only lines up if the PPU's caught up before every read of it
+    uint64_t handoverCycles[std::size(ALL_MODES)] = {};
+    uint8_t handoverLY[std::size(ALL_MODES)] = {};
+    for (size_t i = 0; i < std::size(ALL_MODES); ++i)
+    {
+        GameBoyTestContext ctxt;
+        ASSERT_TRUE(BootTestROM(ctxt, ALL_MODES[i]));
+        ASSERT_TRUE(emu::SM83::RunUntil(*ctxt._gb, BootROMDone, nullptr, 400 * emu::SM83::CYCLES_PER_FRAME));
+
+        handoverCycles[i] = ctxt._gb->_sched._currCycle;
+        handoverLY[i] = ctxt._gb->_cpu._peripheralIO.LY;
+    }
+
+    // Cycle accurate mode stops right after the write, the others at the end of the instruction doing it
+    for (size_t i = 1; i < std::size(ALL_MODES); ++i)
+    {
+        EXPECT_GE(handoverCycles[i], handoverCycles[0]);
+        EXPECT_LT(handoverCycles[i], handoverCycles[0] + 32);
+        EXPECT_EQ(handoverLY[i], handoverLY[0]);
+    }
+}
+
+TEST(GameBoyTests, RunCyclesDoesNotDriftOverManySmallCalls)
+{
+    for (emu::SM83::ExecutionMode mode : ALL_MODES)
+    {
+        GameBoyTestContext ctxt;
+        ASSERT_TRUE(BootTestROM(ctxt, mode));
+
+        // Shorter than most instructions, every call overshoots unless the last one's overshoot is taken off
+        for (uint32_t i = 0; i < 100000; ++i)
+        {
+            emu::SM83::RunCycles(*ctxt._gb, 10);
+        }
+
+        EXPECT_GE(ctxt._gb->_sched._currCycle, 1000000u);
+        EXPECT_LT(ctxt._gb->_sched._currCycle, 1000000u + 32);
+
+        // Same for a frame after a predicate stopped somewhere in the middle of one
+        uint8_t target = 100;
+        ASSERT_TRUE(emu::SM83::RunUntil(*ctxt._gb, ScanlineReached, &target, 2 * emu::SM83::CYCLES_PER_FRAME));
+        const uint64_t frameEndCycle = (ctxt._gb->_sched._currCycle / emu::SM83::CYCLES_PER_FRAME + 1) * emu::SM83::CYCLES_PER_FRAME;
+        emu::SM83::RunFrame(*ctxt._gb);
+
+        EXPECT_GE(ctxt._gb->_sched._currCycle, frameEndCycle);
+        EXPECT_LT(ctxt._gb->_sched._currCycle, frameEndCycle + 32);
+    }
+}
+
+TEST(GameBoyTests, TimerInterruptsLineUpInAllModes)
+{
+    // Only lines up if translated blocks end before the timer interrupt is due, rather than let it wait for the block
+    uint8_t records[std::size(ALL_MODES)][64] = {};
+    for (size_t i = 0; i < std::size(ALL_MODES); ++i)
+    {
+        GameBoyTestContext ctxt;
+        ASSERT_TRUE(BootTestROM(ctxt, ALL_MODES[i]));
+        WriteTimerTestProgram(ctxt._rom.get());
+
+        ASSERT_TRUE(emu::SM83::RunUntil(*ctxt._gb, BootROMDone, nullptr, 400 * emu::SM83::CYCLES_PER_FRAME));
+        emu::SM83::RunCycles(*ctxt._gb, 40 * 256);
+
+        std::memcpy(records[i], ctxt._gb->_wram[0], sizeof(records[i]));
+        if (ALL_MODES[i] == emu::SM83::ExecutionMode::Compiled && ctxt._gb->_mode == emu::SM83::ExecutionMode::Compiled)
+        {
+            EXPECT_GT(ctxt._gb->_jit._stats._blockRuns, 0u);
+        }
+    }
+
+    EXPECT_NE(records[0][0], 0);
+    for (size_t i = 1; i < std::size(ALL_MODES); ++i)
+    {
+        EXPECT_EQ(std::memcmp(records[i], records[0], sizeof(records[0])), 0);
+    }
+}
+
+TEST(GameBoyTests, VRAMDMAOnlyWiredForCGBCartridges)
+{
+    GameBoyTestContext dmgCtxt;
+    ASSERT_TRUE(BootTestROM(dmgCtxt, emu::SM83::ExecutionMode::CycleAccurate));
+    EXPECT_EQ(dmgCtxt._gb->_vramDMA._cpu, nullptr);
+
+    // The CGB flag is part of the header checksum
+    GameBoyTestContext cgbCtxt;
+    cgbCtxt._rom[0x0143] = 0x80;
+    BuildTestROM(cgbCtxt._rom.get());
+    ASSERT_TRUE(emu::SM83::BootGameBoy(*cgbCtxt._gb, cgbCtxt._rom.get(), TEST_ROM_SIZE));
+    EXPECT_EQ(cgbCtxt._gb->_vramDMA._cpu, &cgbCtxt._gb->_cpu);
+}
+
+TEST(GameBoyTests, ReadModifyWritesToPPURegistersLandOnTheSameCycleInAllModes)
+{
+    // CB RES (HL) writes in its third MCycle, one after the read, which has to be where the PPU gets caught up to
+    uint8_t samples[std::size(ALL_MODES)][STAT_SAMPLE_COUNT] = {};
+    for (size_t i = 0; i < std::size(ALL_MODES); ++i)
+    {
+        GameBoyTestContext ctxt;
+        ASSERT_TRUE(BootTestROM(ctxt, ALL_MODES[i]));
+        WriteLCDCToggleProgram(ctxt._rom.get());
+
+        ASSERT_TRUE(emu::SM83::RunUntil(*ctxt._gb, BootROMDone, nullptr, 400 * emu::SM83::CYCLES_PER_FRAME));
+        emu::SM83::RunCycles(*ctxt._gb, emu::SM83::CYCLES_PER_FRAME / 4);
+
+        std::memcpy(samples[i], ctxt._gb->_wram[0], sizeof(samples[i]));
+    }
+
+    // Every sample got written, and they cover all the modes of a visible scanline
+    bool modesSeen[4] = {};
+    for (uint8_t sample : samples[0])
+    {
+        EXPECT_NE(sample, 0);
+        modesSeen[sample & 0x03] = true;
+    }
+
+    EXPECT_TRUE(modesSeen[0] && modesSeen[2] && modesSeen[3]);
+    for (size_t i = 1; i < std::size(ALL_MODES); ++i)
+    {
+        EXPECT_EQ(std::memcmp(samples[i], samples[0], sizeof(samples[0])), 0);
+    }
+}
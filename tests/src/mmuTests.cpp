@@ -87,4 +87,169 @@ TEST(MMUTests, CanRedirectZeroSegment)
     emu::SM83::MMUWrite(mmu, 0x0013, 0xB1);
     EXPECT_EQ(emu::SM83::MMURead(mmu, 0x0013), 0xB1);
 
-}
\ No newline at end of file
+}
+
+TEST(MMUTests, WriteHandlerSeesReadOnlyWrites)
+{
+    emu::SM83::MMU mmu;
+
+    uint8_t localMem[256] = {};
+    localMem[0x13] = 0xA3;
+
+    struct WriteLog
+    {
+        uint16_t _address = 0;
+        uint8_t _val = 0;
+    } log;
+
+    emu::SM83::MMIOHandler handler;
+    handler._write = [](void* context, emu::SM83::MMU&, uint16_t address, uint8_t val)
+    {
+        WriteLog& log = *static_cast<WriteLog*>(context);
+        log._address = address;
+        log._val = val;
+    };
+    handler._context = &log;
+
+    emu::SM83::MapMemoryRegion(mmu, 0x2000, sizeof(localMem), localMem, emu::SM83::MMRF_ReadOnly, &handler);
+    emu::SM83::MMUWrite(mmu, 0x2013, 0xA4);
+
+    EXPECT_EQ(log._address, 0x2013);
+    EXPECT_EQ(log._val, 0xA4);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0x2013), 0xA3);
+
+    // Mapping without a handler drops it
+    emu::SM83::MapMemoryRegion(mmu, 0x2000, sizeof(localMem), localMem, emu::SM83::MMRF_ReadOnly);
+    emu::SM83::MMUWrite(mmu, 0x2014, 0xA5);
+    EXPECT_EQ(log._address, 0x2013);
+}
+
+TEST(MMUTests, LockedBusIgnoresAccesses)
+{
+    emu::SM83::MMU mmu;
+
+    uint8_t wram[512] = {};
+    uint8_t vram[256] = {};
+    uint8_t hram[256] = {};
+    wram[0x13] = 0xA3;
+    vram[0x13] = 0xB3;
+
+    emu::SM83::MapMemoryRegion(mmu, 0xC000, sizeof(wram), wram, 0);
+    emu::SM83::MapMemoryRegion(mmu, 0x8000, sizeof(vram), vram, 0);
+    emu::SM83::MapMemoryRegion(mmu, 0xFF00, sizeof(hram), hram, 0);
+    emu::SM83::LockBus(mmu, emu::SM83::MMUBus::External);
+
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xC013), 0xFF);
+    emu::SM83::MMUWrite(mmu, 0xC013, 0xA4);
+    emu::SM83::MMUWrite(mmu, 0xC113, 0xA5);
+    EXPECT_EQ(wram[0x13], 0xA3);
+    EXPECT_EQ(wram[0x113], 0x00);
+
+    // The other bus and HRAM are left alone
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0x8013), 0xB3);
+    emu::SM83::MMUWrite(mmu, 0xFF80, 0xC5);
+    EXPECT_EQ(hram[0x80], 0xC5);
+
+    // Remapping while locked only shows once unlocked
+    emu::SM83::MapMemoryRegion(mmu, 0xC100, 256, wram, 0);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xC113), 0xFF);
+
+    emu::SM83::UnlockBus(mmu);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xC013), 0xA3);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xC113), 0xA3);
+    emu::SM83::MMUWrite(mmu, 0xC013, 0xA5);
+    EXPECT_EQ(wram[0x13], 0xA5);
+}
+
+TEST(MMUTests, VideoLockIgnoresAccesses)
+{
+    emu::SM83::MMU mmu;
+
+    uint8_t vram[512] = {};
+    uint8_t oam[256] = {};
+    vram[0x13] = 0xB3;
+    oam[0x13] = 0xC3;
+
+    emu::SM83::MapMemoryRegion(mmu, 0x8000, sizeof(vram), vram, 0);
+    emu::SM83::MapMemoryRegion(mmu, 0xFE00, sizeof(oam), oam, 0);
+    emu::SM83::SetVideoLock(mmu, emu::SM83::MMUVideoLock::VRAM);
+
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0x8013), 0xFF);
+    emu::SM83::MMUWrite(mmu, 0x8113, 0xB4);
+    EXPECT_EQ(vram[0x113], 0x00);
+    EXPECT_TRUE(emu::SM83::IsVideoLocked(mmu, 0x8013));
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFE13), 0xC3);
+
+    // Each lock only covers its own memory, and the mapping is still there once unlocked
+    emu::SM83::SetVideoLock(mmu, emu::SM83::MMUVideoLock::OAM);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0x8013), 0xB3);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFE13), 0xFF);
+    EXPECT_FALSE(emu::SM83::IsVideoLocked(mmu, 0x8013));
+
+    // Along with a locked bus, unlocking the bus leaves the video lock in place
+    emu::SM83::LockBus(mmu, emu::SM83::MMUBus::External);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFE13), 0xFF);
+    emu::SM83::UnlockBus(mmu);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFE13), 0xFF);
+
+    emu::SM83::SetVideoLock(mmu, emu::SM83::MMUVideoLock::None);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFE13), 0xC3);
+    EXPECT_TRUE(emu::SM83::IsMemoryMapped(mmu, 0x8013));
+}
+
+TEST(MMUTests, RedirectStaysOverRemappedZeroSegment)
+{
+    emu::SM83::MMU mmu;
+
+    uint8_t redirectMem[256] = {};
+    redirectMem[0x13] = 0xAA;
+
+    uint8_t localMem[512] = {};
+    localMem[0x13] = 0xA3;
+    localMem[0x113] = 0xA4;
+
+    emu::SM83::RedirectZeroSegment(mmu, redirectMem);
+    emu::SM83::MapMemoryRegion(mmu, 0x0000, sizeof(localMem), localMem, emu::SM83::MMRF_ReadOnly);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0x0013), 0xAA);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0x0113), 0xA4);
+
+    emu::SM83::RemoveZeroSegmentRedirect(mmu);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0x0013), 0xA3);
+}
+
+TEST(MMUTests, HRAMSkipsIOHandler)
+{
+    emu::SM83::MMU mmu;
+
+    uint8_t io[256] = {};
+    uint8_t hram[127] = {};
+    uint32_t handlerCalls = 0;
+
+    emu::SM83::MMIOHandler handler;
+    handler._read = [](void* context, uint16_t) -> uint8_t { (*static_cast<uint32_t*>(context))++; return 0x42; };
+    handler._write = [](void* context, emu::SM83::MMU&, uint16_t, uint8_t) { (*static_cast<uint32_t*>(context))++; };
+    handler._context = &handlerCalls;
+
+    emu::SM83::MapMemoryRegion(mmu, 0xFF00, sizeof(io), io, 0, &handler);
+    emu::SM83::MapHRAM(mmu, hram);
+
+    // Not even a locked bus keeps the CPU off of HRAM
+    emu::SM83::LockBus(mmu, emu::SM83::MMUBus::External);
+    emu::SM83::MMUWrite(mmu, 0xFF80, 0xC5);
+    emu::SM83::MMUWrite(mmu, 0xFFFE, 0xC6);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF80), 0xC5);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFFFE), 0xC6);
+    EXPECT_EQ(hram[0], 0xC5);
+    EXPECT_EQ(hram[126], 0xC6);
+    EXPECT_EQ(handlerCalls, 0u);
+
+    // The IO registers and IE still go through the handler
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF7F), 0x42);
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFFFF), 0x42);
+    emu::SM83::MMUWrite(mmu, 0xFFFF, 0x01);
+    EXPECT_EQ(handlerCalls, 3u);
+
+    // Unmapping the IO page takes HRAM with it
+    emu::SM83::UnmapMemoryRegion(mmu, 0xFF00, sizeof(io));
+    EXPECT_EQ(emu::SM83::MMURead(mmu, 0xFF80), 0xFF);
+}
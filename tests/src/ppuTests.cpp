@@ -0,0 +1,370 @@
+#include "gtest/gtest.h"
+
+#include "MMU.hpp"
+#include "PPU.hpp"
+#include "SM83.hpp"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr const uint32_t CYCLES_PER_SCANLINE = 456;
+    constexpr const uint32_t CYCLES_PER_FRAME = CYCLES_PER_SCANLINE * 154;
+
+    struct PPUTestContext
+    {
+        emu::SM83::MMU _mmu;
+        emu::SM83::CPU _cpu;
+        emu::SM83::PPU _ppu;
+        emu::SM83::TileCache _tileCache;
+
+        uint8_t _vram[0x2000] = {};
+        uint8_t _oam[0x100] = {};
+        uint8_t _framebuffer[emu::SM83::SCREEN_WIDTH * emu::SM83::SCREEN_HEIGHT] = {};
+
+        std::vector<uint8_t> _pixels;
+        uint32_t _frameCount = 0;
+    };
+
+    // Every scanline in the order it got drawn
+    void StoreScanline(void* userData, uint8_t LY)
+    {
+        PPUTestContext& ctxt = *static_cast<PPUTestContext*>(userData);
+        const uint8_t* row = ctxt._framebuffer + LY * emu::SM83::SCREEN_WIDTH;
+        ctxt._pixels.insert(ctxt._pixels.end(), row, row + emu::SM83::SCREEN_WIDTH);
+    }
+
+    void CountFrame(void* userData)
+    {
+        static_cast<PPUTestContext*>(userData)->_frameCount++;
+    }
+
+    // Random tiles and maps, with sprites spread over the screen including some sharing scanlines and positions
+    void BootPPUTest(PPUTestContext& ctxt, bool batchScanlines)
+    {
+        uint32_t state = 0x12345678;
+        for (uint8_t& byte : ctxt._vram)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            byte = uint8_t(state);
+        }
+
+        for (uint32_t i = 0; i < 40; ++i)
+        {
+            ctxt._oam[i * 4 + 0] = uint8_t(16 + (i * 7) % 150);
+            ctxt._oam[i * 4 + 1] = uint8_t(8 + (i * 23) % 160);
+            ctxt._oam[i * 4 + 2] = uint8_t(i * 3);
+            ctxt._oam[i * 4 + 3] = uint8_t(i * 0x30);
+        }
+
+        emu::SM83::MapMemoryRegion(ctxt._mmu, 0x8000, sizeof(ctxt._vram), ctxt._vram, 0);
+        emu::SM83::MapMemoryRegion(ctxt._mmu, 0xFE00, sizeof(ctxt._oam), ctxt._oam, 0);
+
+        emu::SM83::BootCPU(ctxt._cpu, 0xFFFE, 0x0100, 1);
+        emu::SM83::MapPeripheralIOMemory(ctxt._cpu, ctxt._mmu);
+        emu::SM83::BootPPU(ctxt._ppu, ctxt._vram, ctxt._oam);
+        emu::SM83::SetPPUFramebuffer(ctxt._ppu, { ._pixels = ctxt._framebuffer, ._pitch = emu::SM83::SCREEN_WIDTH });
+        emu::SM83::SetPPUOutputHooks(ctxt._ppu, StoreScanline, CountFrame, &ctxt);
+        ctxt._ppu._batchScanlines = batchScanlines;
+        if (batchScanlines)
+        {
+            emu::SM83::SetPPUTileCache(ctxt._ppu, ctxt._mmu, &ctxt._tileCache);
+        }
+
+        emu::SM83::PeripheralIO& pIO = ctxt._cpu._peripheralIO;
+        pIO.LCDC = 0xE3;
+        pIO.SCX = 5;
+        pIO.SCY = 3;
+        pIO.WX = 87;
+        pIO.WY = 40;
+        pIO.BGP = 0xE4;
+        pIO.OBP0 = 0xD2;
+        pIO.OBP1 = 0x1B;
+    }
+
+    void AdvancePPUTest(PPUTestContext& ctxt, uint32_t cycles)
+    {
+        emu::SM83::AdvancePPU(ctxt._ppu, ctxt._mmu, ctxt._cpu._peripheralIO, cycles);
+    }
+}
+
+TEST(PPUTests, BatchedScanlinesMatchDotByDot)
+{
+    std::unique_ptr<PPUTestContext> batched = std::make_unique<PPUTestContext>();
+    std::unique_ptr<PPUTestContext> dotByDot = std::make_unique<PPUTestContext>();
+    BootPPUTest(*batched, true);
+    BootPPUTest(*dotByDot, false);
+
+    for (PPUTestContext* ctxt : { batched.get(), dotByDot.get() })
+    {
+        AdvancePPUTest(*ctxt, 2 * CYCLES_PER_FRAME);
+    }
+
+    EXPECT_EQ(batched->_pixels.size(), 2u * 160 * 144);
+    EXPECT_EQ(batched->_pixels, dotByDot->_pixels);
+    EXPECT_EQ(batched->_cpu._peripheralIO.STAT, dotByDot->_cpu._peripheralIO.STAT);
+}
+
+TEST(PPUTests, WriteDuringPixelFetchFallsBackToDotByDot)
+{
+    std::unique_ptr<PPUTestContext> batched = std::make_unique<PPUTestContext>();
+    std::unique_ptr<PPUTestContext> dotByDot = std::make_unique<PPUTestContext>();
+    BootPPUTest(*batched, true);
+    BootPPUTest(*dotByDot, false);
+
+    for (PPUTestContext* ctxt : { batched.get(), dotByDot.get() })
+    {
+        // Halfway through pixel fetch of a scanline with the window on it
+        AdvancePPUTest(*ctxt, 60 * CYCLES_PER_SCANLINE + 200);
+        emu::SM83::NotifyPPURegisterWrite(ctxt->_ppu, 0xFF47);
+        ctxt->_cpu._peripheralIO.BGP = 0x1B;
+        EXPECT_FALSE(ctxt->_ppu._lineBatched);
+
+        emu::SM83::NotifyPPURegisterWrite(ctxt->_ppu, 0xFF43);
+        ctxt->_cpu._peripheralIO.SCX = 100;
+
+        // Batched scanlines only output once they're done, so stop on a scanline boundary
+        AdvancePPUTest(*ctxt, CYCLES_PER_FRAME - 200);
+    }
+
+    EXPECT_EQ(batched->_pixels, dotByDot->_pixels);
+}
+
+TEST(PPUTests, OAMScanInOneGoMatchesDotByDot)
+{
+    std::unique_ptr<PPUTestContext> batched = std::make_unique<PPUTestContext>();
+    std::unique_ptr<PPUTestContext> dotByDot = std::make_unique<PPUTestContext>();
+    BootPPUTest(*batched, true);
+    BootPPUTest(*dotByDot, true);
+
+    // Scans go dot by dot while OAM DMA has the bus
+    emu::SM83::LockBus(dotByDot->_mmu, emu::SM83::MMUBus::External);
+
+    for (PPUTestContext* ctxt : { batched.get(), dotByDot.get() })
+    {
+        // Halfway through the OAM scan, entries already scanned stay as they were and the rest see the changes
+        AdvancePPUTest(*ctxt, 60 * CYCLES_PER_SCANLINE + 40);
+        EXPECT_EQ(ctxt->_ppu._currMode, emu::SM83::PPU::Mode::ObjectFetch);
+
+        ctxt->_cpu._peripheralIO.LCDC |= 0x04;
+        for (uint32_t i = 0; i < 40; ++i)
+        {
+            ctxt->_oam[i * 4 + 0] = uint8_t(16 + 60 - (i % 12));
+        }
+
+        AdvancePPUTest(*ctxt, 60);
+    }
+
+    const emu::SM83::ObjectFetcher& batchedFetch = batched->_ppu._objFetch;
+    const emu::SM83::ObjectFetcher& dotByDotFetch = dotByDot->_ppu._objFetch;
+    ASSERT_EQ(batchedFetch._spriteCount, dotByDotFetch._spriteCount);
+    EXPECT_EQ(std::memcmp(batchedFetch._spriteList, dotByDotFetch._spriteList, sizeof(batchedFetch._spriteList)), 0);
+
+    for (PPUTestContext* ctxt : { batched.get(), dotByDot.get() })
+    {
+        AdvancePPUTest(*ctxt, CYCLES_PER_FRAME - 60 * CYCLES_PER_SCANLINE - 100);
+    }
+
+    EXPECT_EQ(batched->_pixels.size(), 160u * 144);
+    EXPECT_EQ(batched->_pixels, dotByDot->_pixels);
+    EXPECT_EQ(batched->_cpu._peripheralIO.STAT, dotByDot->_cpu._peripheralIO.STAT);
+}
+
+TEST(PPUTests, TileDataWritesInvalidateTileCache)
+{
+    std::unique_ptr<PPUTestContext> batched = std::make_unique<PPUTestContext>();
+    std::unique_ptr<PPUTestContext> dotByDot = std::make_unique<PPUTestContext>();
+    BootPPUTest(*batched, true);
+    BootPPUTest(*dotByDot, false);
+
+    for (PPUTestContext* ctxt : { batched.get(), dotByDot.get() })
+    {
+        // Fill the cache, then rewrite all tile data during VBlank so every cached tile goes stale
+        AdvancePPUTest(*ctxt, 145 * CYCLES_PER_SCANLINE);
+        for (uint16_t address = 0x8000; address < 0x9800; ++address)
+        {
+            emu::SM83::MMUWrite(ctxt->_mmu, address, uint8_t(address * 7));
+        }
+
+        AdvancePPUTest(*ctxt, CYCLES_PER_FRAME - 145 * CYCLES_PER_SCANLINE + CYCLES_PER_FRAME);
+    }
+
+    EXPECT_EQ(batched->_pixels.size(), 2u * 160 * 144);
+    EXPECT_EQ(batched->_pixels, dotByDot->_pixels);
+}
+
+TEST(PPUTests, FramebufferFormats)
+{
+    std::unique_ptr<PPUTestContext> ctxt = std::make_unique<PPUTestContext>();
+    std::unique_ptr<PPUTestContext> indexed = std::make_unique<PPUTestContext>();
+    BootPPUTest(*ctxt, true);
+    BootPPUTest(*indexed, true);
+    emu::SM83::SetPPUOutputHooks(ctxt->_ppu, nullptr, CountFrame, ctxt.get());
+
+    // Each format gets its own frame, checked against the same frame drawn with shades
+    constexpr const uint32_t SHADES[4] = { 0xFF102030, 0xFF405060, 0xFF708090, 0xFFA0B0C0 };
+    const emu::SM83::FramebufferFormat formats[] =
+    {
+        emu::SM83::FramebufferFormat::RGBA8888,
+        emu::SM83::FramebufferFormat::RGB565,
+        emu::SM83::FramebufferFormat::BGRA8888,
+    };
+
+    for (emu::SM83::FramebufferFormat format : formats)
+    {
+        // Padding at the end of each row is left alone
+        constexpr const uint32_t PITCH = emu::SM83::SCREEN_WIDTH * 4 + 16;
+        std::vector<uint8_t> pixels(PITCH * emu::SM83::SCREEN_HEIGHT, 0xCD);
+        emu::SM83::SetPPUFramebuffer(ctxt->_ppu,
+        {
+            ._pixels = pixels.data(),
+            ._pitch = PITCH,
+            ._format = format,
+            ._shades = { SHADES[0], SHADES[1], SHADES[2], SHADES[3] },
+        });
+
+        indexed->_pixels.clear();
+        AdvancePPUTest(*ctxt, CYCLES_PER_FRAME);
+        AdvancePPUTest(*indexed, CYCLES_PER_FRAME);
+        ASSERT_EQ(indexed->_pixels.size(), size_t(emu::SM83::SCREEN_WIDTH) * emu::SM83::SCREEN_HEIGHT);
+
+        for (uint32_t y = 0; y < emu::SM83::SCREEN_HEIGHT; ++y)
+        {
+            const uint8_t* row = pixels.data() + y * PITCH;
+            for (uint32_t x = 0; x < emu::SM83::SCREEN_WIDTH; ++x)
+            {
+                uint32_t argb = SHADES[indexed->_pixels[y * emu::SM83::SCREEN_WIDTH + x]];
+                uint8_t r = uint8_t(argb >> 16);
+                uint8_t g = uint8_t(argb >> 8);
+                uint8_t b = uint8_t(argb);
+
+                if (format == emu::SM83::FramebufferFormat::RGBA8888)
+                {
+                    const uint8_t expected[] = { r, g, b, 0xFF };
+                    EXPECT_EQ(std::memcmp(row + x * 4, expected, 4), 0);
+                }
+                else if (format == emu::SM83::FramebufferFormat::BGRA8888)
+                {
+                    const uint8_t expected[] = { b, g, r, 0xFF };
+                    EXPECT_EQ(std::memcmp(row + x * 4, expected, 4), 0);
+                }
+                else
+                {
+                    uint16_t expected = uint16_t((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+                    EXPECT_EQ(row[x * 2 + 0], uint8_t(expected));
+                    EXPECT_EQ(row[x * 2 + 1], uint8_t(expected >> 8));
+                }
+            }
+
+            uint32_t rowSize = emu::SM83::SCREEN_WIDTH * (format == emu::SM83::FramebufferFormat::RGB565 ? 2 : 4);
+            EXPECT_EQ(row[rowSize], 0xCD);
+        }
+    }
+
+    EXPECT_EQ(ctxt->_frameCount, 3u);
+}
+
+TEST(PPUTests, SkippedFramesKeepTheirTiming)
+{
+    std::unique_ptr<PPUTestContext> skipping = std::make_unique<PPUTestContext>();
+    std::unique_ptr<PPUTestContext> rendering = std::make_unique<PPUTestContext>();
+    BootPPUTest(*skipping, true);
+    BootPPUTest(*rendering, true);
+
+    // Window ending partway through a tile, so scanlines leave pixels behind in the FIFO
+    skipping->_cpu._peripheralIO.WX = 90;
+    rendering->_cpu._peripheralIO.WX = 90;
+
+    // Every other frame, starting with the second one
+    emu::SM83::SetPPUFrameSkip(skipping->_ppu, 1);
+
+    std::vector<uint8_t> renderedFrames;
+    for (uint32_t frame = 0; frame < 4; ++frame)
+    {
+        for (uint32_t cycle = 0; cycle < CYCLES_PER_FRAME; ++cycle)
+        {
+            for (PPUTestContext* ctxt : { skipping.get(), rendering.get() })
+            {
+                AdvancePPUTest(*ctxt, 1);
+            }
+
+            const emu::SM83::PeripheralIO& skippingIO = skipping->_cpu._peripheralIO;
+            const emu::SM83::PeripheralIO& renderingIO = rendering->_cpu._peripheralIO;
+            ASSERT_EQ(skippingIO.STAT, renderingIO.STAT);
+            ASSERT_EQ(skippingIO.LY, renderingIO.LY);
+            ASSERT_EQ(skippingIO.IF, renderingIO.IF);
+            ASSERT_EQ(skipping->_mmu._videoLock, rendering->_mmu._videoLock);
+        }
+
+        if (frame % 2 == 0)
+        {
+            renderedFrames.insert(renderedFrames.end(), rendering->_pixels.end() - 160 * 144, rendering->_pixels.end());
+        }
+    }
+
+    EXPECT_EQ(skipping->_pixels, renderedFrames);
+    EXPECT_EQ(skipping->_frameCount, 4u);
+}
+
+TEST(PPUTests, PixelFetchEndMatchesDotByDot)
+{
+    std::unique_ptr<PPUTestContext> batched = std::make_unique<PPUTestContext>();
+    std::unique_ptr<PPUTestContext> dotByDot = std::make_unique<PPUTestContext>();
+    BootPPUTest(*batched, true);
+    BootPPUTest(*dotByDot, false);
+
+    // New sprites and window every frame, bunched up in places and hanging off either edge
+    uint32_t state = 0xBADC0DE;
+    auto random = [&state](uint32_t range)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % range;
+    };
+
+    // Changes go in during VBlank, the way a game would have to
+    for (PPUTestContext* ctxt : { batched.get(), dotByDot.get() })
+    {
+        AdvancePPUTest(*ctxt, 145 * CYCLES_PER_SCANLINE);
+    }
+
+    for (uint32_t frame = 0; frame < 32; ++frame)
+    {
+        uint8_t clusterX = uint8_t(random(176));
+        for (uint32_t i = 0; i < 40; ++i)
+        {
+            uint8_t posY = uint8_t(random(170));
+            uint8_t posX = random(3) ? uint8_t(random(176)) : uint8_t(clusterX + random(4));
+            for (PPUTestContext* ctxt : { batched.get(), dotByDot.get() })
+            {
+                ctxt->_oam[i * 4 + 0] = posY;
+                ctxt->_oam[i * 4 + 1] = posX;
+            }
+        }
+
+        uint8_t WX = uint8_t(random(176));
+        uint8_t LCDC = random(4) ? 0xE7 : 0xC7;
+        for (PPUTestContext* ctxt : { batched.get(), dotByDot.get() })
+        {
+            ctxt->_cpu._peripheralIO.WX = WX;
+            ctxt->_cpu._peripheralIO.LCDC = LCDC;
+        }
+
+        for (uint32_t cycle = 0; cycle < CYCLES_PER_FRAME; ++cycle)
+        {
+            for (PPUTestContext* ctxt : { batched.get(), dotByDot.get() })
+            {
+                AdvancePPUTest(*ctxt, 1);
+            }
+
+            ASSERT_EQ(batched->_cpu._peripheralIO.STAT, dotByDot->_cpu._peripheralIO.STAT) << "frame " << frame << " cycle " << cycle;
+        }
+    }
+
+    EXPECT_EQ(batched->_pixels, dotByDot->_pixels);
+}
@@ -0,0 +1,42 @@
+#include "gtest/gtest.h"
+
+#include "Scheduler.hpp"
+
+TEST(SchedulerTests, NoEventsDueAfterReset)
+{
+    emu::SM83::Scheduler sched;
+    emu::SM83::ResetScheduler(sched);
+
+    EXPECT_FALSE(emu::SM83::AnyEventDue(sched));
+    EXPECT_FALSE(emu::SM83::IsEventDue(sched, emu::SM83::SchedulerEvent::PPU));
+    EXPECT_FALSE(emu::SM83::IsEventDue(sched, emu::SM83::SchedulerEvent::OAMDMA));
+}
+
+TEST(SchedulerTests, EventBecomesDueAtDeadline)
+{
+    emu::SM83::Scheduler sched;
+    emu::SM83::ResetScheduler(sched);
+    emu::SM83::ScheduleEvent(sched, emu::SM83::SchedulerEvent::PPU, 10);
+    emu::SM83::ScheduleEvent(sched, emu::SM83::SchedulerEvent::OAMDMA, 20);
+
+    emu::SM83::AdvanceScheduler(sched, 9);
+    EXPECT_FALSE(emu::SM83::AnyEventDue(sched));
+
+    emu::SM83::AdvanceScheduler(sched, 1);
+    EXPECT_TRUE(emu::SM83::AnyEventDue(sched));
+    EXPECT_TRUE(emu::SM83::IsEventDue(sched, emu::SM83::SchedulerEvent::PPU));
+    EXPECT_FALSE(emu::SM83::IsEventDue(sched, emu::SM83::SchedulerEvent::OAMDMA));
+
+    emu::SM83::CancelEvent(sched, emu::SM83::SchedulerEvent::PPU);
+    EXPECT_FALSE(emu::SM83::AnyEventDue(sched));
+}
+
+TEST(SchedulerTests, SyncReturnsElapsedCycles)
+{
+    emu::SM83::Scheduler sched;
+    emu::SM83::ResetScheduler(sched);
+
+    EXPECT_EQ(emu::SM83::SyncEvent(sched, emu::SM83::SchedulerEvent::PPU, 100), 100);
+    EXPECT_EQ(emu::SM83::SyncEvent(sched, emu::SM83::SchedulerEvent::PPU, 100), 0);
+    EXPECT_EQ(emu::SM83::SyncEvent(sched, emu::SM83::SchedulerEvent::PPU, 356), 256);
+}
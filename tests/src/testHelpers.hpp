@@ -0,0 +1,83 @@
+#pragma once
+
+#include "GameBoy.hpp"
+
+#include <cstring>
+#include <memory>
+
+// Shared by the tests that run a whole Game Boy
+namespace testHelpers
+{
+    constexpr const uint32_t TEST_ROM_SIZE = 32 * 1024;
+
+    constexpr const emu::SM83::ExecutionMode ALL_MODES[] =
+    {
+        emu::SM83::ExecutionMode::CycleAccurate,
+        emu::SM83::ExecutionMode::Instruction,
+        emu::SM83::ExecutionMode::Compiled,
+    };
+
+    // Smallest ROM the boot ROM accepts, the right logo and a valid header checksum
+    // Fills in a TEST_ROM_SIZE buffer in place, anything else already in the header is part of the checksum
+    inline void BuildTestROM(uint8_t* rom)
+    {
+        emu::SM83::CPU cpu;
+        emu::SM83::BootCPU(cpu, 0, 0);
+        std::memcpy(rom + 0x0104, cpu._bootROM + 0xA8, 48);
+
+        uint8_t checksum = 0;
+        for (uint16_t addr = 0x0134; addr <= 0x014C; ++addr)
+        {
+            checksum = checksum - rom[addr] - 1;
+        }
+
+        rom[0x014D] = checksum;
+    }
+
+    inline std::unique_ptr<uint8_t[]> BuildTestROM()
+    {
+        std::unique_ptr<uint8_t[]> rom = std::make_unique<uint8_t[]>(TEST_ROM_SIZE);
+        BuildTestROM(rom.get());
+        return rom;
+    }
+
+    // Past the boot ROM, TIMA overflows every 256 T-cycles into a loop long enough to be one translated block
+    // The handler records B from $C000 on, wrapping around within that page
+    // None of it is part of the header checksum, so it can go into a ROM that's already been built or booted
+    inline void WriteTimerTestProgram(uint8_t* rom)
+    {
+        constexpr const uint8_t ENTRY[] = { 0x00, 0xC3, 0x50, 0x01 };     // nop; jp $0150
+        constexpr const uint8_t HANDLER[] = { 0x70, 0x2C, 0xD9 };         // ld (hl), b; inc l; reti
+        constexpr const uint8_t MAIN[] =
+        {
+            0x3E, 0xF0, 0xE0, 0x06,     // ld a, $F0; ldh (TMA), a
+            0x3E, 0x05, 0xE0, 0x07,     // ld a, $05; ldh (TAC), a
+            0x3E, 0x04, 0xE0, 0xFF,     // ld a, $04; ldh (IE), a
+            0xAF, 0xE0, 0x0F,           // xor a; ldh (IF), a
+            0x21, 0x00, 0xC0,           // ld hl, $C000
+            0xFB,                       // ei
+        };
+
+        constexpr const uint32_t LOOP_LENGTH = 40;
+
+        std::memcpy(rom + 0x0100, ENTRY, sizeof(ENTRY));
+        std::memcpy(rom + 0x0050, HANDLER, sizeof(HANDLER));
+        std::memcpy(rom + 0x0150, MAIN, sizeof(MAIN));
+
+        const uint16_t loopAddr = uint16_t(0x0150 + sizeof(MAIN));
+        std::memset(rom + loopAddr, 0x04, LOOP_LENGTH);     // inc b
+        rom[loopAddr + LOOP_LENGTH] = 0x18;                 // jr loop
+        rom[loopAddr + LOOP_LENGTH + 1] = uint8_t(-int(LOOP_LENGTH + 2));
+    }
+
+    // userData points at the scanline to wait for
+    inline bool ScanlineReached(void* userData, const emu::SM83::GameBoy& gb)
+    {
+        return gb._cpu._peripheralIO.LY >= *static_cast<const uint8_t*>(userData);
+    }
+
+    inline bool BootROMDone(void*, const emu::SM83::GameBoy& gb)
+    {
+        return gb._cpu._peripheralIO.BOOT_CTRL != 0;
+    }
+}
@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+
+#include "TileDecode.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr const emu::SM83::TileDecodeKernel KERNELS[] =
+    {
+        emu::SM83::TileDecodeKernel::Scalar,
+        emu::SM83::TileDecodeKernel::SSE2,
+        emu::SM83::TileDecodeKernel::AVX2,
+    };
+
+    // Odd sizes so every kernel has a tail to deal with
+    constexpr const uint32_t ROW_COUNT = 37;
+
+    std::vector<uint8_t> RandomBytes(uint32_t count)
+    {
+        std::vector<uint8_t> bytes(count);
+        uint32_t state = 0xC0FFEE;
+        for (uint8_t& byte : bytes)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            byte = uint8_t(state);
+        }
+
+        return bytes;
+    }
+}
+
+TEST(TileDecodeTests, DecodesRowsLeftmostPixelFirst)
+{
+    // Low bitplane 0b10100000, high bitplane 0b11000001
+    const uint8_t row[] = { 0xA0, 0xC1 };
+    const uint8_t expected[] = { 3, 2, 1, 0, 0, 0, 0, 2 };
+    const uint8_t expectedFlipped[] = { 2, 0, 0, 0, 0, 1, 2, 3 };
+
+    for (emu::SM83::TileDecodeKernel kernel : KERNELS)
+    {
+        if (!emu::SM83::IsTileDecodeKernelSupported(kernel))
+        {
+            continue;
+        }
+
+        uint8_t indices[8] = {};
+        emu::SM83::DecodeTileRows(kernel, row, 1, false, indices);
+        EXPECT_EQ(std::memcmp(indices, expected, sizeof(expected)), 0);
+
+        emu::SM83::DecodeTileRows(kernel, row, 1, true, indices);
+        EXPECT_EQ(std::memcmp(indices, expectedFlipped, sizeof(expectedFlipped)), 0);
+    }
+}
+
+TEST(TileDecodeTests, KernelsMatchScalar)
+{
+    std::vector<uint8_t> rows = RandomBytes(ROW_COUNT * 2);
+
+    for (bool xFlip : { false, true })
+    {
+        std::vector<uint8_t> expected(ROW_COUNT * 8);
+        emu::SM83::DecodeTileRows(emu::SM83::TileDecodeKernel::Scalar, rows.data(), ROW_COUNT, xFlip, expected.data());
+
+        std::vector<uint8_t> expectedColors(expected.size());
+        emu::SM83::ApplyPalette(emu::SM83::TileDecodeKernel::Scalar, expected.data(), uint32_t(expected.size()), 0x1B, expectedColors.data());
+
+        for (emu::SM83::TileDecodeKernel kernel : KERNELS)
+        {
+            if (!emu::SM83::IsTileDecodeKernelSupported(kernel))
+            {
+                continue;
+            }
+
+            std::vector<uint8_t> indices(ROW_COUNT * 8);
+            emu::SM83::DecodeTileRows(kernel, rows.data(), ROW_COUNT, xFlip, indices.data());
+            EXPECT_EQ(indices, expected);
+
+            // Indices and colours sharing a buffer
+            emu::SM83::ApplyPalette(kernel, indices.data(), uint32_t(indices.size()), 0x1B, indices.data());
+            EXPECT_EQ(indices, expectedColors);
+        }
+    }
+}